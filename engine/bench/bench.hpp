@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace grape {
+
+    class Device;
+    class Physics;
+
+    // Handed to every benchmark. Setup goes before the loop, the timer only runs inside it:
+    //
+    //     while (state.keepRunning()) { ... }
+    class BenchState {
+    public:
+        BenchState(uint64_t iterations, int64_t arg) : iterations{ iterations }, arg{ arg } {}
+
+        bool keepRunning() {
+            if (!started) {
+                started = true;
+                start = std::chrono::steady_clock::now();
+            }
+            if (remaining > 0) {
+                remaining--;
+                return true;
+            }
+            elapsed += std::chrono::steady_clock::now() - start;
+            return false;
+        }
+
+        // Excludes per-iteration setup from the timing
+        void pauseTiming() { elapsed += std::chrono::steady_clock::now() - start; }
+        void resumeTiming() { start = std::chrono::steady_clock::now(); }
+
+        // Whatever a single iteration processes (vertices, bodies, ...), reported as items/s
+        void setItemsPerIteration(uint64_t items) { itemsPerIteration = items; }
+
+        // Gives up on the benchmark, e.g. when there's no Vulkan device
+        void skip(const std::string& reason) { skipReason = reason; remaining = 0; }
+
+        int64_t getArg() const { return arg; }
+        uint64_t getIterations() const { return iterations; }
+        uint64_t getItemsPerIteration() const { return itemsPerIteration; }
+        const std::string& getSkipReason() const { return skipReason; }
+        double getElapsedSeconds() const { return std::chrono::duration<double>(elapsed).count(); }
+
+    private:
+        const uint64_t iterations;
+        const int64_t arg;
+        uint64_t remaining = iterations;
+        bool started = false;
+        uint64_t itemsPerIteration = 0;
+        std::string skipReason;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::duration elapsed{ 0 };
+    };
+
+    using BenchFunction = std::function<void(BenchState&)>;
+
+    // Registers name, or name/arg for every arg when there are any
+    bool registerBenchmark(const std::string& name, BenchFunction function, std::vector<int64_t> args = {});
+
+    // Headless device shared by the benchmarks that upload to the GPU, nullptr if there's none
+    Device* getBenchDevice();
+    // PhysX lives in globals, so every benchmark shares one Physics and one scene
+    Physics& getBenchPhysics();
+
+    // Keeps the optimizer from throwing away a result nobody reads
+    template <typename T>
+    inline void doNotOptimize(const T& value) {
+#if defined(_MSC_VER)
+        static volatile const void* sink;
+        sink = &value;
+        _ReadWriteBarrier();
+#else
+        asm volatile("" : : "r,m"(value) : "memory");
+#endif
+    }
+}
+
+#define GRAPE_BENCH_CONCAT_INNER(a, b) a##b
+#define GRAPE_BENCH_CONCAT(a, b) GRAPE_BENCH_CONCAT_INNER(a, b)
+
+#define GRAPE_BENCHMARK(name, function) \
+    static const bool GRAPE_BENCH_CONCAT(benchRegistered, __LINE__) = ::grape::registerBenchmark(name, function)
+#define GRAPE_BENCHMARK_ARGS(name, function, ...) \
+    static const bool GRAPE_BENCH_CONCAT(benchRegistered, __LINE__) = ::grape::registerBenchmark(name, function, { __VA_ARGS__ })
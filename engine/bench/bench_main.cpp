@@ -0,0 +1,299 @@
+#include "bench.hpp"
+#include "renderer/device.hpp"
+#include "systems/physics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+// Microbenchmarks for the engine's CPU hot paths
+//
+//   grape_bench [--filter <substring>] [--json <file>] [--min-time <seconds>]
+//               [--repetitions <n>] [--label <text>] [--list] [--verbose]
+//
+// Every benchmark is calibrated until one run takes --min-time, then repeated; the table
+// and the JSON report the median of the repetitions. --label ends up in the JSON so runs
+// of different commits can be told apart when they're compared
+
+namespace grape {
+
+    namespace {
+        struct Registration {
+            std::string name;
+            BenchFunction function;
+            int64_t arg;
+        };
+
+        std::vector<Registration>& getRegistry() {
+            static std::vector<Registration> registry;
+            return registry;
+        }
+
+        struct BenchOptions {
+            std::string filter;
+            std::string jsonPath;
+            std::string label;
+            double minTime = 0.25;
+            int repetitions = 5;
+            bool list = false;
+            bool verbose = false;
+        };
+
+        struct BenchResult {
+            std::string name;
+            int64_t arg = 0;
+            uint64_t iterations = 0;
+            std::vector<double> nsPerIteration;     // One per repetition
+            uint64_t itemsPerIteration = 0;
+            std::string skipReason;
+
+            double median() const {
+                std::vector<double> sorted = nsPerIteration;
+                std::sort(sorted.begin(), sorted.end());
+                size_t middle = sorted.size() / 2;
+                return sorted.size() % 2 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) * 0.5;
+            }
+            double mean() const {
+                double sum = 0.0;
+                for (double ns : nsPerIteration) sum += ns;
+                return sum / nsPerIteration.size();
+            }
+            double stddev() const {
+                double average = mean();
+                double sum = 0.0;
+                for (double ns : nsPerIteration) sum += (ns - average) * (ns - average);
+                return nsPerIteration.size() > 1 ? std::sqrt(sum / (nsPerIteration.size() - 1)) : 0.0;
+            }
+        };
+
+        // Model loading and friends talk a lot, which would end up in the timings
+        class QuietScope {
+        public:
+            QuietScope(bool enabled) {
+                if (enabled) saved = std::cout.rdbuf(sink.rdbuf());
+            }
+            ~QuietScope() {
+                if (saved) std::cout.rdbuf(saved);
+            }
+
+        private:
+            std::ostringstream sink;
+            std::streambuf* saved = nullptr;
+        };
+
+        BenchState runOnce(const Registration& registration, uint64_t iterations, bool verbose) {
+            BenchState state{ iterations, registration.arg };
+            QuietScope quiet{ !verbose };
+            registration.function(state);
+            return state;
+        }
+
+        BenchResult runBenchmark(const Registration& registration, const BenchOptions& options) {
+            BenchResult result;
+            result.name = registration.name;
+            result.arg = registration.arg;
+
+            // Grow the iteration count until a run is long enough to trust the clock
+            uint64_t iterations = 1;
+            while (true) {
+                BenchState state = runOnce(registration, iterations, options.verbose);
+                if (!state.getSkipReason().empty()) {
+                    result.skipReason = state.getSkipReason();
+                    return result;
+                }
+
+                double seconds = state.getElapsedSeconds();
+                if (seconds >= options.minTime || iterations >= 1000000000ull) break;
+
+                double scale = seconds > 0.0 ? options.minTime / seconds * 1.4 : 10.0;
+                scale = std::min(std::max(scale, 2.0), 10.0);
+                iterations = static_cast<uint64_t>(iterations * scale);
+            }
+
+            result.iterations = iterations;
+            for (int repetition = 0; repetition < options.repetitions; repetition++) {
+                BenchState state = runOnce(registration, iterations, options.verbose);
+                result.nsPerIteration.push_back(state.getElapsedSeconds() * 1e9 / iterations);
+                result.itemsPerIteration = state.getItemsPerIteration();
+            }
+            return result;
+        }
+
+        std::string formatTime(double ns) {
+            char text[32];
+            if (ns < 1e3) std::snprintf(text, sizeof(text), "%.2f ns", ns);
+            else if (ns < 1e6) std::snprintf(text, sizeof(text), "%.2f us", ns / 1e3);
+            else if (ns < 1e9) std::snprintf(text, sizeof(text), "%.2f ms", ns / 1e6);
+            else std::snprintf(text, sizeof(text), "%.2f s", ns / 1e9);
+            return text;
+        }
+
+        std::string escapeJson(const std::string& text) {
+            std::string escaped;
+            for (char c : text) {
+                if (c == '"' || c == '\\') escaped += '\\';
+                if (static_cast<unsigned char>(c) < 0x20) continue;
+                escaped += c;
+            }
+            return escaped;
+        }
+
+        void writeJson(const std::string& path, const BenchOptions& options, const std::vector<BenchResult>& results) {
+            std::ofstream file(path);
+            if (!file) {
+                throw std::runtime_error("failed to open " + path + "!");
+            }
+
+            char date[32];
+            std::time_t now = std::time(nullptr);
+            std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+            file << "{\n  \"context\": {\n";
+            file << "    \"date\": \"" << date << "\",\n";
+            file << "    \"label\": \"" << escapeJson(options.label) << "\",\n";
+#ifdef NDEBUG
+            file << "    \"build\": \"release\",\n";
+#else
+            file << "    \"build\": \"debug\",\n";
+#endif
+            file << "    \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+            file << "    \"min_time_s\": " << options.minTime << ",\n";
+            file << "    \"repetitions\": " << options.repetitions << "\n";
+            file << "  },\n  \"benchmarks\": [";
+
+            bool first = true;
+            for (const auto& result : results) {
+                file << (first ? "\n" : ",\n") << "    {\"name\": \"" << escapeJson(result.name) << "\", \"arg\": " << result.arg;
+                first = false;
+                if (!result.skipReason.empty()) {
+                    file << ", \"skipped\": \"" << escapeJson(result.skipReason) << "\"}";
+                    continue;
+                }
+
+                double median = result.median();
+                file << ", \"iterations\": " << result.iterations
+                    << ", \"ns_median\": " << median
+                    << ", \"ns_mean\": " << result.mean()
+                    << ", \"ns_min\": " << *std::min_element(result.nsPerIteration.begin(), result.nsPerIteration.end())
+                    << ", \"ns_max\": " << *std::max_element(result.nsPerIteration.begin(), result.nsPerIteration.end())
+                    << ", \"ns_stddev\": " << result.stddev();
+                if (result.itemsPerIteration > 0) {
+                    file << ", \"items_per_second\": " << result.itemsPerIteration * 1e9 / median;
+                }
+                file << "}";
+            }
+            file << "\n  ]\n}\n";
+        }
+
+        BenchOptions parseOptions(int argc, char** argv) {
+            BenchOptions options;
+            for (int i = 1; i < argc; i++) {
+                auto value = [&]() -> const char* {
+                    if (i + 1 >= argc) {
+                        throw std::runtime_error(std::string("missing value for ") + argv[i] + "!");
+                    }
+                    return argv[++i];
+                };
+
+                if (!std::strcmp(argv[i], "--filter")) options.filter = value();
+                else if (!std::strcmp(argv[i], "--json")) options.jsonPath = value();
+                else if (!std::strcmp(argv[i], "--label")) options.label = value();
+                else if (!std::strcmp(argv[i], "--min-time")) options.minTime = std::max(std::atof(value()), 0.001);
+                else if (!std::strcmp(argv[i], "--repetitions")) options.repetitions = std::max(std::atoi(value()), 1);
+                else if (!std::strcmp(argv[i], "--list")) options.list = true;
+                else if (!std::strcmp(argv[i], "--verbose")) options.verbose = true;
+                else {
+                    throw std::runtime_error(std::string("unknown option ") + argv[i] + "!");
+                }
+            }
+            return options;
+        }
+    }
+
+    bool registerBenchmark(const std::string& name, BenchFunction function, std::vector<int64_t> args) {
+        if (args.empty()) {
+            getRegistry().push_back({ name, function, 0 });
+        }
+        for (int64_t arg : args) {
+            getRegistry().push_back({ name + "/" + std::to_string(arg), function, arg });
+        }
+        return true;
+    }
+
+    Device* getBenchDevice() {
+        static std::unique_ptr<Device> device;
+        static bool attempted = false;
+        if (!attempted) {
+            attempted = true;
+            try {
+                device = std::make_unique<Device>();
+            }
+            catch (const std::exception& e) {
+                std::cerr << "No Vulkan device, skipping GPU backed benchmarks: " << e.what() << std::endl;
+            }
+        }
+        return device.get();
+    }
+
+    Physics& getBenchPhysics() {
+        static Physics physics;
+        static bool initialized = (physics.init(), true);
+        (void)initialized;
+        return physics;
+    }
+}
+
+int main(int argc, char** argv) {
+    using namespace grape;
+
+    try {
+        BenchOptions options = parseOptions(argc, argv);
+
+        std::vector<BenchResult> results;
+        for (const auto& registration : getRegistry()) {
+            if (!options.filter.empty() && registration.name.find(options.filter) == std::string::npos) continue;
+            if (options.list) {
+                std::cout << registration.name << std::endl;
+                continue;
+            }
+
+            BenchResult result = runBenchmark(registration, options);
+            char line[160];
+            if (!result.skipReason.empty()) {
+                std::snprintf(line, sizeof(line), "%-44s skipped (%s)", result.name.c_str(), result.skipReason.c_str());
+            }
+            else {
+                double median = result.median();
+                std::snprintf(line, sizeof(line), "%-44s %12s  +-%5.1f%%  %10llu it", result.name.c_str(),
+                    formatTime(median).c_str(), median > 0.0 ? result.stddev() / median * 100.0 : 0.0,
+                    static_cast<unsigned long long>(result.iterations));
+            }
+            std::cout << line;
+            if (result.itemsPerIteration > 0 && result.skipReason.empty()) {
+                std::cout << "  " << static_cast<uint64_t>(result.itemsPerIteration * 1e9 / result.median()) << " items/s";
+            }
+            std::cout << std::endl;
+            results.push_back(std::move(result));
+        }
+
+        if (!options.jsonPath.empty() && !options.list) {
+            writeJson(options.jsonPath, options, results);
+            std::cout << "Wrote " << options.jsonPath << std::endl;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,102 @@
+#include "bench.hpp"
+#include "renderer/model.hpp"
+
+#include <tiny_obj_loader.h>
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace grape {
+
+    namespace {
+        // The repo doesn't ship any .obj, so the benchmarks load a UV sphere written on the fly.
+        // segments around, segments / 2 rings, with normals and UVs like an exported mesh
+        std::string sphereObjPath(int segments) {
+            static std::map<int, std::string> written;
+            auto it = written.find(segments);
+            if (it != written.end()) return it->second;
+
+            const int rings = segments / 2;
+            const float pi = 3.14159265f;
+            std::string path = (std::filesystem::temp_directory_path() / ("grape_bench_sphere_" + std::to_string(segments) + ".obj")).string();
+
+            std::ofstream file(path);
+            if (!file) {
+                throw std::runtime_error("failed to write " + path + "!");
+            }
+            for (int ring = 0; ring <= rings; ring++) {
+                float phi = pi * ring / rings;
+                for (int segment = 0; segment <= segments; segment++) {
+                    float theta = 2.f * pi * segment / segments;
+                    float x = std::sin(phi) * std::cos(theta);
+                    float y = std::cos(phi);
+                    float z = std::sin(phi) * std::sin(theta);
+                    file << "v " << x << " " << y << " " << z << "\n";
+                    file << "vn " << x << " " << y << " " << z << "\n";
+                    file << "vt " << static_cast<float>(segment) / segments << " " << static_cast<float>(ring) / rings << "\n";
+                }
+            }
+            for (int ring = 0; ring < rings; ring++) {
+                for (int segment = 0; segment < segments; segment++) {
+                    int a = ring * (segments + 1) + segment + 1;
+                    int b = a + segments + 1;
+                    file << "f " << a << "/" << a << "/" << a << " " << b << "/" << b << "/" << b << " " << a + 1 << "/" << a + 1 << "/" << a + 1 << "\n";
+                    file << "f " << a + 1 << "/" << a + 1 << "/" << a + 1 << " " << b << "/" << b << "/" << b << " " << b + 1 << "/" << b + 1 << "/" << b + 1 << "\n";
+                }
+            }
+
+            written[segments] = path;
+            return path;
+        }
+
+        uint64_t sphereTriangles(int segments) {
+            return static_cast<uint64_t>(segments) * (segments / 2) * 2;
+        }
+    }
+
+    // Parse only, what loadModel spends before it gets to the dedup
+    void benchObjParse(BenchState& state) {
+        const int segments = static_cast<int>(state.getArg());
+        std::string path = sphereObjPath(segments);
+        state.setItemsPerIteration(sphereTriangles(segments));
+        while (state.keepRunning()) {
+            tinyobj::attrib_t attrib;
+            std::vector<tinyobj::shape_t> shapes;
+            std::vector<tinyobj::material_t> materials;
+            std::string warn, err;
+            if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str())) {
+                state.skip(warn + err);
+                return;
+            }
+            doNotOptimize(attrib.vertices.data());
+        }
+    }
+    GRAPE_BENCHMARK_ARGS("tinyobj::LoadObj", benchObjParse, 64, 256);
+
+    // Parse, dedup, LODs, meshlets and the buffer uploads. Releasing the buffers isn't timed
+    void benchLoadModel(BenchState& state) {
+        Device* device = getBenchDevice();
+        if (!device) {
+            state.skip("no Vulkan device");
+            return;
+        }
+
+        const int segments = static_cast<int>(state.getArg());
+        std::string path = sphereObjPath(segments);
+        state.setItemsPerIteration(sphereTriangles(segments));
+        while (state.keepRunning()) {
+            auto builder = std::make_unique<Model::Builder>();
+            builder->loadModel(*device, path);
+
+            state.pauseTiming();
+            builder.reset();
+            state.resumeTiming();
+        }
+    }
+    GRAPE_BENCHMARK_ARGS("Model::Builder::loadModel", benchLoadModel, 64, 256);
+}
@@ -0,0 +1,90 @@
+#include "bench.hpp"
+#include "systems/physics.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace grape {
+
+    namespace {
+        constexpr float STEP = 1.f / 60.f;
+        constexpr int GRID_SIDE = 64;
+
+        // Grows the shared physics scene as the benchmarks ask for more bodies. They are unit
+        // boxes packed side by side on the ground plane (y = -1), in layers of GRID_SIDE x
+        // GRID_SIDE, so every step has the contacts a settled pile would
+        struct PhysicsScene {
+            Physics& physics = getBenchPhysics();
+            std::vector<PxRigidDynamic*> bodies;
+            std::vector<PxTransform> restPoses;
+
+            static PhysicsScene& getInstance() {
+                static PhysicsScene instance;
+                return instance;
+            }
+
+            void ensureBodies(size_t count) {
+                while (bodies.size() < count) {
+                    int index = static_cast<int>(bodies.size());
+                    glm::vec3 position{
+                        static_cast<float>(index % GRID_SIDE),
+                        -0.5f + static_cast<float>(index / (GRID_SIDE * GRID_SIDE)),
+                        static_cast<float>(index / GRID_SIDE % GRID_SIDE) };
+
+                    PxShape* shape = physics.CreateBoxShape(0.5f, 0.5f, 0.5f, PxTransform(PxIdentity), nullptr);
+                    PxRigidDynamic* body = physics.CreateRigidDynamic(glm::translate(glm::mat4(1.f), position), shape);
+                    shape->release();
+
+                    bodies.push_back(body);
+                    restPoses.push_back(body->getGlobalPose());
+                }
+            }
+
+            // Puts the first count bodies back and wakes them, the rest go to sleep so they cost
+            // next to nothing. Otherwise the pile settles during the run and the timings drift
+            void reset(size_t count) {
+                for (size_t i = 0; i < bodies.size(); i++) {
+                    bodies[i]->setGlobalPose(restPoses[i]);
+                    bodies[i]->setLinearVelocity(PxVec3(0.f));
+                    bodies[i]->setAngularVelocity(PxVec3(0.f));
+                    if (i < count) bodies[i]->wakeUp();
+                    else bodies[i]->putToSleep();
+                }
+            }
+        };
+    }
+
+    void benchStepPhysics(BenchState& state) {
+        auto& scene = PhysicsScene::getInstance();
+        const size_t count = static_cast<size_t>(state.getArg());
+        scene.ensureBodies(count);
+
+        state.setItemsPerIteration(count);
+        while (state.keepRunning()) {
+            state.pauseTiming();
+            scene.reset(count);
+            state.resumeTiming();
+
+            scene.physics.StepPhysics(STEP);
+        }
+    }
+    GRAPE_BENCHMARK_ARGS("Physics::StepPhysics", benchStepPhysics, 100, 1000, 10000);
+
+    // Converting the PhysX render buffer into debug lines, the buffer itself comes from one step
+    void benchUpdateDebugData(BenchState& state) {
+        auto& scene = PhysicsScene::getInstance();
+        const size_t count = static_cast<size_t>(state.getArg());
+        scene.ensureBodies(count);
+        scene.reset(count);
+
+        scene.physics.setDebugVisualization(true);
+        scene.physics.StepPhysics(STEP);
+        state.setItemsPerIteration(scene.physics.getDebugLines().size());
+
+        while (state.keepRunning()) {
+            scene.physics.updateDebugData();
+            doNotOptimize(scene.physics.getDebugLines().data());
+        }
+        scene.physics.setDebugVisualization(false);
+    }
+    GRAPE_BENCHMARK_ARGS("Physics::updateDebugData", benchUpdateDebugData, 100, 1000);
+}
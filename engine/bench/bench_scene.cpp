@@ -0,0 +1,125 @@
+#include "bench.hpp"
+#include "scene/game_object.hpp"
+#include "scene/game_object_loader.hpp"
+
+#include <random>
+#include <unordered_map>
+
+namespace grape {
+
+    namespace {
+        std::vector<TransformComponent> randomTransforms(size_t count) {
+            std::mt19937 rng{ 1234 };
+            std::uniform_real_distribution<float> position{ -100.f, 100.f };
+            std::uniform_real_distribution<float> unit{ -1.f, 1.f };
+            std::uniform_real_distribution<float> scale{ 0.1f, 4.f };
+
+            std::vector<TransformComponent> transforms(count);
+            for (auto& transform : transforms) {
+                transform.translation = { position(rng), position(rng), position(rng) };
+                transform.scale = { scale(rng), scale(rng), scale(rng) };
+                transform.rotation = glm::normalize(glm::quat{ unit(rng), unit(rng), unit(rng), unit(rng) });
+            }
+            return transforms;
+        }
+
+        // A tessellated grid's worth of vertices, where every vertex shows up six times like it
+        // does in the triangle list tinyobj hands the loader
+        std::vector<Model::Vertex> gridVertexStream(int size) {
+            auto vertexAt = [size](int x, int y) {
+                Model::Vertex vertex{};
+                vertex.position = { static_cast<float>(x), 0.f, static_cast<float>(y) };
+                vertex.color = glm::vec3{ 1.f };
+                vertex.normal = { 0.f, -1.f, 0.f };
+                vertex.uv = { x / static_cast<float>(size), y / static_cast<float>(size) };
+                return vertex;
+            };
+
+            std::vector<Model::Vertex> stream;
+            stream.reserve(static_cast<size_t>(size) * size * 6);
+            for (int y = 0; y < size; y++) {
+                for (int x = 0; x < size; x++) {
+                    stream.push_back(vertexAt(x, y));
+                    stream.push_back(vertexAt(x + 1, y));
+                    stream.push_back(vertexAt(x, y + 1));
+                    stream.push_back(vertexAt(x + 1, y));
+                    stream.push_back(vertexAt(x + 1, y + 1));
+                    stream.push_back(vertexAt(x, y + 1));
+                }
+            }
+            return stream;
+        }
+    }
+
+    void benchTransformMat4(BenchState& state) {
+        auto transforms = randomTransforms(static_cast<size_t>(state.getArg()));
+        state.setItemsPerIteration(transforms.size());
+        while (state.keepRunning()) {
+            for (const auto& transform : transforms) {
+                glm::mat4 matrix = transform.mat4();
+                doNotOptimize(matrix);
+            }
+        }
+    }
+    GRAPE_BENCHMARK_ARGS("TransformComponent::mat4", benchTransformMat4, 1024, 16384);
+
+    void benchVertexHash(BenchState& state) {
+        auto stream = gridVertexStream(static_cast<int>(state.getArg()));
+        std::hash<Model::Vertex> hasher;
+        state.setItemsPerIteration(stream.size());
+        while (state.keepRunning()) {
+            for (const auto& vertex : stream) {
+                size_t hash = hasher(vertex);
+                doNotOptimize(hash);
+            }
+        }
+    }
+    GRAPE_BENCHMARK_ARGS("hashCombine/Vertex", benchVertexHash, 64, 256);
+
+    // The dedup loop of Model::Builder::loadModel on its own, without the OBJ parse or uploads
+    void benchVertexDedup(BenchState& state) {
+        auto stream = gridVertexStream(static_cast<int>(state.getArg()));
+        state.setItemsPerIteration(stream.size());
+        while (state.keepRunning()) {
+            std::unordered_map<Model::Vertex, uint32_t> uniqueVertices;
+            std::vector<uint32_t> indices;
+            indices.reserve(stream.size());
+            for (const auto& vertex : stream) {
+                auto [it, inserted] = uniqueVertices.emplace(vertex, static_cast<uint32_t>(uniqueVertices.size()));
+                indices.push_back(it->second);
+            }
+            doNotOptimize(indices.data());
+        }
+    }
+    GRAPE_BENCHMARK_ARGS("hashCombine/VertexDedup", benchVertexDedup, 64, 256);
+
+    void benchCollectUniqueTexturePaths(BenchState& state) {
+        Device* device = getBenchDevice();
+        if (!device) {
+            state.skip("no Vulkan device");
+            return;
+        }
+
+        // Models only hold a reference to the device until they upload something, these don't.
+        // 64 distinct textures shared round robin by arg objects, a handful each
+        const size_t objectCount = static_cast<size_t>(state.getArg());
+        GameObject::Map gameObjects;
+        for (size_t i = 0; i < objectCount; i++) {
+            Model::Builder builder;
+            for (size_t t = 0; t < 4; t++) {
+                builder.texturePaths.push_back("resources/textures/material_" + std::to_string((i * 4 + t) % 64) + ".png");
+            }
+
+            auto obj = GameObject::createGameObject();
+            obj.model = std::make_shared<Model>(*device, builder);
+            gameObjects.emplace(obj.getId(), std::move(obj));
+        }
+
+        state.setItemsPerIteration(objectCount);
+        while (state.keepRunning()) {
+            auto paths = GameObjectLoader::collectUniqueTexturePaths(gameObjects);
+            doNotOptimize(paths.data());
+        }
+    }
+    GRAPE_BENCHMARK_ARGS("GameObjectLoader::collectUniqueTexturePaths", benchCollectUniqueTexturePaths, 256, 4096);
+}
@@ -0,0 +1,96 @@
+#include "bench.hpp"
+#include "renderer/culling.hpp"
+#include "scene/game_object_loader.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <memory>
+
+namespace grape {
+
+    namespace {
+        // No dynamic bodies, they'd end up in the scene the physics benchmarks time
+        StressSceneSettings stressSettings(uint32_t instances) {
+            StressSceneSettings settings{};
+            settings.enabled = true;
+            settings.instances = instances;
+            settings.dynamicBodies = 0;
+            return settings;
+        }
+
+        // The last generated scene, so repetitions don't regenerate a million objects each time
+        struct CachedStressScene {
+            uint32_t instances = 0;
+            std::unique_ptr<GameObjectLoader> loader;
+            GameObject::Map gameObjects;
+        };
+
+        GameObject::Map& getStressScene(Device& device, uint32_t instances) {
+            static CachedStressScene cache;
+            if (!cache.loader || cache.instances != instances) {
+                cache.gameObjects.clear();
+                cache.loader = std::make_unique<GameObjectLoader>();
+                cache.loader->loadStressScene(device, getBenchPhysics(), cache.gameObjects, stressSettings(instances));
+                cache.instances = instances;
+            }
+            return cache.gameObjects;
+        }
+    }
+
+    // Meshes, textures and N game objects. Tearing the scene down isn't timed
+    void benchStressSceneLoad(BenchState& state) {
+        Device* device = getBenchDevice();
+        if (!device) {
+            state.skip("no Vulkan device");
+            return;
+        }
+
+        const uint32_t instances = static_cast<uint32_t>(state.getArg());
+        state.setItemsPerIteration(instances);
+        while (state.keepRunning()) {
+            auto loader = std::make_unique<GameObjectLoader>();
+            auto gameObjects = std::make_unique<GameObject::Map>();
+            loader->loadStressScene(*device, getBenchPhysics(), *gameObjects, stressSettings(instances));
+
+            state.pauseTiming();
+            gameObjects.reset();
+            loader.reset();
+            state.resumeTiming();
+        }
+    }
+    GRAPE_BENCHMARK_ARGS("StressScene::load", benchStressSceneLoad, 1000, 10000, 100000);
+
+    // The per-object part of SimpleRenderSystem's culling (model matrix, world bounds, frustum
+    // test) on one thread, from a camera at the edge of the grid looking across it
+    void benchStressSceneFrustumCull(BenchState& state) {
+        Device* device = getBenchDevice();
+        if (!device) {
+            state.skip("no Vulkan device");
+            return;
+        }
+
+        const uint32_t instances = static_cast<uint32_t>(state.getArg());
+        const auto& gameObjects = getStressScene(*device, instances);
+
+        const float halfWidth = std::sqrt(static_cast<float>(instances)) * stressSettings(instances).spacing * 0.5f;
+        glm::mat4 projection = glm::perspective(glm::radians(50.f), 16.f / 9.f, 0.1f, 1000.f);
+        glm::mat4 view = glm::lookAt(glm::vec3(0.f, -10.f, -halfWidth), glm::vec3(0.f, 0.f, 0.f), glm::vec3(0.f, -1.f, 0.f));
+        const Frustum frustum(projection * view);
+
+        state.setItemsPerIteration(gameObjects.size());
+        while (state.keepRunning()) {
+            uint32_t visible = 0;
+            for (const auto& [id, obj] : gameObjects) {
+                if (!obj.model) continue;
+
+                glm::vec3 localMin, localMax, worldMin, worldMax;
+                obj.model->getBoundingBox(localMin, localMax);
+                transformBounds(obj.transform.mat4(), localMin, localMax, worldMin, worldMax);
+                if (frustum.intersectsBox(worldMin, worldMax)) visible++;
+            }
+            doNotOptimize(visible);
+        }
+    }
+    GRAPE_BENCHMARK_ARGS("StressScene::frustumCull", benchStressSceneFrustumCull, 1000, 100000, 1000000);
+}
@@ -19,14 +19,12 @@ for %%f in ("%SHADER_DIR%\*.vert" "%SHADER_DIR%\*.frag" "%SHADER_DIR%\*.comp" "%
         set "SOURCE_FILE=%%f"
         set "OUTPUT_FILE=%%f.spv"
         
-        :: Check if output exists and is newer than source
+        :: Compile unless the output exists and is newer than the source. dir sorts the two by
+        :: date, the last one listed is the newest (comparing %%~t strings breaks on most locales)
         set NEEDS_COMPILE=1
         if exist "!OUTPUT_FILE!" (
-            for %%A in ("!SOURCE_FILE!") do set SOURCE_TIME=%%~tA
-            for %%B in ("!OUTPUT_FILE!") do set OUTPUT_TIME=%%~tB
-            
-            :: Simple time comparison (this is basic, but works for most cases)
-            if "!OUTPUT_TIME!" GEQ "!SOURCE_TIME!" (
+            for /f "delims=" %%N in ('dir /b /o:d "!SOURCE_FILE!" "!OUTPUT_FILE!"') do set NEWEST=%%N
+            if /i "!NEWEST!"=="%%~nxf.spv" (
                 set NEEDS_COMPILE=0
             )
         )
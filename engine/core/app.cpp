@@ -1,24 +1,64 @@
 #include "app.hpp"
+#include "profiler.hpp"
+#include "memory_tracker.hpp"
+#include "perf_counters.hpp"
+#include "hitch_detector.hpp"
+#include "startup_graph.hpp"
 #include "ui/ui.hpp"
 #include "renderer/frame_info.hpp"
 
 #include <stdexcept>
 #include <iostream>
+#include <thread>
 
 namespace grape {
     App::App() {
+        // Window, device and renderer are members, they have to come up in order on the main thread
+        StartupGraph startup{ "App" };
+        auto coreSystems = startup.addMeasured("Window, Device, Renderer", constructionStartNs, Profiler::now());
+
         // Initialize managers
-        sceneManager = std::make_unique<SceneManager>(grapeDevice, physics);
-        resourceManager = std::make_unique<ResourceManager>(grapeDevice);
-        cameraController = std::make_unique<CameraController>();
+        {
+            GRAPE_MEMORY_SCOPE(MemoryTag::Scene);
+            sceneManager = std::make_unique<SceneManager>(grapeDevice, physics);
+            cameraController = std::make_unique<CameraController>();
+        }
 
-        // Load scene and setup resources
-        sceneManager->loadScene();
-        resourceManager->setupDescriptors(sceneManager->getGameObjects(), sceneManager->getLoader());
+        // A recording has to replay to the same scene, so the simulation steps with the frames
+        // instead of in real time for the whole session
+        const auto& captureSettings = InputCaptureSettings::getInstance();
+        if (!captureSettings.recordFile.empty()) {
+            inputRecorder = std::make_unique<InputRecorder>(captureSettings.recordFile);
+            sceneManager->setDeterministic(true);
+        }
 
-        // Initialize render manager after resources are set up
-        renderManager = std::make_unique<RenderManager>(grapeDevice, grapeRenderer,
-            resourceManager->getGlobalSetLayout()->getDescriptorSetLayout());
+        const auto& telemetrySettings = TelemetrySettings::getInstance();
+        if (!telemetrySettings.file.empty() || telemetrySettings.udpPort != 0) {
+            telemetry = std::make_unique<Telemetry>(telemetrySettings);
+        }
+        if (!HitchSettings::getInstance().directory.empty()) {
+            hitchDetector = std::make_unique<HitchDetector>(HitchSettings::getInstance());
+        }
+
+        // Physics, asset loads and pipeline creation don't need each other, only the scene build
+        // waits on physics and the descriptors on the scene
+        auto physicsInit = startup.add("Physics Init", [this]() { physics.init(); }, { coreSystems });
+        auto resources = startup.add("Resource Manager", [this]() {
+            GRAPE_MEMORY_SCOPE(MemoryTag::Renderer);
+            resourceManager = std::make_unique<ResourceManager>(grapeDevice);
+        }, { coreSystems });
+        startup.add("Render Manager", [this]() {
+            GRAPE_MEMORY_SCOPE(MemoryTag::Renderer);
+            renderManager = std::make_unique<RenderManager>(grapeDevice, grapeRenderer.getSwapChainRenderPass(),
+                grapeRenderer.getCommandPools(), resourceManager->getGlobalSetLayout()->getDescriptorSetLayout());
+        }, { resources });
+        auto scene = sceneManager->addLoadTasks(startup, { coreSystems }, { physicsInit });
+        startup.add("Descriptors", [this]() {
+            resourceManager->setupDescriptors(sceneManager->getGameObjects(), sceneManager->getLoader());
+        }, { scene, resources });
+
+        startup.run();
+        startup.printReport();
 
         currentTime = std::chrono::high_resolution_clock::now();
     }
@@ -60,6 +100,8 @@ namespace grape {
     }
 
     void App::run() {
+        GRAPE_PROFILE_THREAD("Main");
+
         // Initialize UI
         UI::init(
             grapeWindow.getGLFWwindow(),
@@ -72,9 +114,30 @@ namespace grape {
         );
 
         UI::setGameObjects(&sceneManager->getGameObjects());
+        UI::setRenderer(&grapeRenderer);
+        UI::setSimulation(sceneManager->getSimulation());
 
         while (!grapeWindow.shoudClose()) {
-            glfwPollEvents();
+            GRAPE_PROFILE_FRAME();
+            MemoryTracker::getInstance().update();
+            // Last frame's counters, now that its zones have been drained too
+            if (telemetry) {
+                telemetry->publish(PerfCounters::getInstance().getLastFrame());
+            }
+            if (hitchDetector) {
+                hitchDetector->onFrame(PerfCounters::getInstance().getLastFrame());
+            }
+
+            // Sleep before sampling input so the limiter doesn't add to input latency
+            waitForFrameSlot();
+            auto workStart = std::chrono::steady_clock::now();
+
+            {
+                GRAPE_PROFILE_SCOPE("Poll Events");
+                glfwPollEvents();
+            }
+            grapeRenderer.markInputSampled();
+            grapeRenderer.applyFramePacingSettings(FramePacingSettings::getInstance());
 
             // Update timing
             auto newTime = std::chrono::high_resolution_clock::now();
@@ -86,27 +149,83 @@ namespace grape {
                 continue;
             }
 
+            FrameInput input = FrameInput::sample(grapeWindow.getGLFWwindow(), frameTime);
+            if (inputRecorder) {
+                inputRecorder->write(input);
+            }
+
             // Update systems
-            cameraController->update(grapeWindow.getGLFWwindow(), frameTime, grapeRenderer.getAspectRatio());
-            sceneManager->updateScene(frameTime, grapeWindow.getGLFWwindow());
+            {
+                GRAPE_PROFILE_SCOPE("Camera Update");
+                cameraController->update(input, grapeRenderer.getAspectRatio());
+            }
+            sceneManager->updateScene(input);
 
             updateViewport();
             renderFrame();
+
+            float cpuMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - workStart).count() - acquireMs;
+            PerfCounters::getInstance().endFrame(frameTime * 1000.f, cpuMs, static_cast<float>(GpuProfileStats::getInstance().frameMs));
         }
 
+        sceneManager->stopSimulation();
         vkDeviceWaitIdle(grapeDevice.device());
+
+        if (inputRecorder) {
+            std::cout << "Recorded " << inputRecorder->getFrameCount() << " frames of input to "
+                << InputCaptureSettings::getInstance().recordFile << std::endl;
+        }
+    }
+
+    void App::waitForFrameSlot() {
+        GRAPE_PROFILE_FUNCTION();
+        int frameRateLimit = FramePacingSettings::getInstance().frameRateLimit;
+        if (frameRateLimit <= 0) {
+            nextFrameSlot = {};
+            return;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        auto framePeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / frameRateLimit));
+
+        // Fell behind (or limiter just turned on), don't try to catch up
+        if (nextFrameSlot.time_since_epoch().count() == 0 || now - nextFrameSlot > framePeriod) {
+            nextFrameSlot = now;
+        }
+
+        // OS sleep is too coarse to hit the slot exactly, so sleep most of the way and spin the rest
+        constexpr auto spinMargin = std::chrono::milliseconds(1);
+        if (nextFrameSlot - now > spinMargin) {
+            std::this_thread::sleep_until(nextFrameSlot - spinMargin);
+        }
+        while (std::chrono::steady_clock::now() < nextFrameSlot) {
+            std::this_thread::yield();
+        }
+
+        nextFrameSlot += framePeriod;
     }
 
     void App::updateViewport() {
+        GRAPE_PROFILE_FUNCTION();
+
         if (needsViewportResize) {
+            uint64_t start = Profiler::now();
             vkDeviceWaitIdle(grapeDevice.device());
             viewportExtent = pendingViewportExtent;
+            GRAPE_MEMORY_SCOPE(MemoryTag::Renderer);
             viewportRenderer->resize(viewportExtent);
             needsViewportResize = false;
+            HitchEvents::record("Viewport Resize",
+                std::to_string(viewportExtent.width) + "x" + std::to_string(viewportExtent.height), start, Profiler::now());
         }
 
-        UI::beginFrame();
-        UI::renderUI();
+        {
+            GRAPE_PROFILE_SCOPE("UI Build");
+            GRAPE_MEMORY_SCOPE(MemoryTag::UI);
+            UI::beginFrame();
+            UI::renderUI();
+        }
 
         ImVec2 viewportPanelSize = UI::getViewportPanelSize();
         uint32_t newWidth = 0;
@@ -120,6 +239,7 @@ namespace grape {
 
         if (!viewportRenderer && newWidth > 0 && newHeight > 0) {
             try {
+                GRAPE_MEMORY_SCOPE(MemoryTag::Renderer);
                 viewportExtent = { newWidth, newHeight };
                 viewportRenderer = std::make_unique<ViewportRenderer>(grapeDevice, viewportExtent);
             }
@@ -136,7 +256,18 @@ namespace grape {
     }
 
     void App::renderFrame() {
-        if (auto commandBuffer = grapeRenderer.beginFrame()) {
+        GRAPE_PROFILE_FUNCTION();
+        GRAPE_MEMORY_SCOPE(MemoryTag::Renderer);
+
+        VkCommandBuffer commandBuffer;
+        {
+            GRAPE_PROFILE_SCOPE("Acquire");
+            auto acquireStart = std::chrono::steady_clock::now();
+            commandBuffer = grapeRenderer.beginFrame();
+            acquireMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - acquireStart).count();
+        }
+
+        if (commandBuffer) {
             int frameIndex = grapeRenderer.getFrameIndex();
 
             FrameInfo frameInfo{
@@ -150,6 +281,7 @@ namespace grape {
                     return sceneManager->getLoader().getTextureDescriptorIndex(texturePath);
                 }
             };
+            frameInfo.gpuProfiler = &grapeRenderer.getGpuProfiler();
 
             // Update UBO
             GlobalUbo ubo{};
@@ -157,23 +289,29 @@ namespace grape {
             ubo.view = cameraController->getCamera().getView();
             ubo.inverseView = cameraController->getCamera().getInverseView();
 
-            renderManager->updateLights(frameInfo, ubo);
+            renderManager->updateLights(frameInfo);
             resourceManager->updateUBO(frameIndex, ubo);
 
             // Render to viewport
             renderManager->render(frameInfo, viewportRenderer, needsViewportResize);
 
             // Render to swap chain
-            grapeRenderer.beginSwapChainRenderPass(commandBuffer);
-
-            UI::renderViewport(
-                viewportRenderer ? viewportRenderer->getImGuiDescriptorSet(frameIndex) : VK_NULL_HANDLE,
-                viewportRenderer && !needsViewportResize,
-                needsViewportResize
-            );
+            {
+                GRAPE_PROFILE_SCOPE("UI Record");
+                GpuZone gpuZone{ frameInfo.gpuProfiler, commandBuffer, static_cast<uint32_t>(frameIndex), "UI" };
+                grapeRenderer.beginSwapChainRenderPass(commandBuffer);
+
+                UI::renderViewport(
+                    viewportRenderer ? viewportRenderer->getImGuiDescriptorSet(frameIndex) : VK_NULL_HANDLE,
+                    viewportRenderer && !needsViewportResize,
+                    needsViewportResize
+                );
+
+                UI::renderDrawData(commandBuffer);
+                grapeRenderer.endSwapChainRenderPass(commandBuffer);
+            }
 
-            UI::renderDrawData(commandBuffer);
-            grapeRenderer.endSwapChainRenderPass(commandBuffer);
+            GRAPE_PROFILE_SCOPE("Submit");
             grapeRenderer.endFrame();
         }
     }
@@ -1,5 +1,9 @@
 #pragma once
 #include "window.hpp"
+#include "frame_input.hpp"
+#include "telemetry.hpp"
+#include "hitch_detector.hpp"
+#include "profiler.hpp"
 #include "renderer/device.hpp"
 #include "renderer/renderer.hpp"
 #include "renderer/viewport_renderer.hpp"
@@ -31,6 +35,10 @@ namespace grape {
     private:
         void updateViewport();
         void renderFrame();
+        void waitForFrameSlot();
+
+        // Before the core systems, so the startup report can time their construction
+        uint64_t constructionStartNs = Profiler::now();
 
         // Core systems
         Window grapeWindow{ WIDTH, HEIGHT, "Grape Engine" };
@@ -44,6 +52,13 @@ namespace grape {
         std::unique_ptr<CameraController> cameraController;
         std::unique_ptr<RenderManager> renderManager;
 
+        // Set with --record, every frame's input goes to it
+        std::unique_ptr<InputRecorder> inputRecorder;
+        // Set with --telemetry/--telemetry-udp
+        std::unique_ptr<Telemetry> telemetry;
+        // Set with --hitch-capture
+        std::unique_ptr<HitchDetector> hitchDetector;
+
         // Viewport management
         std::unique_ptr<ViewportRenderer> viewportRenderer;
         VkExtent2D viewportExtent = { 1280, 720 };
@@ -52,6 +67,8 @@ namespace grape {
 
         // Timing
         std::chrono::high_resolution_clock::time_point currentTime;
+        std::chrono::steady_clock::time_point nextFrameSlot{};
         float frameTime = 0.0f;
+        float acquireMs = 0.0f;     // Waiting on the frame's fence and the swapchain, not CPU work
     };
 }
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "frame_input.hpp"
+
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+namespace grape {
+
+    namespace {
+        constexpr char MAGIC[4] = { 'G', 'R', 'F', 'I' };
+        constexpr uint32_t VERSION = 1;
+        constexpr size_t RECORD_SIZE = 4 + 4 + 1 + 8 + 8;
+
+        void putBytes(uint8_t*& out, uint64_t value, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                *out++ = static_cast<uint8_t>(value >> (8 * i));
+            }
+        }
+
+        uint64_t getBytes(const uint8_t*& in, size_t count) {
+            uint64_t value = 0;
+            for (size_t i = 0; i < count; i++) {
+                value |= static_cast<uint64_t>(*in++) << (8 * i);
+            }
+            return value;
+        }
+
+        template <typename T, typename Bits>
+        Bits toBits(T value) {
+            static_assert(sizeof(T) == sizeof(Bits), "size mismatch");
+            Bits bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        template <typename T, typename Bits>
+        T fromBits(Bits bits) {
+            T value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+    }
+
+    FrameInput FrameInput::sample(GLFWwindow* window, float frameTime) {
+        FrameInput input{};
+        input.frameTime = frameTime;
+        if (window == nullptr) return input;
+
+        for (size_t i = 0; i < std::size(TRACKED_KEYS); i++) {
+            if (glfwGetKey(window, TRACKED_KEYS[i]) == GLFW_PRESS) input.keys |= 1u << i;
+        }
+        for (int button = 0; button < TRACKED_MOUSE_BUTTONS; button++) {
+            if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_1 + button) == GLFW_PRESS) input.mouseButtons |= 1u << button;
+        }
+        glfwGetCursorPos(window, &input.cursorX, &input.cursorY);
+        return input;
+    }
+
+    bool FrameInput::isKeyDown(int key) const {
+        for (size_t i = 0; i < std::size(TRACKED_KEYS); i++) {
+            if (TRACKED_KEYS[i] == key) return (keys >> i) & 1u;
+        }
+        return false;
+    }
+
+    bool FrameInput::isMouseButtonDown(int button) const {
+        int index = button - GLFW_MOUSE_BUTTON_1;
+        return index >= 0 && index < TRACKED_MOUSE_BUTTONS && ((mouseButtons >> index) & 1u);
+    }
+
+    InputRecorder::InputRecorder(const std::string& path) : file{ path, std::ios::binary } {
+        if (!file) {
+            throw std::runtime_error("failed to create input recording " + path + "!");
+        }
+
+        uint8_t header[8];
+        std::memcpy(header, MAGIC, sizeof(MAGIC));
+        uint8_t* out = header + sizeof(MAGIC);
+        putBytes(out, VERSION, 4);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    }
+
+    void InputRecorder::write(const FrameInput& input) {
+        uint8_t record[RECORD_SIZE];
+        uint8_t* out = record;
+        putBytes(out, toBits<float, uint32_t>(input.frameTime), 4);
+        putBytes(out, input.keys, 4);
+        putBytes(out, input.mouseButtons, 1);
+        putBytes(out, toBits<double, uint64_t>(input.cursorX), 8);
+        putBytes(out, toBits<double, uint64_t>(input.cursorY), 8);
+        file.write(reinterpret_cast<const char*>(record), sizeof(record));
+        frameCount++;
+    }
+
+    std::vector<FrameInput> loadInputRecording(const std::string& path) {
+        std::ifstream file{ path, std::ios::binary };
+        if (!file) {
+            throw std::runtime_error("failed to open input recording " + path + "!");
+        }
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        const uint8_t* in = data.data();
+        if (data.size() < 8 || std::memcmp(in, MAGIC, sizeof(MAGIC)) != 0) {
+            throw std::runtime_error(path + " is not an input recording!");
+        }
+        in += sizeof(MAGIC);
+        if (getBytes(in, 4) != VERSION) {
+            throw std::runtime_error("unsupported input recording version in " + path + "!");
+        }
+
+        // A session that crashed mid-write can leave half a record, drop it
+        std::vector<FrameInput> frames((data.size() - 8) / RECORD_SIZE);
+        for (auto& input : frames) {
+            input.frameTime = fromBits<float>(static_cast<uint32_t>(getBytes(in, 4)));
+            input.keys = static_cast<uint32_t>(getBytes(in, 4));
+            input.mouseButtons = static_cast<uint8_t>(getBytes(in, 1));
+            input.cursorX = fromBits<double>(getBytes(in, 8));
+            input.cursorY = fromBits<double>(getBytes(in, 8));
+        }
+        return frames;
+    }
+}
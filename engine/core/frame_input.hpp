@@ -0,0 +1,67 @@
+#pragma once
+
+#include "window.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace grape {
+
+    // Everything a frame reads from GLFW, sampled once on the main thread. The camera and the
+    // simulation only look at this, so a recorded stream of them replays the same frames
+    struct FrameInput {
+        // Keys anything in the engine reacts to, a bit each in keys. Append only, the order is
+        // the recording format
+        static constexpr int TRACKED_KEYS[] = {
+            GLFW_KEY_W, GLFW_KEY_A, GLFW_KEY_S, GLFW_KEY_D, GLFW_KEY_E, GLFW_KEY_Q,
+            GLFW_KEY_LEFT, GLFW_KEY_RIGHT, GLFW_KEY_UP, GLFW_KEY_DOWN,
+            GLFW_KEY_I, GLFW_KEY_J, GLFW_KEY_K, GLFW_KEY_L
+        };
+        static constexpr int TRACKED_MOUSE_BUTTONS = 3;
+
+        float frameTime = 0.f;
+        uint32_t keys = 0;
+        uint8_t mouseButtons = 0;
+        double cursorX = 0.0;
+        double cursorY = 0.0;
+
+        static FrameInput sample(GLFWwindow* window, float frameTime);
+
+        // Keys outside TRACKED_KEYS are never down
+        bool isKeyDown(int key) const;
+        bool isMouseButtonDown(int button) const;
+    };
+
+    // Where --record writes the live session's input, empty for none
+    struct InputCaptureSettings {
+        std::string recordFile;
+
+        static InputCaptureSettings& getInstance() {
+            static InputCaptureSettings instance;
+            return instance;
+        }
+    };
+
+    // Input log: an 8 byte header ("GRFI" and a version) followed by one 25 byte little-endian
+    // record a frame (frame time, key bits, mouse button bits, cursor x and y as doubles)
+    class InputRecorder {
+    public:
+        // Throws if the file can't be created
+        explicit InputRecorder(const std::string& path);
+
+        InputRecorder(const InputRecorder&) = delete;
+        InputRecorder& operator=(const InputRecorder&) = delete;
+
+        void write(const FrameInput& input);
+        uint32_t getFrameCount() const { return frameCount; }
+
+    private:
+        std::ofstream file;
+        uint32_t frameCount = 0;
+    };
+
+    // Throws if the file is missing or not an input log
+    std::vector<FrameInput> loadInputRecording(const std::string& path);
+}
@@ -0,0 +1,361 @@
+#include "headless_app.hpp"
+#include "job_system.hpp"
+#include "png_writer.hpp"
+#include "profiler.hpp"
+#include "memory_tracker.hpp"
+#include "perf_counters.hpp"
+#include "startup_graph.hpp"
+#include "renderer/renderer.hpp"
+#include "renderer/frame_info.hpp"
+#include "systems/simple_render_system.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+
+namespace grape {
+    HeadlessApp::HeadlessApp(const HeadlessSettings& settings) : settings{ settings } {
+        StartupGraph startup{ "Headless" };
+        auto coreSystems = startup.addMeasured("Device", constructionStartNs, Profiler::now());
+        framesInFlight = static_cast<uint32_t>(
+            std::clamp(FramePacingSettings::getInstance().framesInFlight, 1, SwapChain::MAX_FRAMES_IN_FLIGHT));
+
+        {
+            GRAPE_MEMORY_SCOPE(MemoryTag::Scene);
+            sceneManager = std::make_unique<SceneManager>(grapeDevice, physics);
+            cameraController = std::make_unique<CameraController>();
+        }
+
+        if (!settings.replayFile.empty()) {
+            replayFrames = loadInputRecording(settings.replayFile);
+            if (replayFrames.empty()) {
+                throw std::runtime_error("input recording " + settings.replayFile + " has no frames!");
+            }
+
+            // The recording decides the length, the warmup comes out of it (settings is the
+            // constructor argument here, this->settings the copy the run uses)
+            const uint32_t recorded = static_cast<uint32_t>(replayFrames.size());
+            this->settings.warmupFrames = std::min(settings.warmupFrames, recorded - 1);
+            this->settings.frames = recorded - this->settings.warmupFrames;
+            sceneManager->setDeterministic(true);
+        }
+
+        const auto& telemetrySettings = TelemetrySettings::getInstance();
+        if (!telemetrySettings.file.empty() || telemetrySettings.udpPort != 0) {
+            telemetry = std::make_unique<Telemetry>(telemetrySettings);
+        }
+        if (!HitchSettings::getInstance().directory.empty()) {
+            hitchDetector = std::make_unique<HitchDetector>(HitchSettings::getInstance());
+        }
+
+        uint32_t threadCount = JobSystem::getInstance().getWorkerCount() + 1;
+        commandPools = std::make_unique<ThreadCommandPools>(grapeDevice, SwapChain::MAX_FRAMES_IN_FLIGHT, threadCount);
+        gpuProfiler = std::make_unique<GpuProfiler>(grapeDevice, SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+        // Same graph as the App, so a headless run times the startup the editor would have
+        auto physicsInit = startup.add("Physics Init", [this]() { physics.init(); }, { coreSystems });
+        auto resources = startup.add("Resource Manager", [this]() {
+            GRAPE_MEMORY_SCOPE(MemoryTag::Renderer);
+            resourceManager = std::make_unique<ResourceManager>(grapeDevice);
+        }, { coreSystems });
+        startup.add("Render Manager", [this]() {
+            GRAPE_MEMORY_SCOPE(MemoryTag::Renderer);
+            // The pipelines are built against the viewport pass itself, there is no swapchain pass
+            viewportRenderer = std::make_unique<ViewportRenderer>(grapeDevice, this->settings.extent, false);
+            renderManager = std::make_unique<RenderManager>(grapeDevice, viewportRenderer->getRenderPass(), *commandPools,
+                resourceManager->getGlobalSetLayout()->getDescriptorSetLayout());
+        }, { resources });
+        auto scene = sceneManager->addLoadTasks(startup, { coreSystems }, { physicsInit });
+        startup.add("Descriptors", [this]() {
+            resourceManager->setupDescriptors(sceneManager->getGameObjects(), sceneManager->getLoader());
+        }, { scene, resources });
+
+        startup.run();
+        startup.printReport();
+
+        createSyncObjects();
+        pendingDumps.assign(framesInFlight, -1);
+
+        if (!settings.dumpDir.empty()) {
+            std::filesystem::create_directories(settings.dumpDir);
+        }
+    }
+
+    HeadlessApp::~HeadlessApp() {
+        vkDeviceWaitIdle(grapeDevice.device());
+
+        for (auto fence : inFlightFences) {
+            vkDestroyFence(grapeDevice.device(), fence, nullptr);
+        }
+        inFlightFences.clear();
+    }
+
+    void HeadlessApp::createSyncObjects() {
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+        inFlightFences.resize(framesInFlight, VK_NULL_HANDLE);
+        for (auto& fence : inFlightFences) {
+            if (vkCreateFence(grapeDevice.device(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create headless frame fence!");
+            }
+        }
+    }
+
+    void HeadlessApp::run() {
+        const uint32_t totalFrames = settings.warmupFrames + settings.frames;
+        std::cout << "Headless: rendering " << totalFrames << " frames (" << settings.warmupFrames << " warmup) at "
+            << settings.extent.width << "x" << settings.extent.height << ", " << framesInFlight << " in flight" << std::endl;
+
+        frameTimesMs.clear();
+        cpuTimesMs.clear();
+        gpuTimesMs.clear();
+        latestGpuTimesMs.clear();
+        frameTimesMs.reserve(settings.frames);
+        cpuTimesMs.reserve(settings.frames);
+        gpuTimesMs.reserve(settings.frames);
+        latestGpuTimesMs.reserve(settings.frames);
+
+        const auto& gpuStats = GpuProfileStats::getInstance();
+        uint64_t lastResolvedFrame = gpuStats.resolvedFrames;
+
+        GRAPE_PROFILE_THREAD("Main");
+
+        auto lastFrameStart = std::chrono::steady_clock::now();
+        for (uint32_t frameNumber = 0; frameNumber < totalFrames; frameNumber++) {
+            GRAPE_PROFILE_FRAME();
+            MemoryTracker::getInstance().update();
+            // Last frame's counters, now that its zones have been drained too
+            if (telemetry) {
+                telemetry->publish(PerfCounters::getInstance().getLastFrame());
+            }
+            if (hitchDetector) {
+                hitchDetector->onFrame(PerfCounters::getInstance().getLastFrame());
+            }
+            uint32_t frameIndex = frameNumber % framesInFlight;
+
+            {
+                GRAPE_PROFILE_SCOPE("Wait For Fence");
+                vkWaitForFences(grapeDevice.device(), 1, &inFlightFences[frameIndex], VK_TRUE, UINT64_MAX);
+            }
+            auto frameStart = std::chrono::steady_clock::now();
+
+            if (pendingDumps[frameIndex] >= 0) {
+                dumpFrame(frameIndex, static_cast<uint32_t>(pendingDumps[frameIndex]));
+                pendingDumps[frameIndex] = -1;
+            }
+
+            auto cpuStart = std::chrono::steady_clock::now();
+            renderFrame(frameIndex, frameNumber);
+            auto cpuEnd = std::chrono::steady_clock::now();
+
+            PerfCounters::getInstance().endFrame(
+                std::chrono::duration<float, std::milli>(frameStart - lastFrameStart).count(),
+                std::chrono::duration<float, std::milli>(cpuEnd - cpuStart).count(),
+                static_cast<float>(gpuStats.frameMs));
+
+            if (frameNumber >= settings.warmupFrames) {
+                frameTimesMs.push_back(std::chrono::duration<float, std::milli>(frameStart - lastFrameStart).count());
+                cpuTimesMs.push_back(std::chrono::duration<float, std::milli>(cpuEnd - cpuStart).count());
+
+                // Resolved while recording this frame, but it's one from framesInFlight frames ago
+                if (gpuStats.resolvedFrames != lastResolvedFrame) {
+                    gpuTimesMs.push_back(static_cast<float>(gpuStats.frameMs));
+                }
+                latestGpuTimesMs.push_back(static_cast<float>(gpuStats.frameMs));
+            }
+            lastResolvedFrame = gpuStats.resolvedFrames;
+            lastFrameStart = frameStart;
+        }
+
+        vkDeviceWaitIdle(grapeDevice.device());
+        for (uint32_t i = 0; i < framesInFlight; i++) {
+            if (pendingDumps[i] >= 0) {
+                dumpFrame(i, static_cast<uint32_t>(pendingDumps[i]));
+                pendingDumps[i] = -1;
+            }
+        }
+
+        GRAPE_PROFILE_FRAME();
+        if (telemetry) {
+            telemetry->publish(PerfCounters::getInstance().getLastFrame());
+        }
+        sceneManager->stopSimulation();
+        printStats();
+        writeFrameLog();
+
+        if (!settings.traceFile.empty() && Profiler::getInstance().exportChromeTrace(settings.traceFile)) {
+            std::cout << "Headless: wrote the last " << Profiler::getInstance().getFrames().size()
+                << " frames' CPU trace to " << settings.traceFile << std::endl;
+        }
+        if (!settings.memoryReport.empty() && MemoryTracker::getInstance().dumpToFile(settings.memoryReport)) {
+            std::cout << "Headless: wrote the memory report to " << settings.memoryReport << std::endl;
+        }
+    }
+
+    void HeadlessApp::renderFrame(uint32_t frameIndex, uint32_t frameNumber) {
+        GRAPE_PROFILE_FUNCTION();
+        GRAPE_MEMORY_SCOPE(MemoryTag::Renderer);
+
+        VkExtent2D extent = viewportRenderer->getExtent();
+        float aspect = static_cast<float>(extent.width) / static_cast<float>(extent.height);
+
+        FrameInput input = replayFrames.empty() ? FrameInput{ settings.frameTime } : replayFrames[frameNumber];
+        cameraController->update(input, aspect);
+        sceneManager->updateScene(input);
+
+        // The fence above means the GPU is done with everything this slot recorded last time round
+        commandPools->resetFrame(frameIndex);
+        VkCommandBuffer commandBuffer = commandPools->acquirePrimary(frameIndex, commandPools->getCurrentThreadSlot());
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording command buffer!");
+        }
+        gpuProfiler->beginFrame(commandBuffer, frameIndex);
+
+        FrameInfo frameInfo{
+            static_cast<int>(frameIndex),
+            input.frameTime,
+            commandBuffer,
+            cameraController->getCamera(),
+            resourceManager->getGlobalDescriptorSet(frameIndex),
+            sceneManager->getGameObjects(),
+            [this](const std::string& texturePath) -> int {
+                return sceneManager->getLoader().getTextureDescriptorIndex(texturePath);
+            }
+        };
+        frameInfo.gpuProfiler = gpuProfiler.get();
+
+        GlobalUbo ubo{};
+        ubo.projection = cameraController->getCamera().getProjection();
+        ubo.view = cameraController->getCamera().getView();
+        ubo.inverseView = cameraController->getCamera().getInverseView();
+
+        renderManager->updateLights(frameInfo);
+        resourceManager->updateUBO(frameIndex, ubo);
+        renderManager->render(frameInfo, viewportRenderer, false);
+
+        bool dump = !settings.dumpDir.empty() && frameNumber >= settings.warmupFrames &&
+            (frameNumber - settings.warmupFrames) % std::max(settings.dumpEvery, 1u) == 0;
+        if (dump) {
+            viewportRenderer->recordColorReadback(commandBuffer, frameIndex);
+            pendingDumps[frameIndex] = frameNumber;
+        }
+
+        gpuProfiler->endFrame(commandBuffer, frameIndex);
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record command buffer!");
+        }
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        GRAPE_PROFILE_SCOPE("Submit");
+        vkResetFences(grapeDevice.device(), 1, &inFlightFences[frameIndex]);
+        if (vkQueueSubmit(grapeDevice.graphicsQueue(), 1, &submitInfo, inFlightFences[frameIndex]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit draw command buffer!");
+        }
+    }
+
+    void HeadlessApp::dumpFrame(uint32_t frameIndex, uint32_t frameNumber) {
+        GRAPE_PROFILE_FUNCTION();
+
+        const uint8_t* pixels = viewportRenderer->getColorReadback(frameIndex);
+        if (pixels == nullptr) return;
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%05u.png", frameNumber - settings.warmupFrames);
+        std::string path = (std::filesystem::path(settings.dumpDir) / name).string();
+
+        VkExtent2D extent = viewportRenderer->getExtent();
+        try {
+            writePng(path, extent.width, extent.height, pixels);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Failed to dump frame " << frameNumber << ": " << e.what() << std::endl;
+        }
+    }
+
+    void HeadlessApp::printStats() const {
+        if (frameTimesMs.empty()) {
+            std::cout << "Headless: no frames measured" << std::endl;
+            return;
+        }
+
+        auto summarize = [](const char* label, std::vector<float> times) {
+            std::sort(times.begin(), times.end());
+            auto percentile = [&](float p) {
+                size_t index = static_cast<size_t>(p * static_cast<float>(times.size() - 1) + 0.5f);
+                return times[std::min(index, times.size() - 1)];
+            };
+            float average = std::accumulate(times.begin(), times.end(), 0.f) / static_cast<float>(times.size());
+
+            std::cout << std::fixed << std::setprecision(3)
+                << label << " ms: min " << times.front()
+                << "  avg " << average
+                << "  median " << percentile(0.5f)
+                << "  p95 " << percentile(0.95f)
+                << "  p99 " << percentile(0.99f)
+                << "  max " << times.back() << std::endl;
+            return average;
+        };
+
+        std::cout << "Headless: " << frameTimesMs.size() << " frames measured" << std::endl;
+        float averageFrame = summarize("  frame", frameTimesMs);
+        summarize("  cpu  ", cpuTimesMs);
+        if (!gpuTimesMs.empty()) {
+            summarize("  gpu  ", gpuTimesMs);
+        }
+        std::cout << "  fps   " << std::setprecision(1) << (averageFrame > 0.f ? 1000.f / averageFrame : 0.f) << std::endl;
+
+        // What the last frame actually drew, so a stress run's timings can be checked against its size
+        const auto& culling = CullingStats::getInstance();
+        std::cout << "  scene: " << culling.objects << " objects, " << culling.frustumCulled << " frustum and "
+            << culling.occlusionCulled << " occlusion culled, " << culling.submeshDraws << " draws, "
+            << culling.triangles << " triangles" << std::endl;
+
+        // Last resolved frame's passes, a rough breakdown of where the GPU time above goes
+        const auto& gpuStats = GpuProfileStats::getInstance();
+        std::cout << std::setprecision(3);
+        for (const auto& pass : gpuStats.passes) {
+            std::cout << "  gpu pass " << std::string(pass.depth * 2, ' ') << pass.name << ": " << pass.durationMs << " ms" << std::endl;
+        }
+        if (gpuStats.statisticsValid) {
+            const auto& statistics = gpuStats.viewportStatistics;
+            std::cout << "  viewport: " << statistics.inputAssemblyPrimitives << " primitives in, "
+                << statistics.clippingPrimitives << " after clipping, "
+                << statistics.vertexShaderInvocations << " vertex and "
+                << statistics.fragmentShaderInvocations << " fragment invocations" << std::endl;
+        }
+        std::cout << std::defaultfloat;
+    }
+
+    void HeadlessApp::writeFrameLog() const {
+        if (settings.frameLog.empty()) return;
+
+        std::ofstream file{ settings.frameLog };
+        if (!file) {
+            std::cerr << "Headless: failed to write frame log " << settings.frameLog << std::endl;
+            return;
+        }
+
+        // gpu_ms trails by framesInFlight frames, it's whatever the timestamp queries had resolved
+        file << "frame,frame_ms,cpu_ms,gpu_ms\n" << std::fixed << std::setprecision(4);
+        for (size_t i = 0; i < frameTimesMs.size(); i++) {
+            file << i << ',' << frameTimesMs[i] << ',' << cpuTimesMs[i] << ',' << latestGpuTimesMs[i] << '\n';
+        }
+        std::cout << "Headless: wrote " << frameTimesMs.size() << " frame times to " << settings.frameLog << std::endl;
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "renderer/device.hpp"
+#include "renderer/viewport_renderer.hpp"
+#include "renderer/thread_command_pools.hpp"
+#include "renderer/gpu_profiler.hpp"
+
+#include "scene/scene_manager.hpp"
+#include "scene/resource_manager.hpp"
+#include "scene/camera_controller.hpp"
+#include "scene/render_manager.hpp"
+
+#include "systems/physics.hpp"
+
+#include "core/frame_input.hpp"
+#include "core/telemetry.hpp"
+#include "core/hitch_detector.hpp"
+#include "core/profiler.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace grape {
+
+    struct HeadlessSettings {
+        uint32_t frames = 600;
+        uint32_t warmupFrames = 30;     // Rendered but left out of the stats (shadow caches, first uploads)
+        VkExtent2D extent = { 1280, 720 };
+        std::string dumpDir;            // Empty means no PNGs
+        uint32_t dumpEvery = 1;
+        float frameTime = 1.f / 60.f;   // Fixed, so what's on screen doesn't depend on how fast we render
+        std::string traceFile;          // Chrome trace of the last frames' CPU zones, empty for none
+        std::string memoryReport;       // MemoryTracker dump after the last frame, empty for none
+        std::string replayFile;         // Input recording (--record) to play back, sets the frame count and times
+        std::string frameLog;           // CSV of every measured frame's times, for diffing runs frame by frame
+    };
+
+    // Renders the scene straight into the viewport's offscreen images, no window, surface or
+    // swapchain. Meant for CI on software drivers (lavapipe) and for benchmarking, prints
+    // frame time statistics at the end. Physics runs on its own thread in real time, except when
+    // replaying a recording, then it steps in lockstep with the recorded frame times
+    class HeadlessApp {
+    public:
+        HeadlessApp(const HeadlessSettings& settings);
+        ~HeadlessApp();
+
+        HeadlessApp(const HeadlessApp&) = delete;
+        HeadlessApp& operator=(const HeadlessApp&) = delete;
+
+        void run();
+
+    private:
+        void createSyncObjects();
+        void renderFrame(uint32_t frameIndex, uint32_t frameNumber);
+        void dumpFrame(uint32_t frameIndex, uint32_t frameNumber);
+        void printStats() const;
+        void writeFrameLog() const;
+
+        HeadlessSettings settings;
+        uint32_t framesInFlight = 1;
+
+        // Before the device, so the startup report can time its construction
+        uint64_t constructionStartNs = Profiler::now();
+        Device grapeDevice{};
+        Physics physics{};
+
+        std::unique_ptr<SceneManager> sceneManager;
+        std::unique_ptr<ResourceManager> resourceManager;
+        std::unique_ptr<CameraController> cameraController;
+        std::unique_ptr<ThreadCommandPools> commandPools;
+        std::unique_ptr<GpuProfiler> gpuProfiler;
+        std::unique_ptr<ViewportRenderer> viewportRenderer;
+        std::unique_ptr<RenderManager> renderManager;
+
+        std::vector<VkFence> inFlightFences;
+        std::vector<int64_t> pendingDumps;  // Frame number whose color each slot's readback holds, -1 for none
+
+        std::vector<float> frameTimesMs;    // Fence to fence, what a benchmark cares about
+        std::vector<float> cpuTimesMs;      // Update and recording only
+        std::vector<float> gpuTimesMs;      // First to last timestamp of a frame's command buffer
+        std::vector<float> latestGpuTimesMs;    // Per measured frame, the last GPU time resolved by then
+
+        std::vector<FrameInput> replayFrames;
+        // From TelemetrySettings, warmup frames are streamed too
+        std::unique_ptr<Telemetry> telemetry;
+        // From HitchSettings
+        std::unique_ptr<HitchDetector> hitchDetector;
+    };
+}
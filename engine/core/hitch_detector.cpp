@@ -0,0 +1,172 @@
+#include "hitch_detector.hpp"
+#include "profiler.hpp"
+#include "memory_tracker.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+
+namespace grape {
+
+    void HitchEvents::record(const char* name, const std::string& detail, uint64_t startNs, uint64_t endNs) {
+        HitchEvents& instance = getInstance();
+        std::lock_guard<std::mutex> lock(instance.mutex);
+        HitchEvent& event = instance.events[instance.written % CAPACITY];
+        event.startNs = startNs;
+        event.endNs = endNs;
+        event.name = name;
+        std::snprintf(event.detail, sizeof(event.detail), "%s", detail.c_str());
+        instance.written++;
+    }
+
+    std::vector<HitchEvent> HitchEvents::getSince(uint64_t sinceNs) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<HitchEvent> result;
+        uint64_t oldest = written - std::min<uint64_t>(written, CAPACITY);
+        for (uint64_t i = oldest; i < written; i++) {
+            const HitchEvent& event = events[i % CAPACITY];
+            if (event.endNs >= sinceNs) result.push_back(event);
+        }
+        return result;
+    }
+
+    HitchDetector::HitchDetector(const HitchSettings& settings) : settings{ settings } {
+        this->settings.frames = std::clamp<uint32_t>(settings.frames, FRAMES_AFTER + 1, static_cast<uint32_t>(Profiler::FRAME_HISTORY));
+        history.resize(this->settings.frames);
+        std::filesystem::create_directories(settings.directory);
+    }
+
+    void HitchDetector::onFrame(const PerfFrame& frame) {
+        if (frame.frame == 0 || frame.frame == lastFrame) return;
+        lastFrame = frame.frame;
+
+        FrameRecord& record = history[historyNext];
+        historyNext = (historyNext + 1) % history.size();
+        historyCount = std::min(historyCount + 1, history.size());
+
+        record.perf = frame;
+        const Profiler& profiler = Profiler::getInstance();
+        const auto& profileFrames = profiler.getFrames();
+        if (!profileFrames.empty() && !profiler.isPaused()) {
+            record.startNs = profileFrames.back().startNs;
+            record.endNs = profileFrames.back().endNs;
+        }
+        else {
+            record.endNs = Profiler::now();
+            record.startNs = record.endNs - static_cast<uint64_t>(frame.frameMs * 1e6f);
+        }
+        const auto& gpuStats = GpuProfileStats::getInstance();
+        record.gpuPassCount = static_cast<uint32_t>(std::min(gpuStats.passes.size(), record.gpuPasses.size()));
+        std::copy_n(gpuStats.passes.begin(), record.gpuPassCount, record.gpuPasses.begin());
+
+        if (pending.frame != 0) {
+            if (--framesUntilWrite == 0) {
+                writeCapture();
+                captureCount++;
+                pending = {};
+                cooldown = COOLDOWN_FRAMES;
+            }
+            return;
+        }
+        if (cooldown > 0) {
+            cooldown--;
+            return;
+        }
+
+        const auto& perf = PerfCounters::getInstance();
+        if (captureCount >= settings.maxCaptures || perf.getWindowSize() < WARMUP_FRAMES) return;
+
+        float medianMs = perf.getPercentile(PerfSeries::Frame, 0.5f);
+        float budgetMs = std::max(medianMs * settings.medianMultiple, settings.minimumMs);
+        if (frame.frameMs > budgetMs) {
+            pending = { frame.frame, frame.frameMs, medianMs, budgetMs };
+            framesUntilWrite = FRAMES_AFTER;
+        }
+    }
+
+    void HitchDetector::writeCapture() const {
+        char name[64];
+        std::snprintf(name, sizeof(name), "hitch_%llu", static_cast<unsigned long long>(pending.frame));
+        std::filesystem::path base = std::filesystem::path{ settings.directory } / name;
+
+        std::string summaryPath = base.string() + ".txt";
+        std::FILE* file = std::fopen(summaryPath.c_str(), "w");
+        if (!file) {
+            std::cerr << "Hitch: failed to write " << summaryPath << std::endl;
+            return;
+        }
+
+        const size_t oldest = (historyNext + history.size() - historyCount) % history.size();
+        auto at = [&](size_t i) -> const FrameRecord& { return history[(oldest + i) % history.size()]; };
+
+        const FrameRecord* hitchRecord = &at(0);
+        for (size_t i = 0; i < historyCount; i++) {
+            if (at(i).perf.frame == pending.frame) hitchRecord = &at(i);
+        }
+        const uint64_t hitchStartNs = hitchRecord->startNs;
+        auto relativeMs = [hitchStartNs](uint64_t ns) {
+            return (static_cast<double>(ns) - static_cast<double>(hitchStartNs)) / 1e6;
+        };
+
+        char date[32];
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+        std::fprintf(file, "Grape hitch capture, %s\n\n", date);
+        std::fprintf(file, "Frame %llu took %.2f ms, budget %.2f ms (%.1fx the median %.2f ms, at least %.1f ms)\n\n",
+            static_cast<unsigned long long>(pending.frame), pending.frameMs, pending.budgetMs,
+            settings.medianMultiple, pending.medianMs, settings.minimumMs);
+
+        std::fprintf(file, "Frames, oldest first (> is the hitch, start is ms from the hitch frame's start)\n");
+        std::fprintf(file, "  %8s %9s %8s %8s %8s %6s %10s %7s %10s %10s %10s\n", "frame", "start", "frame ms", "cpu ms",
+            "gpu ms", "draws", "triangles", "binds", "physics ms", "cpu mem", "gpu mem");
+        for (size_t i = 0; i < historyCount; i++) {
+            const FrameRecord& record = at(i);
+            const PerfFrame& perf = record.perf;
+            uint64_t binds = perf.get(PerfCounter::PipelineBinds) + perf.get(PerfCounter::DescriptorSetBinds) +
+                perf.get(PerfCounter::VertexBufferBinds) + perf.get(PerfCounter::IndexBufferBinds);
+            std::fprintf(file, "%c %8llu %9.2f %8.2f %8.2f %8.2f %6llu %10llu %7llu %10.2f %10s %10s\n",
+                perf.frame == pending.frame ? '>' : ' ',
+                static_cast<unsigned long long>(perf.frame), relativeMs(record.startNs),
+                perf.frameMs, perf.cpuMs, perf.gpuMs,
+                static_cast<unsigned long long>(perf.get(PerfCounter::DrawCalls)),
+                static_cast<unsigned long long>(perf.get(PerfCounter::Triangles)),
+                static_cast<unsigned long long>(binds),
+                static_cast<double>(perf.get(PerfGauge::PhysicsStepUs)) / 1000.0,
+                MemoryTracker::formatBytes(static_cast<double>(perf.cpuMemoryBytes)).c_str(),
+                MemoryTracker::formatBytes(static_cast<double>(perf.gpuMemoryBytes)).c_str());
+        }
+
+        // The hitch frame's own GPU timings are resolved when its slot comes around again, so
+        // they're somewhere in the frames after it
+        std::fprintf(file, "\nGPU passes resolved from the hitch on (ms)\n");
+        for (size_t i = 0; i < historyCount; i++) {
+            const FrameRecord& record = at(i);
+            if (record.perf.frame < pending.frame) continue;
+            std::fprintf(file, "  frame %llu, GPU %.2f ms\n", static_cast<unsigned long long>(record.perf.frame), record.perf.gpuMs);
+            for (uint32_t pass = 0; pass < record.gpuPassCount; pass++) {
+                const GpuPassTiming& timing = record.gpuPasses[pass];
+                std::fprintf(file, "    %*s%-24s start %7.3f  %7.3f\n", static_cast<int>(timing.depth * 2), "",
+                    timing.name, timing.startMs, timing.durationMs);
+            }
+        }
+
+        std::fprintf(file, "\nEvents (ms from the hitch frame's start)\n");
+        std::vector<HitchEvent> events = HitchEvents::getInstance().getSince(at(0).startNs);
+        if (events.empty()) std::fprintf(file, "  none\n");
+        for (const auto& event : events) {
+            std::fprintf(file, "  %9.2f %8.2f ms  %-18s %s\n", relativeMs(event.startNs),
+                static_cast<double>(event.endNs - event.startNs) / 1e6, event.name, event.detail);
+        }
+        std::fclose(file);
+
+        std::string tracePath = base.string() + ".json";
+        bool wroteTrace = !Profiler::getInstance().getFrames().empty() &&
+            Profiler::getInstance().exportChromeTrace(tracePath, historyCount);
+
+        std::cout << "Hitch: frame " << pending.frame << " took " << pending.frameMs << " ms (budget "
+            << pending.budgetMs << " ms), wrote " << summaryPath << (wroteTrace ? " and " + tracePath : "") << std::endl;
+    }
+}
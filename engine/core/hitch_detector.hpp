@@ -0,0 +1,114 @@
+#pragma once
+
+#include "perf_counters.hpp"
+#include "renderer/gpu_profiler.hpp"
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace grape {
+
+    // Set with --hitch-capture, an empty directory turns the detector off
+    struct HitchSettings {
+        std::string directory;
+        float medianMultiple = 2.f;     // A frame over this times the rolling median is a hitch
+        float minimumMs = 5.f;          // ...and over this, so a 1 ms frame at 1000 fps isn't one
+        uint32_t frames = 120;          // Frames of history written per hitch, at most Profiler::FRAME_HISTORY
+        uint32_t maxCaptures = 16;      // Stops writing after this many, a soak run shouldn't fill the disk
+
+        static HitchSettings& getInstance() {
+            static HitchSettings instance;
+            return instance;
+        }
+    };
+
+    struct HitchEvent {
+        uint64_t startNs = 0;       // Profiler::now() clock
+        uint64_t endNs = 0;
+        const char* name = "";      // String literal
+        char detail[116] = {};      // Truncated
+    };
+
+    // Recent one-off things that tend to cause hitches (asset loads, swapchain recreation, waiting
+    // on the queue), so a capture can say what was going on around the slow frame. Fixed ring,
+    // any thread
+    class HitchEvents {
+    public:
+        static constexpr size_t CAPACITY = 256;
+
+        static HitchEvents& getInstance() {
+            static HitchEvents instance;
+            return instance;
+        }
+
+        HitchEvents(const HitchEvents&) = delete;
+        HitchEvents& operator=(const HitchEvents&) = delete;
+
+        static void record(const char* name, const std::string& detail, uint64_t startNs, uint64_t endNs);
+
+        // Events that ended at or after sinceNs, oldest first
+        std::vector<HitchEvent> getSince(uint64_t sinceNs) const;
+
+    private:
+        HitchEvents() = default;
+
+        mutable std::mutex mutex;
+        std::array<HitchEvent, CAPACITY> events{};
+        uint64_t written = 0;
+    };
+
+    // Watches PerfFrame times against the rolling median. When a frame goes over budget it waits a
+    // few frames (the GPU timings come back frames in flight later), then writes the last frames'
+    // stats, GPU pass timings and events to <directory>/hitch_<frame>.txt and their CPU zones
+    // to hitch_<frame>.json (Chrome trace). Main thread only
+    class HitchDetector {
+    public:
+        static constexpr uint32_t FRAMES_AFTER = 4;     // Written this many frames after the hitch
+        static constexpr uint32_t WARMUP_FRAMES = 60;   // Median isn't worth much before this
+        static constexpr uint32_t COOLDOWN_FRAMES = 60; // Writing the capture is a hitch of its own
+
+        // Throws if the directory can't be created
+        explicit HitchDetector(const HitchSettings& settings);
+
+        HitchDetector(const HitchDetector&) = delete;
+        HitchDetector& operator=(const HitchDetector&) = delete;
+
+        // Once per frame, right after GRAPE_PROFILE_FRAME so the frame's zones are in the profiler
+        // history. Frames already seen are skipped
+        void onFrame(const PerfFrame& frame);
+
+        uint32_t getCaptureCount() const { return captureCount; }
+
+    private:
+        struct FrameRecord {
+            PerfFrame perf{};
+            uint64_t startNs = 0;
+            uint64_t endNs = 0;
+            uint32_t gpuPassCount = 0;
+            std::array<GpuPassTiming, GpuProfiler::MAX_ZONES> gpuPasses{};
+        };
+
+        struct Hitch {
+            uint64_t frame = 0;
+            float frameMs = 0.f;
+            float medianMs = 0.f;
+            float budgetMs = 0.f;
+        };
+
+        void writeCapture() const;
+
+        HitchSettings settings;
+        std::vector<FrameRecord> history;       // Ring, settings.frames long
+        size_t historyNext = 0;
+        size_t historyCount = 0;
+
+        uint64_t lastFrame = 0;
+        Hitch pending{};
+        uint32_t framesUntilWrite = 0;
+        uint32_t cooldown = 0;
+        uint32_t captureCount = 0;
+    };
+}
@@ -0,0 +1,197 @@
+#include "job_system.hpp"
+#include "profiler.hpp"
+
+#include <iostream>
+
+namespace grape {
+
+    namespace {
+        thread_local int tlsWorkerIndex = -1;
+    }
+
+    JobSystem::JobSystem() {
+        // Leave one core for the main (render) thread
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        unsigned int workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+
+        for (unsigned int i = 0; i < workerCount; i++) {
+            queues.push_back(std::make_unique<WorkerQueue>());
+        }
+        for (unsigned int i = 0; i < workerCount; i++) {
+            workers.emplace_back(&JobSystem::workerLoop, this, static_cast<int>(i));
+        }
+
+        std::cout << "Job system: " << workerCount << " workers" << std::endl;
+    }
+
+    JobSystem::~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+
+        for (auto& worker : workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+    }
+
+    int JobSystem::getCurrentWorkerIndex() {
+        return tlsWorkerIndex;
+    }
+
+    void JobSystem::schedule(Job job, JobCounter* counter) {
+        if (counter) {
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        }
+        push({ std::move(job), counter });
+    }
+
+    void JobSystem::scheduleAfter(JobCounter& dependency, Job job, JobCounter* counter) {
+        if (counter) {
+            counter->pending.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        {
+            // finish() takes the same lock before draining, so a continuation can't slip through
+            std::lock_guard<std::mutex> lock(dependency.continuationMutex);
+            if (!dependency.isDone()) {
+                dependency.continuations.emplace_back(std::move(job), counter);
+                return;
+            }
+        }
+        push({ std::move(job), counter });
+    }
+
+    void JobSystem::wait(JobCounter& counter) {
+        while (!counter.isDone()) {
+            if (!tryRunOne()) {
+                std::this_thread::yield();
+            }
+        }
+
+        // The last finish() may still be holding the lock, counters usually live on the
+        // caller's stack so make sure it's let go before we return
+        std::exception_ptr error;
+        {
+            std::lock_guard<std::mutex> lock(counter.continuationMutex);
+            error = counter.error;
+            counter.error = nullptr;
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    void JobSystem::push(Task task) {
+        // Workers keep their own jobs local (better cache use), everyone else round-robins
+        int workerIndex = tlsWorkerIndex;
+        if (workerIndex < 0) {
+            workerIndex = static_cast<int>(nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size());
+        }
+
+        // Count before publishing so a thief can never drive the count negative
+        queuedTasks.fetch_add(1, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(queues[workerIndex]->mutex);
+            queues[workerIndex]->tasks.push_back(std::move(task));
+        }
+
+        {
+            // Taking the lock orders us against a worker that is about to sleep
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        wakeCondition.notify_one();
+    }
+
+    bool JobSystem::popOrSteal(int workerIndex, Task& task) {
+        const int queueCount = static_cast<int>(queues.size());
+
+        // Own queue first, newest job (LIFO keeps the working set hot)
+        if (workerIndex >= 0) {
+            auto& own = *queues[workerIndex];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        // Steal the oldest job from someone else, those tend to be the biggest chunks
+        int start = workerIndex >= 0 ? workerIndex + 1 : static_cast<int>(nextQueue.load(std::memory_order_relaxed));
+        for (int i = 0; i < queueCount; i++) {
+            int victim = (start + i) % queueCount;
+            if (victim == workerIndex) continue;
+
+            auto& queue = *queues[victim];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool JobSystem::tryRunOne() {
+        Task task;
+        if (!popOrSteal(tlsWorkerIndex, task)) {
+            return false;
+        }
+
+        // An exception can't leave a worker, it's handed to whoever waits on the counter
+        try {
+            task.job();
+        }
+        catch (...) {
+            if (task.counter) {
+                std::lock_guard<std::mutex> lock(task.counter->continuationMutex);
+                if (!task.counter->error) task.counter->error = std::current_exception();
+            }
+            else {
+                std::cerr << "Job threw with no counter to report it to, dropping the error" << std::endl;
+            }
+        }
+        finish(task.counter);
+        return true;
+    }
+
+    void JobSystem::finish(JobCounter* counter) {
+        if (!counter) return;
+
+        // Everything touching the counter happens under its lock, see wait()
+        std::vector<std::pair<Job, JobCounter*>> ready;
+        {
+            std::lock_guard<std::mutex> lock(counter->continuationMutex);
+            if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                ready.swap(counter->continuations);
+            }
+        }
+        for (auto& [job, continuationCounter] : ready) {
+            push({ std::move(job), continuationCounter });
+        }
+    }
+
+    void JobSystem::workerLoop(int workerIndex) {
+        tlsWorkerIndex = workerIndex;
+        GRAPE_PROFILE_THREAD("Worker " + std::to_string(workerIndex));
+
+        while (!stopping) {
+            if (tryRunOne()) {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeCondition.wait(lock, [this]() {
+                return stopping || queuedTasks.load(std::memory_order_acquire) > 0;
+            });
+        }
+    }
+}
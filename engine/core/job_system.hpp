@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace grape {
+
+    using Job = std::function<void()>;
+
+    // Tracks a group of jobs. Jobs scheduled "after" a counter run as continuations once
+    // everything tracked by it has finished, so no thread has to block on the group
+    class JobCounter {
+    public:
+        JobCounter() = default;
+        JobCounter(const JobCounter&) = delete;
+        JobCounter& operator=(const JobCounter&) = delete;
+
+        bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class JobSystem;
+
+        std::atomic<int> pending{ 0 };
+        std::mutex continuationMutex;
+        std::vector<std::pair<Job, JobCounter*>> continuations;
+        std::exception_ptr error;   // First job tracked here that threw, under continuationMutex
+    };
+
+    // Work-stealing pool shared by the whole engine (PhysX, culling, asset decoding, command
+    // recording) so subsystems don't each spin up their own threads and oversubscribe cores.
+    // Every worker owns a deque: it pushes/pops at the back, idle workers steal from the front
+    class JobSystem {
+    public:
+        static JobSystem& getInstance() {
+            static JobSystem instance;
+            return instance;
+        }
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        void schedule(Job job, JobCounter* counter = nullptr);
+        // Runs job once dependency is done, counter (if any) tracks the continuation itself
+        void scheduleAfter(JobCounter& dependency, Job job, JobCounter* counter = nullptr);
+        // Executes other jobs while waiting, safe to call from inside a job. Once everything is
+        // done, rethrows the first exception a job tracked by counter threw
+        void wait(JobCounter& counter);
+
+        // Splits [0, count) into grainSize chunks and calls fn(begin, end) on each, the calling
+        // thread helps until every chunk is done. A chunk that throws is rethrown here
+        template <typename Fn>
+        void parallelFor(size_t count, size_t grainSize, Fn&& fn) {
+            if (count == 0) return;
+            grainSize = std::max<size_t>(grainSize, 1);
+            if (count <= grainSize) {
+                fn(size_t{ 0 }, count);
+                return;
+            }
+
+            JobCounter counter;
+            for (size_t begin = 0; begin < count; begin += grainSize) {
+                size_t end = std::min(begin + grainSize, count);
+                schedule([&fn, begin, end]() { fn(begin, end); }, &counter);
+            }
+            wait(counter);
+        }
+
+        uint32_t getWorkerCount() const { return static_cast<uint32_t>(workers.size()); }
+        // Index of the calling worker, -1 on threads that don't belong to the pool
+        static int getCurrentWorkerIndex();
+
+    private:
+        struct Task {
+            Job job;
+            JobCounter* counter = nullptr;
+        };
+
+        struct WorkerQueue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        JobSystem();
+        ~JobSystem();
+
+        void workerLoop(int workerIndex);
+        void push(Task task);
+        bool tryRunOne();
+        bool popOrSteal(int workerIndex, Task& task);
+        void finish(JobCounter* counter);
+
+        std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<WorkerQueue>> queues;
+
+        std::atomic<bool> stopping{ false };
+        std::atomic<int> queuedTasks{ 0 };
+        std::atomic<uint32_t> nextQueue{ 0 };
+        std::mutex sleepMutex;
+        std::condition_variable wakeCondition;
+    };
+}
@@ -0,0 +1,253 @@
+#include "memory_tracker.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <new>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+namespace grape {
+
+    namespace {
+        thread_local MemoryTag currentTag = MemoryTag::Other;
+
+        void writeRow(std::FILE* file, const char* name, const MemoryStats& stats, bool showPeak = true) {
+            std::fprintf(file, "  %-10s %12s %12s %10lld %14s/s %10.0f/s\n", name,
+                MemoryTracker::formatBytes(static_cast<double>(stats.currentBytes)).c_str(),
+                showPeak ? MemoryTracker::formatBytes(static_cast<double>(stats.peakBytes)).c_str() : "-",
+                static_cast<long long>(stats.liveAllocations),
+                MemoryTracker::formatBytes(stats.bytesPerSecond).c_str(),
+                stats.allocationsPerSecond);
+        }
+    }
+
+    MemoryTracker MemoryTracker::instance;
+
+    const char* MemoryTracker::getTagName(MemoryTag tag) {
+        switch (tag) {
+        case MemoryTag::Scene: return "Scene";
+        case MemoryTag::Assets: return "Assets";
+        case MemoryTag::Physics: return "Physics";
+        case MemoryTag::UI: return "UI";
+        case MemoryTag::Renderer: return "Renderer";
+        default: return "Other";
+        }
+    }
+
+    const char* MemoryTracker::getGpuKindName(GpuMemoryKind kind) {
+        return kind == GpuMemoryKind::Buffer ? "Buffers" : "Images";
+    }
+
+    std::string MemoryTracker::formatBytes(double bytes) {
+        char text[32];
+        if (bytes < 1024.0) std::snprintf(text, sizeof(text), "%.0f B", bytes);
+        else if (bytes < 1024.0 * 1024.0) std::snprintf(text, sizeof(text), "%.1f KB", bytes / 1024.0);
+        else if (bytes < 1024.0 * 1024.0 * 1024.0) std::snprintf(text, sizeof(text), "%.1f MB", bytes / (1024.0 * 1024.0));
+        else std::snprintf(text, sizeof(text), "%.2f GB", bytes / (1024.0 * 1024.0 * 1024.0));
+        return text;
+    }
+
+    void MemoryTracker::Counters::add(uint64_t bytes) {
+        int64_t now = current.fetch_add(static_cast<int64_t>(bytes), std::memory_order_relaxed) + static_cast<int64_t>(bytes);
+        int64_t highest = peak.load(std::memory_order_relaxed);
+        while (now > highest && !peak.compare_exchange_weak(highest, now, std::memory_order_relaxed)) {}
+        live.fetch_add(1, std::memory_order_relaxed);
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void MemoryTracker::Counters::remove(uint64_t bytes) {
+        current.fetch_sub(static_cast<int64_t>(bytes), std::memory_order_relaxed);
+        live.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void MemoryTracker::Counters::updateRate(double seconds) {
+        uint64_t nowAllocations = allocations.load(std::memory_order_relaxed);
+        uint64_t nowBytes = allocatedBytes.load(std::memory_order_relaxed);
+        allocationsPerSecond = (nowAllocations - windowAllocations) / seconds;
+        bytesPerSecond = (nowBytes - windowBytes) / seconds;
+        windowAllocations = nowAllocations;
+        windowBytes = nowBytes;
+    }
+
+    MemoryStats MemoryTracker::Counters::getStats() const {
+        MemoryStats stats;
+        stats.currentBytes = current.load(std::memory_order_relaxed);
+        stats.peakBytes = peak.load(std::memory_order_relaxed);
+        stats.liveAllocations = live.load(std::memory_order_relaxed);
+        stats.totalAllocations = allocations.load(std::memory_order_relaxed);
+        stats.bytesPerSecond = bytesPerSecond;
+        stats.allocationsPerSecond = allocationsPerSecond;
+        return stats;
+    }
+
+    void MemoryTracker::recordDescriptorPool(int32_t pools, int64_t descriptorCount) {
+        descriptorPools.fetch_add(pools, std::memory_order_relaxed);
+        descriptors.fetch_add(descriptorCount, std::memory_order_relaxed);
+    }
+
+    void MemoryTracker::update() {
+        auto now = std::chrono::steady_clock::now();
+        if (windowStart.time_since_epoch().count() == 0) {
+            windowStart = now;
+            return;
+        }
+
+        double seconds = std::chrono::duration<double>(now - windowStart).count();
+        if (seconds < RATE_WINDOW) return;
+
+        for (auto& counters : cpu) counters.updateRate(seconds);
+        for (auto& counters : gpu) counters.updateRate(seconds);
+        windowStart = now;
+    }
+
+    MemoryStats MemoryTracker::getTotalStats() const {
+        // Peaks of different tags don't line up in time, so there's no total peak
+        MemoryStats total;
+        for (const auto& counters : cpu) {
+            MemoryStats stats = counters.getStats();
+            total.currentBytes += stats.currentBytes;
+            total.liveAllocations += stats.liveAllocations;
+            total.totalAllocations += stats.totalAllocations;
+            total.bytesPerSecond += stats.bytesPerSecond;
+            total.allocationsPerSecond += stats.allocationsPerSecond;
+        }
+        return total;
+    }
+
+    bool MemoryTracker::dumpToFile(const std::string& path) const {
+        std::FILE* file = std::fopen(path.c_str(), "w");
+        if (!file) return false;
+
+        char date[32];
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+        std::fprintf(file, "Grape memory report, %s\n\n", date);
+
+        std::fprintf(file, "CPU%s\n", GRAPE_MEMORY_TRACKING ? "" : " (tracking compiled out)");
+        std::fprintf(file, "  %-10s %12s %12s %10s %16s %12s\n", "", "current", "peak", "blocks", "alloc rate", "allocs");
+        for (size_t tag = 0; tag < static_cast<size_t>(MemoryTag::Count); tag++) {
+            writeRow(file, getTagName(static_cast<MemoryTag>(tag)), getStats(static_cast<MemoryTag>(tag)));
+        }
+        writeRow(file, "Total", getTotalStats(), false);
+
+        std::fprintf(file, "\nGPU\n");
+        for (size_t kind = 0; kind < static_cast<size_t>(GpuMemoryKind::Count); kind++) {
+            writeRow(file, getGpuKindName(static_cast<GpuMemoryKind>(kind)), getGpuStats(static_cast<GpuMemoryKind>(kind)));
+        }
+        std::fprintf(file, "  Descriptor pools: %lld (%lld descriptors)\n",
+            static_cast<long long>(getDescriptorPoolCount()), static_cast<long long>(getDescriptorCount()));
+
+        std::fclose(file);
+        return true;
+    }
+
+    MemoryScope::MemoryScope(MemoryTag tag) : previous{ currentTag } {
+        currentTag = tag;
+    }
+
+    MemoryScope::~MemoryScope() {
+        currentTag = previous;
+    }
+
+    MemoryTag MemoryScope::current() {
+        return currentTag;
+    }
+}
+
+#if GRAPE_MEMORY_TRACKING
+
+// Global operator new/delete replacements. Every block carries a small header in front of it
+// with its size and tag, so a free is charged back to whoever allocated, on whatever thread
+namespace {
+    struct AllocationHeader {
+        size_t size;
+        grape::MemoryTag tag;
+    };
+
+    constexpr size_t MIN_HEADER = 16;   // Keeps the default 16 byte alignment of new
+    static_assert(sizeof(AllocationHeader) <= MIN_HEADER, "allocation header doesn't fit");
+
+    size_t headerSize(size_t alignment) {
+        return std::max(MIN_HEADER, alignment);
+    }
+
+    void* allocateBlock(size_t size, size_t alignment) {
+#if defined(_MSC_VER)
+        return _aligned_malloc(size, alignment);
+#else
+        void* block = nullptr;
+        return posix_memalign(&block, alignment, size) == 0 ? block : nullptr;
+#endif
+    }
+
+    void freeBlock(void* block) {
+#if defined(_MSC_VER)
+        _aligned_free(block);
+#else
+        std::free(block);
+#endif
+    }
+
+    void* trackedNew(size_t size, size_t alignment) {
+        const size_t offset = headerSize(alignment);
+        void* block = nullptr;
+        while ((block = allocateBlock(size + offset, offset)) == nullptr) {
+            std::new_handler handler = std::get_new_handler();
+            if (!handler) throw std::bad_alloc();
+            handler();
+        }
+
+        char* user = static_cast<char*>(block) + offset;
+        auto* header = reinterpret_cast<AllocationHeader*>(user - sizeof(AllocationHeader));
+        header->size = size;
+        header->tag = grape::MemoryScope::current();
+        grape::MemoryTracker::getInstance().recordAllocation(header->tag, size);
+        return user;
+    }
+
+    void* trackedNewNothrow(size_t size, size_t alignment) noexcept {
+        try {
+            return trackedNew(size, alignment);
+        }
+        catch (...) {
+            return nullptr;
+        }
+    }
+
+    void trackedDelete(void* ptr, size_t alignment) noexcept {
+        if (!ptr) return;
+        char* user = static_cast<char*>(ptr);
+        auto* header = reinterpret_cast<AllocationHeader*>(user - sizeof(AllocationHeader));
+        grape::MemoryTracker::getInstance().recordFree(header->tag, header->size);
+        freeBlock(user - headerSize(alignment));
+    }
+}
+
+void* operator new(std::size_t size) { return trackedNew(size, MIN_HEADER); }
+void* operator new[](std::size_t size) { return trackedNew(size, MIN_HEADER); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return trackedNewNothrow(size, MIN_HEADER); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return trackedNewNothrow(size, MIN_HEADER); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return trackedNew(size, static_cast<size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return trackedNew(size, static_cast<size_t>(alignment)); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return trackedNewNothrow(size, static_cast<size_t>(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return trackedNewNothrow(size, static_cast<size_t>(alignment)); }
+
+void operator delete(void* ptr) noexcept { trackedDelete(ptr, MIN_HEADER); }
+void operator delete[](void* ptr) noexcept { trackedDelete(ptr, MIN_HEADER); }
+void operator delete(void* ptr, std::size_t) noexcept { trackedDelete(ptr, MIN_HEADER); }
+void operator delete[](void* ptr, std::size_t) noexcept { trackedDelete(ptr, MIN_HEADER); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { trackedDelete(ptr, MIN_HEADER); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { trackedDelete(ptr, MIN_HEADER); }
+void operator delete(void* ptr, std::align_val_t alignment) noexcept { trackedDelete(ptr, static_cast<size_t>(alignment)); }
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept { trackedDelete(ptr, static_cast<size_t>(alignment)); }
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept { trackedDelete(ptr, static_cast<size_t>(alignment)); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept { trackedDelete(ptr, static_cast<size_t>(alignment)); }
+void operator delete(void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept { trackedDelete(ptr, static_cast<size_t>(alignment)); }
+void operator delete[](void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept { trackedDelete(ptr, static_cast<size_t>(alignment)); }
+
+#endif
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Builds that want the plain allocator define GRAPE_MEMORY_TRACKING=0, the global operator
+// new/delete replacements go away and every scope macro compiles to nothing
+#ifndef GRAPE_MEMORY_TRACKING
+#define GRAPE_MEMORY_TRACKING 1
+#endif
+
+namespace grape {
+
+    // Who a CPU allocation is charged to, allocations outside any scope land in Other
+    enum class MemoryTag : uint8_t {
+        Other,
+        Scene,
+        Assets,
+        Physics,
+        UI,
+        Renderer,
+        Count
+    };
+
+    enum class GpuMemoryKind : uint8_t {
+        Buffer,
+        Image,
+        Count
+    };
+
+    struct MemoryStats {
+        int64_t currentBytes = 0;
+        int64_t peakBytes = 0;
+        int64_t liveAllocations = 0;
+        uint64_t totalAllocations = 0;
+        double bytesPerSecond = 0.0;        // Allocated, frees don't count against it
+        double allocationsPerSecond = 0.0;
+    };
+
+    // Process wide allocation counters. CPU memory is counted by the global operator new/delete
+    // (memory_tracker.cpp) under the tag of the innermost MemoryScope on the allocating thread,
+    // device memory and descriptor pools by Device and DescriptorPool
+    class MemoryTracker {
+    public:
+        static constexpr double RATE_WINDOW = 1.0;     // Seconds the allocation rates average over
+
+        static MemoryTracker& getInstance() { return instance; }
+
+        MemoryTracker(const MemoryTracker&) = delete;
+        MemoryTracker& operator=(const MemoryTracker&) = delete;
+
+        static const char* getTagName(MemoryTag tag);
+        static const char* getGpuKindName(GpuMemoryKind kind);
+        // "12.3 MB" and the like
+        static std::string formatBytes(double bytes);
+
+        void recordAllocation(MemoryTag tag, size_t bytes) { cpu[static_cast<size_t>(tag)].add(bytes); }
+        void recordFree(MemoryTag tag, size_t bytes) { cpu[static_cast<size_t>(tag)].remove(bytes); }
+        void recordGpuAllocation(GpuMemoryKind kind, uint64_t bytes) { gpu[static_cast<size_t>(kind)].add(bytes); }
+        void recordGpuFree(GpuMemoryKind kind, uint64_t bytes) { gpu[static_cast<size_t>(kind)].remove(bytes); }
+        // Negative when a pool goes away
+        void recordDescriptorPool(int32_t pools, int64_t descriptors);
+
+        // Main thread, once per frame. Refreshes the rates once every RATE_WINDOW
+        void update();
+
+        MemoryStats getStats(MemoryTag tag) const { return cpu[static_cast<size_t>(tag)].getStats(); }
+        MemoryStats getGpuStats(GpuMemoryKind kind) const { return gpu[static_cast<size_t>(kind)].getStats(); }
+        MemoryStats getTotalStats() const;
+        int64_t getDescriptorPoolCount() const { return descriptorPools.load(std::memory_order_relaxed); }
+        int64_t getDescriptorCount() const { return descriptors.load(std::memory_order_relaxed); }
+
+        // Plain text report of everything above, false if the file couldn't be written
+        bool dumpToFile(const std::string& path) const;
+
+    private:
+        struct Counters {
+            std::atomic<int64_t> current{ 0 };
+            std::atomic<int64_t> peak{ 0 };
+            std::atomic<int64_t> live{ 0 };
+            std::atomic<uint64_t> allocations{ 0 };
+            std::atomic<uint64_t> allocatedBytes{ 0 };
+
+            // Rate window, main thread only
+            uint64_t windowAllocations = 0;
+            uint64_t windowBytes = 0;
+            double allocationsPerSecond = 0.0;
+            double bytesPerSecond = 0.0;
+
+            void add(uint64_t bytes);
+            void remove(uint64_t bytes);
+            void updateRate(double seconds);
+            MemoryStats getStats() const;
+        };
+
+        // Constant initialized, so it's usable from operator new before any static constructor runs
+        MemoryTracker() = default;
+        static MemoryTracker instance;
+
+        Counters cpu[static_cast<size_t>(MemoryTag::Count)];
+        Counters gpu[static_cast<size_t>(GpuMemoryKind::Count)];
+        std::atomic<int64_t> descriptorPools{ 0 };
+        std::atomic<int64_t> descriptors{ 0 };
+        std::chrono::steady_clock::time_point windowStart{};
+    };
+
+    // Charges this thread's allocations to tag until the scope ends. Scopes nest, the innermost wins
+    class MemoryScope {
+    public:
+        explicit MemoryScope(MemoryTag tag);
+        ~MemoryScope();
+
+        MemoryScope(const MemoryScope&) = delete;
+        MemoryScope& operator=(const MemoryScope&) = delete;
+
+        static MemoryTag current();
+
+    private:
+        MemoryTag previous;
+    };
+}
+
+#define GRAPE_MEMORY_CONCAT_INNER(a, b) a##b
+#define GRAPE_MEMORY_CONCAT(a, b) GRAPE_MEMORY_CONCAT_INNER(a, b)
+
+#if GRAPE_MEMORY_TRACKING
+#define GRAPE_MEMORY_SCOPE(tag) ::grape::MemoryScope GRAPE_MEMORY_CONCAT(grapeMemoryScope, __LINE__){ tag }
+#else
+#define GRAPE_MEMORY_SCOPE(tag) ((void)0)
+#endif
@@ -0,0 +1,71 @@
+#include "perf_counters.hpp"
+#include "memory_tracker.hpp"
+#include "systems/simple_render_system.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace grape {
+
+    PerfCounters PerfCounters::instance;
+
+    void PerfCounters::registerThread(LocalSlot& local) {
+        uint32_t index = slotCount.fetch_add(1, std::memory_order_relaxed);
+        local.shared = index >= MAX_THREADS;
+        local.slot = &slots[std::min<size_t>(index, MAX_THREADS)];
+    }
+
+    void PerfCounters::endFrame(float frameMs, float cpuMs, float gpuMs) {
+        std::array<uint64_t, static_cast<size_t>(PerfCounter::Count)> totals{};
+        for (const auto& slot : slots) {
+            for (size_t counter = 0; counter < totals.size(); counter++) {
+                totals[counter] += slot.values[counter].load(std::memory_order_relaxed);
+            }
+        }
+
+        PerfFrame frame{};
+        frame.frame = lastFrame.frame + 1;
+        frame.frameMs = frameMs;
+        frame.cpuMs = cpuMs;
+        frame.gpuMs = gpuMs;
+        for (size_t counter = 0; counter < totals.size(); counter++) {
+            frame.counters[counter] = totals[counter] - previousTotals[counter];
+        }
+        previousTotals = totals;
+        for (size_t gauge = 0; gauge < gauges.size(); gauge++) {
+            frame.gauges[gauge] = gauges[gauge].load(std::memory_order_relaxed);
+        }
+
+        const auto& culling = CullingStats::getInstance();
+        frame.objects = culling.objects;
+        frame.frustumCulled = culling.frustumCulled;
+        frame.occlusionCulled = culling.occlusionCulled;
+        frame.meshletsCulled = culling.meshletsCulled;
+
+        const auto& memory = MemoryTracker::getInstance();
+        frame.cpuMemoryBytes = memory.getTotalStats().currentBytes;
+        for (size_t kind = 0; kind < static_cast<size_t>(GpuMemoryKind::Count); kind++) {
+            frame.gpuMemoryBytes += memory.getGpuStats(static_cast<GpuMemoryKind>(kind)).currentBytes;
+        }
+        lastFrame = frame;
+
+        window[static_cast<size_t>(PerfSeries::Frame)][windowNext] = frameMs;
+        window[static_cast<size_t>(PerfSeries::Cpu)][windowNext] = cpuMs;
+        window[static_cast<size_t>(PerfSeries::Gpu)][windowNext] = gpuMs;
+        windowNext = (windowNext + 1) % WINDOW;
+        windowCount = std::min(windowCount + 1, WINDOW);
+    }
+
+    float PerfCounters::getPercentile(PerfSeries series, float p) const {
+        if (windowCount == 0) return 0.f;
+
+        // A few hundred floats, sorting a copy is cheaper than keeping an order statistic tree
+        std::array<float, WINDOW> sorted;
+        const auto& values = window[static_cast<size_t>(series)];
+        std::copy(values.begin(), values.begin() + windowCount, sorted.begin());
+
+        size_t index = static_cast<size_t>(std::lround(std::clamp(p, 0.f, 1.f) * static_cast<float>(windowCount - 1)));
+        std::nth_element(sorted.begin(), sorted.begin() + index, sorted.begin() + windowCount);
+        return sorted[index];
+    }
+}
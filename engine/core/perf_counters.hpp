@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace grape {
+
+    // Incremented wherever commands get recorded, on whatever thread that is
+    enum class PerfCounter : uint8_t {
+        DrawCalls,
+        Triangles,
+        PipelineBinds,
+        DescriptorSetBinds,
+        VertexBufferBinds,
+        IndexBufferBinds,
+        Count
+    };
+
+    // Last value wins, set by whoever owns the number
+    enum class PerfGauge : uint8_t {
+        PhysicsStepUs,      // Last simulation tick's StepPhysics
+        DynamicBodies,
+        AwakeBodies,        // Dynamic bodies PhysX hasn't put to sleep
+        Count
+    };
+
+    // Everything the perf HUD shows for one frame
+    struct PerfFrame {
+        uint64_t frame = 0;
+        float frameMs = 0.f;        // Start to start, what the user sees
+        float cpuMs = 0.f;          // Main thread work, without the limiter or waiting on the GPU
+        float gpuMs = 0.f;          // Latest resolved GPU frame, a couple of frames behind
+        std::array<uint64_t, static_cast<size_t>(PerfCounter::Count)> counters{};
+        std::array<int64_t, static_cast<size_t>(PerfGauge::Count)> gauges{};
+
+        // Copied from CullingStats
+        uint32_t objects = 0;
+        uint32_t frustumCulled = 0;
+        uint32_t occlusionCulled = 0;
+        uint32_t meshletsCulled = 0;
+
+        int64_t cpuMemoryBytes = 0;
+        int64_t gpuMemoryBytes = 0;
+
+        uint64_t get(PerfCounter counter) const { return counters[static_cast<size_t>(counter)]; }
+        int64_t get(PerfGauge gauge) const { return gauges[static_cast<size_t>(gauge)]; }
+    };
+
+    enum class PerfSeries : uint8_t {
+        Frame,
+        Cpu,
+        Gpu,
+        Count
+    };
+
+    // Frame counters without locks or contention. Each thread accumulates into its own cache line,
+    // the main thread sums them up in endFrame and keeps the last WINDOW frames' times for
+    // rolling percentiles
+    class PerfCounters {
+    public:
+        static constexpr size_t WINDOW = 300;      // Frames the percentiles are over, ~5 s at 60 fps
+        static constexpr size_t MAX_THREADS = 128; // Threads past this share one (atomic) slot
+
+        static PerfCounters& getInstance() { return instance; }
+
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        static void add(PerfCounter counter, uint64_t amount = 1) {
+            LocalSlot& local = getLocalSlot();
+            if (local.slot == nullptr) getInstance().registerThread(local);
+
+            auto& value = local.slot->values[static_cast<size_t>(counter)];
+            // Only the owning thread writes its slot, a plain load and store is enough for the reader
+            if (!local.shared) value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+            else value.fetch_add(amount, std::memory_order_relaxed);
+        }
+        void setGauge(PerfGauge gauge, int64_t value) { gauges[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed); }
+
+        // Main thread, once the frame's recording jobs are done. Counters cover everything
+        // recorded since the previous call
+        void endFrame(float frameMs, float cpuMs, float gpuMs);
+
+        const PerfFrame& getLastFrame() const { return lastFrame; }
+        // p in [0, 1] over the rolling window, 0 when there are no frames yet
+        float getPercentile(PerfSeries series, float p) const;
+        size_t getWindowSize() const { return windowCount; }
+
+    private:
+        struct alignas(64) ThreadSlot {
+            std::array<std::atomic<uint64_t>, static_cast<size_t>(PerfCounter::Count)> values{};
+        };
+
+        struct LocalSlot {
+            ThreadSlot* slot = nullptr;
+            bool shared = false;
+        };
+
+        PerfCounters() = default;
+        static PerfCounters instance;
+
+        static LocalSlot& getLocalSlot() {
+            thread_local LocalSlot local;
+            return local;
+        }
+        void registerThread(LocalSlot& local);
+
+        std::array<ThreadSlot, MAX_THREADS + 1> slots{};
+        std::atomic<uint32_t> slotCount{ 0 };
+        std::array<std::atomic<int64_t>, static_cast<size_t>(PerfGauge::Count)> gauges{};
+
+        // Main thread only
+        std::array<uint64_t, static_cast<size_t>(PerfCounter::Count)> previousTotals{};
+        PerfFrame lastFrame{};
+        std::array<std::array<float, WINDOW>, static_cast<size_t>(PerfSeries::Count)> window{};
+        size_t windowNext = 0;
+        size_t windowCount = 0;
+    };
+}
@@ -0,0 +1,125 @@
+#include "png_writer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace grape {
+
+    namespace {
+        // Largest payload of a stored deflate block
+        constexpr size_t STORED_BLOCK_SIZE = 65535;
+
+        const std::array<uint32_t, 256>& crcTable() {
+            static const std::array<uint32_t, 256> table = [] {
+                std::array<uint32_t, 256> result{};
+                for (uint32_t n = 0; n < 256; n++) {
+                    uint32_t c = n;
+                    for (int k = 0; k < 8; k++) {
+                        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    }
+                    result[n] = c;
+                }
+                return result;
+            }();
+            return table;
+        }
+
+        uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size) {
+            const auto& table = crcTable();
+            crc = ~crc;
+            for (size_t i = 0; i < size; i++) {
+                crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+            }
+            return ~crc;
+        }
+
+        void putBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+            out.push_back(static_cast<uint8_t>(value >> 24));
+            out.push_back(static_cast<uint8_t>(value >> 16));
+            out.push_back(static_cast<uint8_t>(value >> 8));
+            out.push_back(static_cast<uint8_t>(value));
+        }
+
+        void writeChunk(std::ofstream& file, const char type[4], const std::vector<uint8_t>& data) {
+            std::vector<uint8_t> chunk;
+            chunk.reserve(data.size() + 12);
+            putBigEndian(chunk, static_cast<uint32_t>(data.size()));
+            chunk.insert(chunk.end(), type, type + 4);
+            chunk.insert(chunk.end(), data.begin(), data.end());
+            // The CRC covers the type and the data, not the length
+            putBigEndian(chunk, crc32(0, chunk.data() + 4, chunk.size() - 4));
+            file.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+        }
+    }
+
+    void writePng(const std::string& path, uint32_t width, uint32_t height, const uint8_t* bgra) {
+        // Scanlines with filter type 0 in front of every row
+        const size_t rowSize = static_cast<size_t>(width) * 3 + 1;
+        std::vector<uint8_t> raw(rowSize * height);
+        for (uint32_t y = 0; y < height; y++) {
+            uint8_t* row = &raw[y * rowSize];
+            const uint8_t* src = bgra + static_cast<size_t>(y) * width * 4;
+            row[0] = 0;
+            for (uint32_t x = 0; x < width; x++) {
+                row[1 + x * 3 + 0] = src[x * 4 + 2];
+                row[1 + x * 3 + 1] = src[x * 4 + 1];
+                row[1 + x * 3 + 2] = src[x * 4 + 0];
+            }
+        }
+
+        // zlib stream of stored blocks
+        std::vector<uint8_t> idat;
+        idat.reserve(raw.size() + raw.size() / STORED_BLOCK_SIZE * 5 + 16);
+        idat.push_back(0x78);
+        idat.push_back(0x01);
+
+        uint32_t adlerA = 1;
+        uint32_t adlerB = 0;
+        size_t offset = 0;
+        do {
+            size_t blockSize = std::min(STORED_BLOCK_SIZE, raw.size() - offset);
+            bool last = offset + blockSize == raw.size();
+
+            idat.push_back(last ? 1 : 0);
+            idat.push_back(static_cast<uint8_t>(blockSize));
+            idat.push_back(static_cast<uint8_t>(blockSize >> 8));
+            idat.push_back(static_cast<uint8_t>(~blockSize));
+            idat.push_back(static_cast<uint8_t>(~blockSize >> 8));
+            idat.insert(idat.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+
+            for (size_t i = offset; i < offset + blockSize; i++) {
+                adlerA = (adlerA + raw[i]) % 65521;
+                adlerB = (adlerB + adlerA) % 65521;
+            }
+            offset += blockSize;
+        } while (offset < raw.size());
+        putBigEndian(idat, (adlerB << 16) | adlerA);
+
+        std::vector<uint8_t> header;
+        putBigEndian(header, width);
+        putBigEndian(header, height);
+        header.push_back(8);    // Bit depth
+        header.push_back(2);    // Truecolor
+        header.push_back(0);    // Deflate
+        header.push_back(0);    // Adaptive filtering
+        header.push_back(0);    // No interlace
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("failed to open " + path + " for writing!");
+        }
+
+        static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+        writeChunk(file, "IHDR", header);
+        writeChunk(file, "IDAT", idat);
+        writeChunk(file, "IEND", {});
+
+        if (!file) {
+            throw std::runtime_error("failed to write " + path + "!");
+        }
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace grape {
+
+    // Writes an 8-bit RGB PNG from tightly packed BGRA pixels (what the viewport readback gives),
+    // alpha is dropped. Deflate is stored-only, files are big but it needs no zlib and costs
+    // next to nothing per frame. Throws if the file can't be written
+    void writePng(const std::string& path, uint32_t width, uint32_t height, const uint8_t* bgra);
+}
@@ -0,0 +1,161 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+namespace grape {
+
+    namespace {
+        thread_local Profiler* tlsOwner = nullptr;
+        thread_local void* tlsBuffer = nullptr;
+        thread_local uint16_t tlsDepth = 0;
+
+        void writeEscaped(std::ofstream& out, const std::string& text) {
+            for (char c : text) {
+                if (c == '"' || c == '\\') out << '\\';
+                out << c;
+            }
+        }
+    }
+
+    uint64_t Profiler::now() {
+        // steady_clock is QueryPerformanceCounter/clock_gettime underneath, close enough to rdtsc
+        // for millisecond-scale zones and it doesn't drift across cores
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    Profiler::ThreadBuffer& Profiler::getThreadBuffer() {
+        if (tlsOwner == this) {
+            return *static_cast<ThreadBuffer*>(tlsBuffer);
+        }
+
+        auto buffer = std::make_unique<ThreadBuffer>();
+        buffer->zones.resize(ZONES_PER_THREAD);
+
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        buffer->index = static_cast<uint16_t>(threads.size());
+        buffer->name = "Thread " + std::to_string(threads.size());
+        threads.push_back(std::move(buffer));
+
+        tlsOwner = this;
+        tlsBuffer = threads.back().get();
+        return *threads.back();
+    }
+
+    void Profiler::setThreadName(const std::string& name) {
+        ThreadBuffer& buffer = getThreadBuffer();
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        buffer.name = name;
+    }
+
+    void Profiler::recordZone(const char* name, uint64_t startNs, uint64_t endNs, uint16_t depth) {
+        ThreadBuffer& buffer = getThreadBuffer();
+        uint64_t written = buffer.written.load(std::memory_order_relaxed);
+        buffer.zones[written % ZONES_PER_THREAD] = { name, startNs, endNs, depth, buffer.index };
+        buffer.written.store(written + 1, std::memory_order_release);
+    }
+
+    void Profiler::beginFrame() {
+        uint64_t frameEndNs = now();
+
+        ProfileFrame frame;
+        frame.startNs = frameStartNs != 0 ? frameStartNs : frameEndNs;
+        frame.endNs = frameEndNs;
+        frameStartNs = frameEndNs;
+
+        {
+            std::lock_guard<std::mutex> lock(threadsMutex);
+            for (auto& buffer : threads) {
+                uint64_t written = buffer->written.load(std::memory_order_acquire);
+                // Anything older than one ring's worth has been overwritten already
+                if (written - buffer->read > ZONES_PER_THREAD) {
+                    buffer->read = written - ZONES_PER_THREAD;
+                }
+                if (!paused) {
+                    for (uint64_t i = buffer->read; i < written; i++) {
+                        frame.zones.push_back(buffer->zones[i % ZONES_PER_THREAD]);
+                    }
+                }
+                buffer->read = written;
+            }
+        }
+
+        if (paused) return;
+
+        frames.push_back(std::move(frame));
+        while (frames.size() > FRAME_HISTORY) {
+            frames.pop_front();
+        }
+    }
+
+    std::vector<std::string> Profiler::getThreadNames() const {
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        std::vector<std::string> names;
+        names.reserve(threads.size());
+        for (const auto& buffer : threads) {
+            names.push_back(buffer->name);
+        }
+        return names;
+    }
+
+    bool Profiler::exportChromeTrace(const std::string& path, size_t lastFrames) const {
+        std::ofstream out(path);
+        if (!out) {
+            std::cerr << "Failed to open " << path << " for the trace export" << std::endl;
+            return false;
+        }
+
+        const size_t firstFrame = frames.size() - std::min(lastFrames, frames.size());
+        uint64_t baseNs = firstFrame < frames.size() ? frames[firstFrame].startNs : 0;
+        auto micros = [baseNs](uint64_t ns) { return static_cast<double>(ns - std::min(ns, baseNs)) / 1000.0; };
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+
+        // Frames get a lane of their own after the threads so they line up with the zones
+        std::vector<std::string> threadNames = getThreadNames();
+        const size_t frameLane = threadNames.size();
+        threadNames.push_back("Frames");
+        for (size_t i = 0; i < threadNames.size(); i++) {
+            out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+                << ",\"args\":{\"name\":\"";
+            writeEscaped(out, threadNames[i]);
+            out << "\"}}";
+            first = false;
+        }
+
+        out.setf(std::ios::fixed);
+        out.precision(3);
+        for (size_t i = firstFrame; i < frames.size(); i++) {
+            const ProfileFrame& frame = frames[i];
+            out << (first ? "" : ",\n") << "{\"name\":\"Frame\",\"ph\":\"X\",\"pid\":1,\"tid\":" << frameLane << ",\"ts\":"
+                << micros(frame.startNs) << ",\"dur\":" << micros(frame.endNs) - micros(frame.startNs) << "}";
+            first = false;
+
+            for (const auto& zone : frame.zones) {
+                out << ",\n{\"name\":\"";
+                writeEscaped(out, zone.name);
+                out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << zone.thread
+                    << ",\"ts\":" << micros(zone.startNs) << ",\"dur\":" << micros(zone.endNs) - micros(zone.startNs) << "}";
+            }
+        }
+        out << "\n]}\n";
+
+        if (!out) {
+            std::cerr << "Failed to write " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    ProfileScope::ProfileScope(const char* name) : name{ name }, startNs{ Profiler::now() }, depth{ tlsDepth++ } {
+    }
+
+    ProfileScope::~ProfileScope() {
+        tlsDepth--;
+        Profiler::getInstance().recordZone(name, startNs, Profiler::now(), depth);
+    }
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Release-lite builds define GRAPE_PROFILER=0, every zone macro then compiles to nothing
+#ifndef GRAPE_PROFILER
+#define GRAPE_PROFILER 1
+#endif
+
+namespace grape {
+
+    struct ProfileZone {
+        const char* name;       // Must outlive the profiler, zone names are string literals
+        uint64_t startNs;
+        uint64_t endNs;
+        uint16_t depth;         // Nesting level on its thread, 0 = outermost
+        uint16_t thread;        // Index into Profiler::getThreadNames()
+    };
+
+    // Every zone that ended between two beginFrame calls, from every thread
+    struct ProfileFrame {
+        uint64_t startNs = 0;
+        uint64_t endNs = 0;
+        std::vector<ProfileZone> zones;
+    };
+
+    // Hierarchical CPU profiler. Each thread records finished zones into its own ring buffer
+    // without locking, beginFrame (main thread) drains them all into the frame history that
+    // the profiler panel and the Chrome trace export read from
+    class Profiler {
+    public:
+        static constexpr size_t ZONES_PER_THREAD = 1 << 14;     // Ring size, has to cover one frame
+        static constexpr size_t FRAME_HISTORY = 240;
+
+        static Profiler& getInstance() {
+            static Profiler instance;
+            return instance;
+        }
+
+        Profiler(const Profiler&) = delete;
+        Profiler& operator=(const Profiler&) = delete;
+
+        static uint64_t now();
+
+        // Main thread, once per frame before anything else is timed
+        void beginFrame();
+
+        // Shows up as the thread's lane name, call once from the thread itself
+        void setThreadName(const std::string& name);
+        void recordZone(const char* name, uint64_t startNs, uint64_t endNs, uint16_t depth);
+
+        // While paused frames are still drained (so the rings don't wrap) but not kept
+        void setPaused(bool value) { paused = value; }
+        bool isPaused() const { return paused; }
+
+        // Main thread only, oldest first
+        const std::deque<ProfileFrame>& getFrames() const { return frames; }
+        std::vector<std::string> getThreadNames() const;
+
+        // Writes the frame history (or just its newest lastFrames) as Chrome trace event JSON
+        // (chrome://tracing, Perfetto)
+        bool exportChromeTrace(const std::string& path, size_t lastFrames = FRAME_HISTORY) const;
+
+    private:
+        Profiler() = default;
+
+        struct ThreadBuffer {
+            std::string name;
+            uint16_t index = 0;
+            std::vector<ProfileZone> zones;
+            std::atomic<uint64_t> written{ 0 };     // Total zones ever recorded, the owner thread bumps it
+            uint64_t read = 0;                      // Main thread only
+        };
+
+        ThreadBuffer& getThreadBuffer();
+
+        mutable std::mutex threadsMutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> threads;
+
+        std::deque<ProfileFrame> frames;
+        uint64_t frameStartNs = 0;
+        bool paused = false;
+    };
+
+    // Times its own lifetime
+    class ProfileScope {
+    public:
+        explicit ProfileScope(const char* name);
+        ~ProfileScope();
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+        const char* name;
+        uint64_t startNs;
+        uint16_t depth;
+    };
+}
+
+#define GRAPE_PROFILE_CONCAT_INNER(a, b) a##b
+#define GRAPE_PROFILE_CONCAT(a, b) GRAPE_PROFILE_CONCAT_INNER(a, b)
+
+#if GRAPE_PROFILER
+#define GRAPE_PROFILE_SCOPE(name) ::grape::ProfileScope GRAPE_PROFILE_CONCAT(profileScope, __LINE__){ name }
+#define GRAPE_PROFILE_FUNCTION() GRAPE_PROFILE_SCOPE(__func__)
+#define GRAPE_PROFILE_FRAME() ::grape::Profiler::getInstance().beginFrame()
+#define GRAPE_PROFILE_THREAD(name) ::grape::Profiler::getInstance().setThreadName(name)
+#else
+#define GRAPE_PROFILE_SCOPE(name) ((void)0)
+#define GRAPE_PROFILE_FUNCTION() ((void)0)
+#define GRAPE_PROFILE_FRAME() ((void)0)
+#define GRAPE_PROFILE_THREAD(name) ((void)0)
+#endif
@@ -0,0 +1,198 @@
+#include "startup_graph.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+
+namespace grape {
+
+    namespace {
+        constexpr int TIMELINE_WIDTH = 48;
+    }
+
+    StartupGraph::StartupGraph(std::string name) : name{ std::move(name) } {
+    }
+
+    StartupTaskId StartupGraph::add(std::string taskName, std::function<void()> work, const std::vector<StartupTaskId>& dependencies) {
+        const StartupTaskId id = static_cast<StartupTaskId>(tasks.size());
+        for (StartupTaskId dependency : dependencies) {
+            if (dependency >= id) {
+                throw std::runtime_error("startup task " + taskName + " depends on a task that doesn't exist yet!");
+            }
+        }
+
+        auto task = std::make_unique<Task>();
+        task->name = std::move(taskName);
+        task->work = std::move(work);
+        task->dependencies = dependencies;
+        for (StartupTaskId dependency : dependencies) {
+            tasks[dependency]->dependents.push_back(id);
+        }
+        tasks.push_back(std::move(task));
+        return id;
+    }
+
+    StartupTaskId StartupGraph::addMeasured(std::string taskName, uint64_t startNs, uint64_t endNs, const std::vector<StartupTaskId>& dependencies) {
+        StartupTaskId id = add(std::move(taskName), nullptr, dependencies);
+        tasks[id]->measured = true;
+        tasks[id]->startNs = startNs;
+        tasks[id]->endNs = endNs;
+        return id;
+    }
+
+    void StartupGraph::run() {
+        GRAPE_PROFILE_SCOPE("Startup Graph");
+        JobCounter done;
+        counter = &done;
+
+        // Everything is counted before anything runs, a fast task can't start a dependent early
+        for (auto& task : tasks) {
+            task->remaining.store(static_cast<uint32_t>(task->dependencies.size()), std::memory_order_relaxed);
+        }
+        for (StartupTaskId id = 0; id < tasks.size(); id++) {
+            if (tasks[id]->dependencies.empty()) {
+                launch(id);
+            }
+        }
+        JobSystem::getInstance().wait(done);
+        counter = nullptr;
+
+        if (error) {
+            std::exception_ptr first = error;
+            error = nullptr;
+            std::rethrow_exception(first);
+        }
+    }
+
+    void StartupGraph::launch(StartupTaskId id) {
+        // Measured tasks already ran, they only pass completion on
+        if (tasks[id]->measured) {
+            execute(id);
+            return;
+        }
+        JobSystem::getInstance().schedule([this, id]() { execute(id); }, counter);
+    }
+
+    void StartupGraph::execute(StartupTaskId id) {
+        Task& task = *tasks[id];
+        for (StartupTaskId dependency : task.dependencies) {
+            task.failed = task.failed || tasks[dependency]->failed;
+        }
+
+        if (!task.measured && !task.failed) {
+            GRAPE_PROFILE_SCOPE("Startup Task");
+            task.thread = JobSystem::getCurrentWorkerIndex();
+            task.startNs = Profiler::now();
+            try {
+                task.work();
+            }
+            catch (...) {
+                task.failed = true;
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) error = std::current_exception();
+            }
+            task.endNs = Profiler::now();
+        }
+
+        // Dependents are scheduled on the same counter before this job finishes, so run() can't
+        // see it hit zero in between
+        for (StartupTaskId dependent : task.dependents) {
+            if (tasks[dependent]->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                launch(dependent);
+            }
+        }
+    }
+
+    std::vector<StartupTaskId> StartupGraph::findCriticalPath() const {
+        std::vector<StartupTaskId> path;
+        if (tasks.empty()) return path;
+
+        // Back from the last task to finish, through whichever dependency finished last (the one it
+        // actually waited for)
+        StartupTaskId current = 0;
+        for (StartupTaskId id = 1; id < tasks.size(); id++) {
+            if (tasks[id]->endNs > tasks[current]->endNs) current = id;
+        }
+        while (true) {
+            path.push_back(current);
+            const auto& dependencies = tasks[current]->dependencies;
+            if (dependencies.empty()) break;
+            current = *std::max_element(dependencies.begin(), dependencies.end(),
+                [this](StartupTaskId a, StartupTaskId b) { return tasks[a]->endNs < tasks[b]->endNs; });
+        }
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+
+    void StartupGraph::printReport(std::ostream& out) const {
+        uint64_t firstNs = UINT64_MAX;
+        uint64_t lastNs = 0;
+        double workMs = 0.0;
+        size_t nameWidth = 4;
+        for (const auto& task : tasks) {
+            nameWidth = std::max(nameWidth, task->name.size());
+            // Skipped, never ran
+            if (task->endNs == 0) continue;
+            firstNs = std::min(firstNs, task->startNs);
+            lastNs = std::max(lastNs, task->endNs);
+            workMs += static_cast<double>(task->endNs - task->startNs) / 1e6;
+        }
+        if (lastNs == 0) return;
+        const double totalMs = static_cast<double>(lastNs - firstNs) / 1e6;
+        auto toMs = [firstNs](uint64_t ns) { return static_cast<double>(ns - firstNs) / 1e6; };
+
+        std::vector<StartupTaskId> criticalPath = findCriticalPath();
+        std::vector<bool> critical(tasks.size(), false);
+        double criticalMs = 0.0;
+        for (StartupTaskId id : criticalPath) {
+            critical[id] = true;
+            criticalMs += static_cast<double>(tasks[id]->endNs - tasks[id]->startNs) / 1e6;
+        }
+
+        char line[256];
+        std::snprintf(line, sizeof(line), "%s startup: %.1f ms, %.1f ms of work over %zu tasks (%.2fx), critical path %.1f ms\n",
+            name.c_str(), totalMs, workMs, tasks.size(), totalMs > 0.0 ? workMs / totalMs : 1.0, criticalMs);
+        out << line;
+        std::snprintf(line, sizeof(line), "    %-*s %9s %9s  %-7s\n", static_cast<int>(nameWidth), "task", "start ms", "ms", "thread");
+        out << line;
+
+        for (StartupTaskId id = 0; id < tasks.size(); id++) {
+            const Task& task = *tasks[id];
+            char thread[16];
+            if (task.measured || task.endNs == 0) std::snprintf(thread, sizeof(thread), "-");
+            else if (task.thread < 0) std::snprintf(thread, sizeof(thread), "main");
+            else std::snprintf(thread, sizeof(thread), "worker%d", task.thread);
+
+            // '#' where the task ran, scaled to the whole startup
+            char bar[TIMELINE_WIDTH + 1];
+            std::fill(bar, bar + TIMELINE_WIDTH, ' ');
+            bar[TIMELINE_WIDTH] = '\0';
+            if (task.failed) {
+                std::snprintf(line, sizeof(line), "  %c %-*s %9s %9s  %-7s  %s\n", ' ', static_cast<int>(nameWidth),
+                    task.name.c_str(), "-", "-", thread, task.endNs != 0 ? "failed" : "skipped");
+                out << line;
+                continue;
+            }
+            if (totalMs > 0.0) {
+                int begin = static_cast<int>(toMs(task.startNs) / totalMs * TIMELINE_WIDTH);
+                int end = static_cast<int>(toMs(task.endNs) / totalMs * TIMELINE_WIDTH);
+                begin = std::clamp(begin, 0, TIMELINE_WIDTH - 1);
+                end = std::clamp(end, begin + 1, TIMELINE_WIDTH);
+                std::fill(bar + begin, bar + end, critical[id] ? '#' : '=');
+            }
+
+            std::snprintf(line, sizeof(line), "  %c %-*s %9.1f %9.1f  %-7s |%s|\n", critical[id] ? '*' : ' ',
+                static_cast<int>(nameWidth), task.name.c_str(), toMs(task.startNs),
+                static_cast<double>(task.endNs - task.startNs) / 1e6, thread, bar);
+            out << line;
+        }
+
+        out << "  critical path (*):";
+        for (size_t i = 0; i < criticalPath.size(); i++) {
+            out << (i == 0 ? " " : " -> ") << tasks[criticalPath[i]]->name;
+        }
+        out << std::endl;
+    }
+}
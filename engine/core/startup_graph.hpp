@@ -0,0 +1,68 @@
+#pragma once
+
+#include "job_system.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace grape {
+
+    using StartupTaskId = uint32_t;
+
+    // Init work as a dependency graph. run() starts every task whose dependencies are done on the
+    // job system (the calling thread helps), so independent loads overlap instead of queueing up
+    // behind each other. Tasks can only depend on tasks added before them, so there are no cycles
+    class StartupGraph {
+    public:
+        explicit StartupGraph(std::string name);
+
+        StartupGraph(const StartupGraph&) = delete;
+        StartupGraph& operator=(const StartupGraph&) = delete;
+
+        // Throws if a dependency isn't an earlier task. Nothing GLFW or otherwise main thread only
+        StartupTaskId add(std::string name, std::function<void()> work, const std::vector<StartupTaskId>& dependencies = {});
+        // Work that already happened outside the graph (constructor members), for the report and
+        // as a dependency
+        StartupTaskId addMeasured(std::string name, uint64_t startNs, uint64_t endNs, const std::vector<StartupTaskId>& dependencies = {});
+
+        // Blocks until every task has run. A task that throws skips everything depending on it,
+        // the first exception is rethrown here once the rest are done
+        void run();
+
+        // Timeline of the run, one row a task, with the critical path (the chain of dependencies
+        // that held up the last task to finish) marked
+        void printReport(std::ostream& out = std::cout) const;
+
+    private:
+        struct Task {
+            std::string name;
+            std::function<void()> work;
+            std::vector<StartupTaskId> dependencies;
+            std::vector<StartupTaskId> dependents;
+            std::atomic<uint32_t> remaining{ 0 };
+            uint64_t startNs = 0;
+            uint64_t endNs = 0;
+            int thread = -1;            // Job system worker, -1 for the thread that called run
+            bool measured = false;
+            bool failed = false;        // Threw, or a dependency did
+        };
+
+        void launch(StartupTaskId id);
+        void execute(StartupTaskId id);
+        std::vector<StartupTaskId> findCriticalPath() const;
+
+        std::string name;
+        std::vector<std::unique_ptr<Task>> tasks;
+
+        std::mutex errorMutex;
+        std::exception_ptr error;
+        JobCounter* counter = nullptr;  // run()'s, while it's running
+    };
+}
@@ -0,0 +1,316 @@
+#include "telemetry.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#if defined(_MSC_VER)
+#pragma comment(lib, "ws2_32.lib")
+#endif
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace grape {
+
+    namespace {
+        constexpr char MAGIC[4] = { 'G', 'R', 'T', 'M' };
+
+        struct ZoneColumn {
+            const char* zone;       // Profiler zone name, string literal or __func__
+            const char* column;
+        };
+
+        constexpr ZoneColumn ZONES[] = {
+            { "Poll Events", "poll_events" },
+            { "Camera Update", "camera_update" },
+            { "updateScene", "update_scene" },
+            { "tick", "simulation_tick" },
+            { "StepPhysics", "step_physics" },
+            { "updateLights", "update_lights" },
+            { "Record Viewport", "record_viewport" },
+            { "Record Chunk", "record_chunk" },
+            { "UI Build", "ui_build" },
+            { "UI Record", "ui_record" },
+            { "Acquire", "acquire" },
+            { "Submit", "submit" },
+            { "waitForFrameSlot", "frame_limiter" },
+        };
+        static_assert(std::size(ZONES) == Telemetry::ZONE_COUNT, "ZONES and the documented schema are out of sync");
+
+        constexpr const char* COUNTER_COLUMNS[] = {
+            "draw_calls", "triangles", "pipeline_binds", "descriptor_set_binds", "vertex_buffer_binds", "index_buffer_binds"
+        };
+        constexpr const char* GAUGE_COLUMNS[] = { "physics_step_us", "dynamic_bodies", "awake_bodies" };
+        static_assert(std::size(COUNTER_COLUMNS) == static_cast<size_t>(PerfCounter::Count), "missing counter column");
+        static_assert(std::size(GAUGE_COLUMNS) == static_cast<size_t>(PerfGauge::Count), "missing gauge column");
+
+        constexpr size_t RECORD_SIZE = 8 + 8 + 3 * 4 + Telemetry::ZONE_COUNT * 4 +
+            static_cast<size_t>(PerfCounter::Count) * 8 + static_cast<size_t>(PerfGauge::Count) * 8 + 4 * 4 + 2 * 8;
+        constexpr size_t DATAGRAM_HEADER = sizeof(MAGIC) + 4;
+        constexpr size_t MAX_ROW = 1024;
+
+        void putBytes(uint8_t*& out, uint64_t value, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                *out++ = static_cast<uint8_t>(value >> (8 * i));
+            }
+        }
+
+        void putFloat(uint8_t*& out, float value) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            putBytes(out, bits, 4);
+        }
+
+        // soak.csv -> soak.0003.csv
+        std::string rotatedPath(const std::string& path, uint32_t index) {
+            std::filesystem::path base{ path };
+            char suffix[16];
+            std::snprintf(suffix, sizeof(suffix), ".%04u", index);
+            std::filesystem::path rotated = base.parent_path() / (base.stem().string() + suffix + base.extension().string());
+            return rotated.string();
+        }
+
+#if defined(_WIN32)
+        using SocketHandle = SOCKET;
+        void closeSocket(std::intptr_t handle) { closesocket(static_cast<SocketHandle>(handle)); }
+#else
+        using SocketHandle = int;
+        void closeSocket(std::intptr_t handle) { close(static_cast<SocketHandle>(handle)); }
+#endif
+    }
+
+    Telemetry::Telemetry(const TelemetrySettings& settings) : settings{ settings } {
+        std::string extension = std::filesystem::path{ settings.file }.extension().string();
+        csv = extension == ".csv" || extension == ".CSV";
+
+        columns = "frame,time_us,frame_ms,cpu_ms,gpu_ms";
+        for (const auto& zone : ZONES) columns += std::string(",zone_") + zone.column + "_ms";
+        for (const char* column : COUNTER_COLUMNS) columns += std::string(",") + column;
+        for (const char* column : GAUGE_COLUMNS) columns += std::string(",") + column;
+        columns += ",objects,frustum_culled,occlusion_culled,meshlets_culled,cpu_memory_bytes,gpu_memory_bytes";
+
+        record.resize(DATAGRAM_HEADER + RECORD_SIZE);
+        row.resize(MAX_ROW);
+        // Big enough that fwrite only hits the OS every few hundred frames
+        fileBuffer.resize(256 * 1024);
+
+        if (!settings.file.empty()) {
+            openFile();
+        }
+
+        if (settings.udpPort != 0) {
+#if defined(_WIN32)
+            WSADATA wsaData;
+            if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+                throw std::runtime_error("failed to initialize winsock for telemetry!");
+            }
+            SOCKET handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            if (handle == INVALID_SOCKET) {
+                WSACleanup();
+                throw std::runtime_error("failed to open telemetry socket!");
+            }
+            // A full send buffer drops the frame instead of stalling it
+            u_long nonBlocking = 1;
+            ioctlsocket(handle, FIONBIO, &nonBlocking);
+            udpSocket = static_cast<std::intptr_t>(handle);
+#else
+            int handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            if (handle < 0) {
+                throw std::runtime_error("failed to open telemetry socket!");
+            }
+            // A full send buffer drops the frame instead of stalling it
+            fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+            udpSocket = handle;
+#endif
+
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(settings.udpPort);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            // Connected so publish can use send, and nothing else can land on the socket
+            if (connect(static_cast<SocketHandle>(udpSocket), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+                closeSocket(udpSocket);
+                udpSocket = -1;
+#if defined(_WIN32)
+                WSACleanup();
+#endif
+                throw std::runtime_error("failed to connect telemetry socket to port " + std::to_string(settings.udpPort) + "!");
+            }
+
+            uint8_t* out = record.data();
+            std::memcpy(out, MAGIC, sizeof(MAGIC));
+            out += sizeof(MAGIC);
+            putBytes(out, VERSION, 4);
+            std::cout << "Telemetry: sending frames to 127.0.0.1:" << settings.udpPort << std::endl;
+        }
+    }
+
+    Telemetry::~Telemetry() {
+        if (file) {
+            std::fclose(file);
+        }
+        if (udpSocket != -1) {
+            closeSocket(udpSocket);
+#if defined(_WIN32)
+            WSACleanup();
+#endif
+        }
+    }
+
+    void Telemetry::openFile() {
+        if (file) {
+            std::fclose(file);
+            file = nullptr;
+        }
+
+        std::string path = rotatedPath(settings.file, fileIndex);
+        file = std::fopen(path.c_str(), csv ? "w" : "wb");
+        if (!file) {
+            throw std::runtime_error("failed to create telemetry file " + path + "!");
+        }
+        std::setvbuf(file, fileBuffer.data(), _IOFBF, fileBuffer.size());
+
+        if (settings.keepFiles > 0 && fileIndex >= settings.keepFiles) {
+            std::error_code error;
+            std::filesystem::remove(rotatedPath(settings.file, fileIndex - settings.keepFiles), error);
+        }
+        std::cout << "Telemetry: writing frames to " << path << std::endl;
+
+        fileIndex++;
+        fileBytes = 0;
+        writeFileHeader();
+    }
+
+    void Telemetry::writeFileHeader() {
+        if (csv) {
+            fileBytes += std::fprintf(file, "%s\n", columns.c_str());
+            return;
+        }
+
+        uint8_t header[sizeof(MAGIC) + 12];
+        uint8_t* out = header;
+        std::memcpy(out, MAGIC, sizeof(MAGIC));
+        out += sizeof(MAGIC);
+        putBytes(out, VERSION, 4);
+        putBytes(out, RECORD_SIZE, 4);
+        putBytes(out, columns.size(), 4);
+        fileBytes += std::fwrite(header, 1, sizeof(header), file);
+        fileBytes += std::fwrite(columns.data(), 1, columns.size(), file);
+    }
+
+    void Telemetry::sumZones() {
+        std::memset(zoneMs, 0, sizeof(zoneMs));
+
+        const Profiler& profiler = Profiler::getInstance();
+        const auto& frames = profiler.getFrames();
+        // While paused the newest frame is an old one
+        if (frames.empty() || profiler.isPaused()) return;
+
+        for (const auto& zone : frames.back().zones) {
+            for (size_t i = 0; i < ZONE_COUNT; i++) {
+                if (std::strcmp(zone.name, ZONES[i].zone) == 0) {
+                    zoneMs[i] += static_cast<float>(zone.endNs - zone.startNs) / 1e6f;
+                    break;
+                }
+            }
+        }
+    }
+
+    size_t Telemetry::encodeRecord(const PerfFrame& frame, uint64_t timeUs, uint8_t* out) const {
+        uint8_t* start = out;
+        putBytes(out, frame.frame, 8);
+        putBytes(out, timeUs, 8);
+        putFloat(out, frame.frameMs);
+        putFloat(out, frame.cpuMs);
+        putFloat(out, frame.gpuMs);
+        for (float ms : zoneMs) putFloat(out, ms);
+        for (uint64_t value : frame.counters) putBytes(out, value, 8);
+        for (int64_t value : frame.gauges) putBytes(out, static_cast<uint64_t>(value), 8);
+        putBytes(out, frame.objects, 4);
+        putBytes(out, frame.frustumCulled, 4);
+        putBytes(out, frame.occlusionCulled, 4);
+        putBytes(out, frame.meshletsCulled, 4);
+        putBytes(out, static_cast<uint64_t>(frame.cpuMemoryBytes), 8);
+        putBytes(out, static_cast<uint64_t>(frame.gpuMemoryBytes), 8);
+        return static_cast<size_t>(out - start);
+    }
+
+    size_t Telemetry::formatCsvRow(const PerfFrame& frame, uint64_t timeUs, char* out, size_t size) const {
+        size_t used = 0;
+        auto append = [&](const char* format, auto value) {
+            if (used >= size) return;
+            int written = std::snprintf(out + used, size - used, format, value);
+            if (written > 0) used += static_cast<size_t>(written);
+        };
+
+        append("%" PRIu64, frame.frame);
+        append(",%" PRIu64, timeUs);
+        append(",%.3f", frame.frameMs);
+        append(",%.3f", frame.cpuMs);
+        append(",%.3f", frame.gpuMs);
+        for (float ms : zoneMs) append(",%.3f", ms);
+        for (uint64_t value : frame.counters) append(",%" PRIu64, value);
+        for (int64_t value : frame.gauges) append(",%" PRId64, value);
+        append(",%u", frame.objects);
+        append(",%u", frame.frustumCulled);
+        append(",%u", frame.occlusionCulled);
+        append(",%u", frame.meshletsCulled);
+        append(",%" PRId64, frame.cpuMemoryBytes);
+        append(",%" PRId64, frame.gpuMemoryBytes);
+        append("%s", "\n");
+        return std::min(used, size - 1);
+    }
+
+    void Telemetry::publish(const PerfFrame& frame) {
+        if (frame.frame == 0 || frame.frame == lastPublished) return;
+        lastPublished = frame.frame;
+
+        uint64_t nowNs = Profiler::now();
+        if (firstNs == 0) firstNs = nowNs;
+        uint64_t timeUs = (nowNs - firstNs) / 1000;
+
+        sumZones();
+        size_t recordSize = encodeRecord(frame, timeUs, record.data() + DATAGRAM_HEADER);
+
+        if (file && settings.rotateBytes > 0 && fileBytes >= settings.rotateBytes) {
+            // A full disk shouldn't end a soak run, the socket (if any) keeps going
+            try {
+                openFile();
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Telemetry: " << e.what() << " File output stopped" << std::endl;
+            }
+        }
+        if (file) {
+            if (csv) {
+                size_t length = formatCsvRow(frame, timeUs, row.data(), row.size());
+                fileBytes += std::fwrite(row.data(), 1, length, file);
+            }
+            else {
+                fileBytes += std::fwrite(record.data() + DATAGRAM_HEADER, 1, recordSize, file);
+            }
+        }
+
+        if (udpSocket != -1) {
+            // Nobody listening or a full buffer just loses the frame
+            send(static_cast<SocketHandle>(udpSocket), reinterpret_cast<const char*>(record.data()),
+                static_cast<int>(DATAGRAM_HEADER + recordSize), 0);
+        }
+    }
+}
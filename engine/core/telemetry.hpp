@@ -0,0 +1,90 @@
+#pragma once
+
+#include "perf_counters.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace grape {
+
+    // Where --telemetry/--telemetry-udp stream every frame's PerfFrame, empty file and port 0 for none
+    struct TelemetrySettings {
+        std::string file;                               // .csv for text, anything else is the binary format
+        uint16_t udpPort = 0;                           // Datagrams to 127.0.0.1:udpPort
+        uint64_t rotateBytes = 256ull * 1024 * 1024;    // Starts the next file past this, 0 never
+        uint32_t keepFiles = 8;                         // Oldest files get deleted past this many, 0 keeps all
+
+        static TelemetrySettings& getInstance() {
+            static TelemetrySettings instance;
+            return instance;
+        }
+    };
+
+    // Per-frame metrics for soak runs, one record a frame. Columns, in this order:
+    //
+    //   frame              u64   PerfFrame::frame
+    //   time_us            u64   Since the first record
+    //   frame_ms           f32   Start to start
+    //   cpu_ms             f32   Main thread work, no limiter or GPU wait
+    //   gpu_ms             f32   Latest resolved GPU frame
+    //   zone_*_ms          f32   ZONE_COUNT profiler zones summed over all threads (0 with the profiler
+    //                            paused or compiled out): poll_events, camera_update, update_scene,
+    //                            simulation_tick, step_physics, update_lights, record_viewport,
+    //                            record_chunk, ui_build, ui_record, acquire, submit, frame_limiter
+    //   draw_calls, triangles, pipeline_binds, descriptor_set_binds,
+    //   vertex_buffer_binds, index_buffer_binds                      u64
+    //   physics_step_us, dynamic_bodies, awake_bodies                i64
+    //   objects, frustum_culled, occlusion_culled, meshlets_culled   u32
+    //   cpu_memory_bytes, gpu_memory_bytes                           i64
+    //
+    // CSV files have a header row with those names. Binary files start with "GRTM", a u32 version,
+    // the u32 record size, a u32 length and that many bytes of the comma separated column names,
+    // then fixed size records with no padding. UDP datagrams are "GRTM", the u32 version and one
+    // record. Everything binary is little-endian. Each rotated file has its own header, files are
+    // named like soak.0003.csv for --telemetry soak.csv
+    //
+    // publish doesn't allocate: records are encoded into a fixed buffer and written through a
+    // stdio buffer sized at construction, only opening the next file on rotation does
+    class Telemetry {
+    public:
+        static constexpr uint32_t VERSION = 1;
+        static constexpr size_t ZONE_COUNT = 13;
+
+        // Throws if the file can't be created or the socket can't be opened
+        explicit Telemetry(const TelemetrySettings& settings);
+        ~Telemetry();
+
+        Telemetry(const Telemetry&) = delete;
+        Telemetry& operator=(const Telemetry&) = delete;
+
+        // Once per frame, after the profiler has drained the frame's zones (GRAPE_PROFILE_FRAME).
+        // Frames already published are skipped
+        void publish(const PerfFrame& frame);
+
+    private:
+        void openFile();
+        void writeFileHeader();
+        size_t encodeRecord(const PerfFrame& frame, uint64_t timeUs, uint8_t* out) const;
+        size_t formatCsvRow(const PerfFrame& frame, uint64_t timeUs, char* out, size_t size) const;
+        void sumZones();
+
+        TelemetrySettings settings;
+        bool csv = false;
+        std::string columns;
+
+        std::FILE* file = nullptr;
+        std::vector<char> fileBuffer;
+        uint64_t fileBytes = 0;
+        uint32_t fileIndex = 0;
+
+        std::intptr_t udpSocket = -1;
+
+        std::vector<uint8_t> record;
+        std::vector<char> row;
+        float zoneMs[ZONE_COUNT] = {};
+        uint64_t firstNs = 0;
+        uint64_t lastPublished = 0;
+    };
+}
@@ -1,10 +1,134 @@
 #include "core/app.hpp"
+#include "core/headless_app.hpp"
+#include "scene/stress_scene.hpp"
 
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+
+namespace {
+	VkPresentModeKHR parsePresentMode(const std::string& name) {
+		if (name == "fifo") return VK_PRESENT_MODE_FIFO_KHR;
+		if (name == "fifo-relaxed") return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+		if (name == "mailbox") return VK_PRESENT_MODE_MAILBOX_KHR;
+		if (name == "immediate") return VK_PRESENT_MODE_IMMEDIATE_KHR;
+		throw std::runtime_error("unknown present mode '" + name + "' (fifo, fifo-relaxed, mailbox, immediate)");
+	}
+
+	VkExtent2D parseSize(const std::string& size) {
+		unsigned width = 0;
+		unsigned height = 0;
+		if (std::sscanf(size.c_str(), "%ux%u", &width, &height) != 2 || width == 0 || height == 0) {
+			throw std::runtime_error("bad size '" + size + "', expected WIDTHxHEIGHT");
+		}
+		return { width, height };
+	}
+
+	struct LaunchOptions {
+		bool headless = false;
+		grape::HeadlessSettings headlessSettings{};
+	};
+
+	LaunchOptions parseArgs(int argc, char** argv) {
+		auto& pacing = grape::FramePacingSettings::getInstance();
+		auto& stress = grape::StressSceneSettings::getInstance();
+		LaunchOptions options{};
+
+		for (int i = 1; i < argc; i++) {
+			bool hasValue = i + 1 < argc;
+			if (std::strcmp(argv[i], "--present-mode") == 0 && hasValue) {
+				pacing.presentMode = parsePresentMode(argv[++i]);
+			} else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && hasValue) {
+				pacing.framesInFlight = std::atoi(argv[++i]);
+			} else if (std::strcmp(argv[i], "--fps-limit") == 0 && hasValue) {
+				pacing.frameRateLimit = std::atoi(argv[++i]);
+			} else if (std::strcmp(argv[i], "--headless") == 0) {
+				options.headless = true;
+			} else if (std::strcmp(argv[i], "--frames") == 0 && hasValue) {
+				options.headlessSettings.frames = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 1));
+			} else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) {
+				options.headlessSettings.warmupFrames = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 0));
+			} else if (std::strcmp(argv[i], "--size") == 0 && hasValue) {
+				options.headlessSettings.extent = parseSize(argv[++i]);
+			} else if (std::strcmp(argv[i], "--dump-dir") == 0 && hasValue) {
+				options.headlessSettings.dumpDir = argv[++i];
+			} else if (std::strcmp(argv[i], "--trace") == 0 && hasValue) {
+				options.headlessSettings.traceFile = argv[++i];
+			} else if (std::strcmp(argv[i], "--memory-report") == 0 && hasValue) {
+				options.headlessSettings.memoryReport = argv[++i];
+			} else if (std::strcmp(argv[i], "--record") == 0 && hasValue) {
+				grape::InputCaptureSettings::getInstance().recordFile = argv[++i];
+			} else if (std::strcmp(argv[i], "--replay") == 0 && hasValue) {
+				// Replays always run offscreen
+				options.headless = true;
+				options.headlessSettings.replayFile = argv[++i];
+			} else if (std::strcmp(argv[i], "--frame-log") == 0 && hasValue) {
+				options.headlessSettings.frameLog = argv[++i];
+			} else if (std::strcmp(argv[i], "--telemetry") == 0 && hasValue) {
+				grape::TelemetrySettings::getInstance().file = argv[++i];
+			} else if (std::strcmp(argv[i], "--telemetry-udp") == 0 && hasValue) {
+				grape::TelemetrySettings::getInstance().udpPort = static_cast<uint16_t>(std::clamp(std::atoi(argv[++i]), 0, 65535));
+			} else if (std::strcmp(argv[i], "--telemetry-rotate-mb") == 0 && hasValue) {
+				grape::TelemetrySettings::getInstance().rotateBytes = static_cast<uint64_t>(std::max(std::atoi(argv[++i]), 0)) * 1024 * 1024;
+			} else if (std::strcmp(argv[i], "--telemetry-files") == 0 && hasValue) {
+				grape::TelemetrySettings::getInstance().keepFiles = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 0));
+			} else if (std::strcmp(argv[i], "--hitch-capture") == 0 && hasValue) {
+				grape::HitchSettings::getInstance().directory = argv[++i];
+			} else if (std::strcmp(argv[i], "--hitch-budget") == 0 && hasValue) {
+				grape::HitchSettings::getInstance().medianMultiple = std::max(static_cast<float>(std::atof(argv[++i])), 1.f);
+			} else if (std::strcmp(argv[i], "--hitch-min-ms") == 0 && hasValue) {
+				grape::HitchSettings::getInstance().minimumMs = std::max(static_cast<float>(std::atof(argv[++i])), 0.f);
+			} else if (std::strcmp(argv[i], "--hitch-frames") == 0 && hasValue) {
+				grape::HitchSettings::getInstance().frames = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 1));
+			} else if (std::strcmp(argv[i], "--dump-every") == 0 && hasValue) {
+				options.headlessSettings.dumpEvery = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 1));
+			} else if (std::strcmp(argv[i], "--stress") == 0 && hasValue) {
+				stress.enabled = true;
+				stress.instances = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 0));
+			} else if (std::strcmp(argv[i], "--stress-meshes") == 0 && hasValue) {
+				stress.uniqueMeshes = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 1));
+			} else if (std::strcmp(argv[i], "--stress-textures") == 0 && hasValue) {
+				stress.textures = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 1));
+			} else if (std::strcmp(argv[i], "--stress-lights") == 0 && hasValue) {
+				stress.pointLights = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 0));
+			} else if (std::strcmp(argv[i], "--stress-bodies") == 0 && hasValue) {
+				stress.dynamicBodies = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 0));
+			} else if (std::strcmp(argv[i], "--stress-seed") == 0 && hasValue) {
+				stress.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			} else {
+				std::cerr << "Ignoring unknown argument: " << argv[i] << '\n';
+			}
+		}
+
+		return options;
+	}
+}
+
+int main(int argc, char** argv) {
+	LaunchOptions options{};
+	try {
+		options = parseArgs(argc, argv);
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+
+	// Offscreen only, no window or swapchain (CI on lavapipe, benchmarks)
+	if (options.headless) {
+		try {
+			grape::HeadlessApp app{ options.headlessSettings };
+			app.run();
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << '\n';
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
 
-int main() {
 	grape::App app{};
 
 	try {
@@ -15,4 +139,4 @@ int main() {
 	}
 
 	return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -49,7 +49,7 @@ namespace grape {
     Buffer::~Buffer() {
         unmap();
         vkDestroyBuffer(grapeDevice.device(), buffer, nullptr);
-        vkFreeMemory(grapeDevice.device(), memory, nullptr);
+        grapeDevice.freeMemory(memory);
     }
 
     /**
@@ -12,6 +12,8 @@ namespace grape {
         // glm::ortho doesn't have a direct Y-down option, so we flip it manually.
         projectionMatrix = glm::ortho(left, right, bottom, top, near, far);
         projectionMatrix[1][1] *= -1.0f;
+        nearClip = near;
+        farClip = far;
     }
 
     void Camera::setPerspectiveProjection(float fovy, float aspect, float near, float far) {
@@ -20,6 +22,8 @@ namespace grape {
 
         // Now, manually flip the Y-axis to match Vulkan's Y-down convention
         projectionMatrix[1][1] *= -1.0f;
+        nearClip = near;
+        farClip = far;
     }
 
     void Camera::setViewDirection(glm::vec3 position, glm::vec3 direction, glm::vec3 up) {
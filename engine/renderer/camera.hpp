@@ -21,11 +21,15 @@ namespace grape {
 		const glm::mat4& getProjection() const { return projectionMatrix; }
 		const glm::mat4& getView() const { return viewMatrix; }
 		const glm::mat4& getInverseView() const { return inverseViewMatrix; }
+		float getNearClip() const { return nearClip; }
+		float getFarClip() const { return farClip; }
 
 	private:
 
 		glm::mat4 projectionMatrix{ 1.f };
 		glm::mat4 viewMatrix{ 1.f };
 		glm::mat4 inverseViewMatrix{ 1.f };
+		float nearClip = 0.1f;
+		float farClip = 1000.f;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include "culling.hpp"
+#include "core/job_system.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace grape {
+
+    void transformBounds(const glm::mat4& transform, const glm::vec3& localMin, const glm::vec3& localMax,
+        glm::vec3& worldMin, glm::vec3& worldMax) {
+        glm::vec3 center = (localMin + localMax) * 0.5f;
+        glm::vec3 extent = (localMax - localMin) * 0.5f;
+
+        glm::vec3 worldCenter = glm::vec3(transform * glm::vec4(center, 1.f));
+        glm::vec3 worldExtent{ 0.f };
+        for (int axis = 0; axis < 3; axis++) {
+            worldExtent += glm::abs(glm::vec3(transform[axis])) * extent[axis];
+        }
+
+        worldMin = worldCenter - worldExtent;
+        worldMax = worldCenter + worldExtent;
+    }
+
+    Frustum::Frustum(const glm::mat4& viewProjection) {
+        auto row = [&](int i) {
+            return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        };
+
+        planes[0] = row(3) + row(0);    // left
+        planes[1] = row(3) - row(0);    // right
+        planes[2] = row(3) + row(1);    // top/bottom
+        planes[3] = row(3) - row(1);
+        planes[4] = row(2);             // near, depth is 0..1
+        planes[5] = row(3) - row(2);    // far
+    }
+
+    bool Frustum::intersectsBox(const glm::vec3& min, const glm::vec3& max) const {
+        for (const auto& plane : planes) {
+            // Corner furthest along the plane normal, if even that is outside the whole box is
+            glm::vec3 positive{
+                plane.x >= 0.f ? max.x : min.x,
+                plane.y >= 0.f ? max.y : min.y,
+                plane.z >= 0.f ? max.z : min.z
+            };
+            if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void DepthPyramid::build(const float* depth, uint32_t width, uint32_t height, const glm::mat4& viewProj) {
+        sourceWidth = width;
+        sourceHeight = height;
+        viewProjection = viewProj;
+
+        // Halving rounds up and the 2x2 footprint is clamped at the edge, so an odd last
+        // row/column still lands in some texel and nothing is ever dropped
+        auto& jobs = JobSystem::getInstance();
+        const float* src = depth;
+        uint32_t srcWidth = width;
+        uint32_t srcHeight = height;
+
+        size_t levelCount = 0;
+        while (true) {
+            if (levels.size() <= levelCount) {
+                levels.emplace_back();
+            }
+            Level& level = levels[levelCount];
+            level.width = std::max(1u, (srcWidth + 1) / 2);
+            level.height = std::max(1u, (srcHeight + 1) / 2);
+            level.depth.resize(static_cast<size_t>(level.width) * level.height);
+
+            jobs.parallelFor(level.height, 32, [&](size_t begin, size_t end) {
+                for (size_t y = begin; y < end; y++) {
+                    size_t y0 = y * 2;
+                    size_t y1 = std::min<size_t>(y0 + 1, srcHeight - 1);
+                    const float* row0 = src + y0 * srcWidth;
+                    const float* row1 = src + y1 * srcWidth;
+                    float* out = level.depth.data() + y * level.width;
+
+                    for (size_t x = 0; x < level.width; x++) {
+                        size_t x0 = x * 2;
+                        size_t x1 = std::min<size_t>(x0 + 1, srcWidth - 1);
+                        out[x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+                    }
+                }
+            });
+
+            levelCount++;
+            if (level.width == 1 && level.height == 1) break;
+
+            src = level.depth.data();
+            srcWidth = level.width;
+            srcHeight = level.height;
+        }
+
+        levels.resize(levelCount);
+        valid = true;
+    }
+
+    bool DepthPyramid::isOccluded(const glm::vec3& min, const glm::vec3& max) const {
+        if (!valid) return false;
+
+        glm::vec2 ndcMin{ 1.f };
+        glm::vec2 ndcMax{ -1.f };
+        float nearestDepth = 1.f;
+
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec4 position{
+                (corner & 1) ? max.x : min.x,
+                (corner & 2) ? max.y : min.y,
+                (corner & 4) ? max.z : min.z,
+                1.f
+            };
+            glm::vec4 clip = viewProjection * position;
+
+            // Behind or touching the camera, the projected rect is meaningless
+            if (clip.w <= 1e-4f) return false;
+
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            ndcMin = glm::min(ndcMin, glm::vec2(ndc));
+            ndcMax = glm::max(ndcMax, glm::vec2(ndc));
+            nearestDepth = std::min(nearestDepth, ndc.z);
+        }
+
+        if (nearestDepth <= 0.f) return false;
+
+        // Outside the old view there's no depth to test against
+        if (ndcMax.x < -1.f || ndcMin.x > 1.f || ndcMax.y < -1.f || ndcMin.y > 1.f) return false;
+
+        ndcMin = glm::clamp(ndcMin, glm::vec2(-1.f), glm::vec2(1.f));
+        ndcMax = glm::clamp(ndcMax, glm::vec2(-1.f), glm::vec2(1.f));
+
+        auto toPixel = [](float ndc, uint32_t size) {
+            float pixel = std::floor((ndc * 0.5f + 0.5f) * static_cast<float>(size));
+            return static_cast<uint32_t>(std::clamp(pixel, 0.f, static_cast<float>(size - 1)));
+        };
+        uint32_t x0 = toPixel(ndcMin.x, sourceWidth);
+        uint32_t x1 = toPixel(ndcMax.x, sourceWidth);
+        uint32_t y0 = toPixel(ndcMin.y, sourceHeight);
+        uint32_t y1 = toPixel(ndcMax.y, sourceHeight);
+
+        // Finest level where the rect spans at most 4x4 texels
+        size_t levelIndex = 0;
+        for (; levelIndex + 1 < levels.size(); levelIndex++) {
+            uint32_t shift = static_cast<uint32_t>(levelIndex) + 1;
+            if ((x1 >> shift) - (x0 >> shift) < 4 && (y1 >> shift) - (y0 >> shift) < 4) break;
+        }
+
+        uint32_t shift = static_cast<uint32_t>(levelIndex) + 1;
+        const Level& level = levels[levelIndex];
+        float occluderDepth = maxDepth(level,
+            std::min(x0 >> shift, level.width - 1), std::min(y0 >> shift, level.height - 1),
+            std::min(x1 >> shift, level.width - 1), std::min(y1 >> shift, level.height - 1));
+
+        return nearestDepth > occluderDepth;
+    }
+
+    float DepthPyramid::maxDepth(const Level& level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) const {
+        float result = 0.f;
+        for (uint32_t y = y0; y <= y1; y++) {
+            const float* row = level.depth.data() + static_cast<size_t>(y) * level.width;
+            for (uint32_t x = x0; x <= x1; x++) {
+                result = std::max(result, row[x]);
+            }
+        }
+        return result;
+    }
+}
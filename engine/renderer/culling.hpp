@@ -0,0 +1,58 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace grape {
+
+    // World-space box of a model's local bounds under transform (center/extent form, exact for affine transforms)
+    void transformBounds(const glm::mat4& transform, const glm::vec3& localMin, const glm::vec3& localMax,
+        glm::vec3& worldMin, glm::vec3& worldMax);
+
+    // The six planes of a view-projection matrix (0..1 depth), normals point inside
+    class Frustum {
+    public:
+        Frustum() = default;
+        explicit Frustum(const glm::mat4& viewProjection);
+
+        bool intersectsBox(const glm::vec3& min, const glm::vec3& max) const;
+
+    private:
+        glm::vec4 planes[6]{};
+    };
+
+    // Max-depth pyramid built on the CPU from a depth readback of an earlier frame. Each texel
+    // holds the farthest depth under it, so a box whose nearest point is behind that is hidden
+    class DepthPyramid {
+    public:
+        // depth is width*height floats, row 0 at the top of the viewport
+        void build(const float* depth, uint32_t width, uint32_t height, const glm::mat4& viewProjection);
+        void clear() { valid = false; }    // Keeps the level allocations for the next build
+
+        bool isValid() const { return valid; }
+
+        // Tests a world-space box against the depth the pyramid was built from. Anything that
+        // can't be decided (off screen, crossing the near plane) counts as visible
+        bool isOccluded(const glm::vec3& min, const glm::vec3& max) const;
+
+    private:
+        struct Level {
+            uint32_t width;
+            uint32_t height;
+            std::vector<float> depth;
+        };
+
+        // Max over texels [x0,x1]x[y0,y1] of a level
+        float maxDepth(const Level& level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) const;
+
+        std::vector<Level> levels;      // levels[0] is half the source resolution
+        uint32_t sourceWidth = 0;
+        uint32_t sourceHeight = 0;
+        glm::mat4 viewProjection{ 1.f };
+        bool valid = false;
+    };
+}
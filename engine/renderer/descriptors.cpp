@@ -186,10 +186,14 @@ namespace grape {
             VK_SUCCESS) {
             throw std::runtime_error("failed to create descriptor pool!");
         }
+
+        for (const auto& poolSize : poolSizes) descriptorCapacity += poolSize.descriptorCount;
+        MemoryTracker::getInstance().recordDescriptorPool(1, descriptorCapacity);
     }
 
     DescriptorPool::~DescriptorPool() {
         vkDestroyDescriptorPool(grapeDevice.device(), descriptorPool, nullptr);
+        MemoryTracker::getInstance().recordDescriptorPool(-1, -static_cast<int64_t>(descriptorCapacity));
     }
 
     bool DescriptorPool::allocateDescriptor(
@@ -103,6 +103,7 @@ namespace grape {
     private:
         Device& grapeDevice;
         VkDescriptorPool descriptorPool;
+        uint32_t descriptorCapacity = 0;     // Summed over poolSizes, for the MemoryTracker
 
         friend class DescriptorWriter;
     };
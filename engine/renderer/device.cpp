@@ -1,6 +1,9 @@
 #include "device.hpp"
+#include "core/hitch_detector.hpp"
+#include "core/profiler.hpp"
 
 // std headers
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -8,6 +11,9 @@
 
 namespace grape {
 
+    // Upload waits at least this long show up in hitch captures
+    static constexpr uint64_t QUEUE_WAIT_EVENT_NS = 1000000;
+
     // local callback functions
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
         VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
@@ -48,7 +54,8 @@ namespace grape {
     }
 
     // class member functions
-    Device::Device(Window& window) : window{ window } {
+    Device::Device(Window& window) : window{ &window } {
+        GRAPE_MEMORY_SCOPE(MemoryTag::Renderer);
         createInstance();
         setupDebugMessenger();
         createSurface();
@@ -57,6 +64,21 @@ namespace grape {
         createCommandPool();
     }
 
+    Device::Device() {
+        GRAPE_MEMORY_SCOPE(MemoryTag::Renderer);
+        // Nothing gets presented, so the swapchain extension is optional (lavapipe in CI has it,
+        // some compute-only drivers don't)
+        deviceExtensions.erase(std::remove_if(deviceExtensions.begin(), deviceExtensions.end(),
+            [](const char* name) { return std::strcmp(name, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0; }),
+            deviceExtensions.end());
+
+        createInstance();
+        setupDebugMessenger();
+        pickPhysicalDevice();
+        createLogicalDevice();
+        createCommandPool();
+    }
+
     Device::~Device() {
         vkDestroyCommandPool(device_, commandPool, nullptr);
         vkDestroyDevice(device_, nullptr);
@@ -65,7 +87,9 @@ namespace grape {
             DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
         }
 
-        vkDestroySurfaceKHR(instance, surface_, nullptr);
+        if (surface_ != VK_NULL_HANDLE) {
+            vkDestroySurfaceKHR(instance, surface_, nullptr);
+        }
         vkDestroyInstance(instance, nullptr);
     }
 
@@ -207,23 +231,33 @@ namespace grape {
         VkCommandPoolCreateInfo poolInfo = {};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
-        poolInfo.flags =
-            VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        // Only used for one-off uploads, the whole pool is reset before each one
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
         if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
             throw std::runtime_error("failed to create command pool!");
         }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = commandPool;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(device_, &allocInfo, &uploadCommandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate upload command buffer!");
+        }
     }
 
-    void Device::createSurface() { window.createWindowSurface(instance, &surface_); }
+    void Device::createSurface() { window->createWindowSurface(instance, &surface_); }
 
     bool Device::isDeviceSuitable(VkPhysicalDevice device) {
         QueueFamilyIndices indices = findQueueFamilies(device);
 
         bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-        bool swapChainAdequate = false;
-        if (extensionsSupported) {
+        bool swapChainAdequate = isHeadless();
+        if (extensionsSupported && !isHeadless()) {
             SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
         }
@@ -297,11 +331,13 @@ namespace grape {
     }
 
     std::vector<const char*> Device::getRequiredExtensions() {
-        uint32_t glfwExtensionCount = 0;
-        const char** glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-        std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        std::vector<const char*> extensions;
+        if (!isHeadless()) {
+            uint32_t glfwExtensionCount = 0;
+            const char** glfwExtensions;
+            glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+            extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        }
 
         if (enableValidationLayers) {
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -368,8 +404,14 @@ namespace grape {
                 indices.graphicsFamily = i;
                 indices.graphicsFamilyHasValue = true;
             }
+            // Headless never presents, the present queue is just the graphics one
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+            if (isHeadless()) {
+                presentSupport = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+            }
+            else {
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+            }
             if (queueFamily.queueCount > 0 && presentSupport) {
                 indices.presentFamily = i;
                 indices.presentFamilyHasValue = true;
@@ -464,61 +506,68 @@ namespace grape {
         allocInfo.allocationSize = memRequirements.size;
         allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
 
-        if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
+        if (allocateMemory(allocInfo, &bufferMemory, GpuMemoryKind::Buffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to allocate vertex buffer memory!");
         }
 
         vkBindBufferMemory(device_, buffer, bufferMemory, 0);
     }
 
-    VkCommandBuffer Device::beginSingleTimeCommands() {
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool = commandPool;
-        allocInfo.commandBufferCount = 1;
+    void Device::submitOneShot(const std::function<void(VkCommandBuffer)>& record) {
+        // Held for the whole upload and let go however it ends, there is only one upload buffer to go around
+        std::lock_guard<std::mutex> lock(uploadMutex);
 
-        VkCommandBuffer commandBuffer;
-        vkAllocateCommandBuffers(device_, &allocInfo, &commandBuffer);
+        // The last upload waited for the queue, so it's done with the pool. Resetting also takes a
+        // buffer left recording by a record that threw back to the initial state
+        vkResetCommandPool(device_, commandPool, 0);
+        VkCommandBuffer commandBuffer = uploadCommandBuffer;
 
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-        vkBeginCommandBuffer(commandBuffer, &beginInfo);
-        return commandBuffer;
-    }
-
-    void Device::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
-        vkEndCommandBuffer(commandBuffer);
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin upload command buffer!");
+        }
+        record(commandBuffer);
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record upload command buffer!");
+        }
 
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = &commandBuffer;
 
-        vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(graphicsQueue_);
-
-        vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
+        if (vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+        {
+            // Also waits on whatever frames are still in flight, the usual suspect for upload hitches
+            GRAPE_PROFILE_SCOPE("Queue Wait Idle");
+            uint64_t waitStart = Profiler::now();
+            vkQueueWaitIdle(graphicsQueue_);
+            uint64_t waitEnd = Profiler::now();
+            // Short waits are every upload during loading, they'd push everything else out of the log
+            if (waitEnd - waitStart >= QUEUE_WAIT_EVENT_NS) {
+                HitchEvents::record("Queue Wait Idle", "submitOneShot", waitStart, waitEnd);
+            }
+        }
     }
 
     void Device::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
         VkBufferCopy copyRegion{};
         copyRegion.srcOffset = 0;  // Optional
         copyRegion.dstOffset = 0;  // Optional
         copyRegion.size = size;
-        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
-        endSingleTimeCommands(commandBuffer);
+        submitOneShot([&](VkCommandBuffer commandBuffer) {
+            vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+        });
     }
 
     void Device::copyBufferToImage(
         VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount) {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
         VkBufferImageCopy region{};
         region.bufferOffset = 0;
         region.bufferRowLength = 0;
@@ -532,14 +581,15 @@ namespace grape {
         region.imageOffset = { 0, 0, 0 };
         region.imageExtent = { width, height, 1 };
 
-        vkCmdCopyBufferToImage(
-            commandBuffer,
-            buffer,
-            image,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            1,
-            &region);
-        endSingleTimeCommands(commandBuffer);
+        submitOneShot([&](VkCommandBuffer commandBuffer) {
+            vkCmdCopyBufferToImage(
+                commandBuffer,
+                buffer,
+                image,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                1,
+                &region);
+        });
     }
 
     void Device::createImageWithInfo(
@@ -559,7 +609,7 @@ namespace grape {
         allocInfo.allocationSize = memRequirements.size;
         allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
 
-        if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+        if (allocateMemory(allocInfo, &imageMemory, GpuMemoryKind::Image) != VK_SUCCESS) {
             throw std::runtime_error("failed to allocate image memory!");
         }
 
@@ -568,4 +618,30 @@ namespace grape {
         }
     }
 
-}
\ No newline at end of file
+    VkResult Device::allocateMemory(const VkMemoryAllocateInfo& allocInfo, VkDeviceMemory* memory, GpuMemoryKind kind) {
+        VkResult result = vkAllocateMemory(device_, &allocInfo, nullptr, memory);
+        if (result != VK_SUCCESS) return result;
+
+        {
+            std::lock_guard<std::mutex> lock(memoryMutex);
+            memoryAllocations[*memory] = { allocInfo.allocationSize, kind };
+        }
+        MemoryTracker::getInstance().recordGpuAllocation(kind, allocInfo.allocationSize);
+        return result;
+    }
+
+    void Device::freeMemory(VkDeviceMemory memory) {
+        if (memory == VK_NULL_HANDLE) return;
+
+        {
+            std::lock_guard<std::mutex> lock(memoryMutex);
+            auto it = memoryAllocations.find(memory);
+            if (it != memoryAllocations.end()) {
+                MemoryTracker::getInstance().recordGpuFree(it->second.kind, it->second.size);
+                memoryAllocations.erase(it);
+            }
+        }
+        vkFreeMemory(device_, memory, nullptr);
+    }
+
+}
@@ -1,9 +1,13 @@
 #pragma once
 
+#include "core/memory_tracker.hpp"
 #include "core/window.hpp"
 
 // std lib headers
+#include <functional>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace grape {
@@ -31,6 +35,8 @@ namespace grape {
 #endif
 
         Device(Window& window);
+        // No window, surface or swapchain. Only good for rendering offscreen
+        Device();
         ~Device();
 
         // Not copyable or movable
@@ -44,6 +50,7 @@ namespace grape {
         VkSurfaceKHR surface() { return surface_; }
         VkQueue graphicsQueue() { return graphicsQueue_; }
         VkQueue presentQueue() { return presentQueue_; }
+        bool isHeadless() const { return window == nullptr; }
 
         SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
         uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -58,8 +65,9 @@ namespace grape {
             VkMemoryPropertyFlags properties,
             VkBuffer& buffer,
             VkDeviceMemory& bufferMemory);
-        VkCommandBuffer beginSingleTimeCommands();
-        void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+        // One-off upload commands: record fills the shared upload command buffer, which is then
+        // submitted and waited on. Serialized, the buffer is recycled for every call
+        void submitOneShot(const std::function<void(VkCommandBuffer)>& record);
         void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
         void copyBufferToImage(
             VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
@@ -70,6 +78,11 @@ namespace grape {
             VkImage& image,
             VkDeviceMemory& imageMemory);
 
+        // vkAllocateMemory/vkFreeMemory that keep the MemoryTracker's GPU numbers. Everything the
+        // engine allocates goes through these, ImGui's own font and vertex memory doesn't
+        VkResult allocateMemory(const VkMemoryAllocateInfo& allocInfo, VkDeviceMemory* memory, GpuMemoryKind kind);
+        void freeMemory(VkDeviceMemory memory);
+
         VkPhysicalDeviceProperties properties;
 
         VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
@@ -98,16 +111,25 @@ namespace grape {
         VkInstance instance;
         VkDebugUtilsMessengerEXT debugMessenger;
         VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-        Window& window;
+        Window* window = nullptr;
         VkCommandPool commandPool;
+        VkCommandBuffer uploadCommandBuffer = VK_NULL_HANDLE;
+        std::mutex uploadMutex;
+
+        struct MemoryAllocation {
+            VkDeviceSize size;
+            GpuMemoryKind kind;
+        };
+        std::unordered_map<VkDeviceMemory, MemoryAllocation> memoryAllocations;
+        std::mutex memoryMutex;
 
         VkDevice device_;
-        VkSurfaceKHR surface_;
+        VkSurfaceKHR surface_ = VK_NULL_HANDLE;
         VkQueue graphicsQueue_;
         VkQueue presentQueue_;
 
         const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
-        const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+        std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME,
         VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME };
     };
 
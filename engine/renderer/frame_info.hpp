@@ -6,11 +6,14 @@
 #include <functional>
 
 namespace grape {
-#define MAX_LIGHTS 10
+    class GpuProfiler;
 
+    // Lives in the clustered light buffer, see LightClusterSystem
     struct PointLight {
-        glm::vec4 position{};
-        glm::vec4 color{};
+        glm::vec4 position{};   // w is the light's range
+        glm::vec4 color{};      // w is intensity
+        int shadowIndex{ -1 };  // Slot in the point shadow maps, -1 for none
+        int padding[3]{};
     };
 
     struct GlobalUbo {
@@ -18,8 +21,6 @@ namespace grape {
         glm::mat4 view{ 1.f };
         glm::mat4 inverseView{ 1.f };
         glm::vec4 ambientLightColor{ 1.f, 1.f, 1.f, .02f };
-        PointLight pointLights[MAX_LIGHTS];
-        alignas(16) int numLights;
     };
 
     struct FrameInfo {
@@ -30,5 +31,9 @@ namespace grape {
         VkDescriptorSet globalDescriptorSet;
         GameObject::Map& gameObjects;
         std::function<int(const std::string&)> getTextureIndex; // Function to get texture index
+        VkDescriptorSet lightDescriptorSet = VK_NULL_HANDLE;    // Clustered lights, filled in by RenderManager
+        VkDescriptorSet shadowDescriptorSet = VK_NULL_HANDLE;   // Point shadow maps, filled in by RenderManager
+        VkExtent2D viewportExtent{ 0, 0 };                      // Scene viewport size, filled in by RenderManager
+        GpuProfiler* gpuProfiler = nullptr;                     // GPU pass timings, optional
     };
 }
\ No newline at end of file
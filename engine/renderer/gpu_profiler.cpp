@@ -0,0 +1,236 @@
+#include "gpu_profiler.hpp"
+
+#include <array>
+#include <iostream>
+#include <stdexcept>
+
+namespace grape {
+
+    namespace {
+        // Frame begin/end plus a begin/end pair per zone
+        constexpr uint32_t QUERIES_PER_FRAME = 2 + GpuProfiler::MAX_ZONES * 2;
+
+        constexpr VkQueryPipelineStatisticFlags STATISTIC_FLAGS =
+            VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+        // Results come back in bit order
+        constexpr uint32_t STATISTIC_COUNT = 5;
+    }
+
+    GpuProfiler::GpuProfiler(Device& device, uint32_t frameCount) : device{ device } {
+        frames.resize(frameCount);
+
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(device.getPhysicalDevice(), &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(device.getPhysicalDevice(), &queueFamilyCount, queueFamilies.data());
+
+        uint32_t validBits = queueFamilies[device.findPhysicalQueueFamilies().graphicsFamily].timestampValidBits;
+        timestampsSupported = validBits > 0 && device.properties.limits.timestampPeriod > 0.f;
+        timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+        timestampPeriodNs = device.properties.limits.timestampPeriod;
+
+        // The statistics query spans the viewport pass, which may execute secondaries, so those
+        // have to be able to inherit it. The device enables every supported feature
+        VkPhysicalDeviceFeatures features;
+        vkGetPhysicalDeviceFeatures(device.getPhysicalDevice(), &features);
+        statisticsSupported = features.pipelineStatisticsQuery && features.inheritedQueries;
+
+        for (auto& frame : frames) {
+            if (timestampsSupported) {
+                VkQueryPoolCreateInfo poolInfo{};
+                poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+                poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+                poolInfo.queryCount = QUERIES_PER_FRAME;
+                if (vkCreateQueryPool(device.device(), &poolInfo, nullptr, &frame.timestampPool) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create timestamp query pool!");
+                }
+            }
+
+            if (statisticsSupported) {
+                VkQueryPoolCreateInfo poolInfo{};
+                poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+                poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+                poolInfo.queryCount = 1;
+                poolInfo.pipelineStatistics = STATISTIC_FLAGS;
+                if (vkCreateQueryPool(device.device(), &poolInfo, nullptr, &frame.statisticsPool) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create pipeline statistics query pool!");
+                }
+            }
+
+            frame.zones.reserve(MAX_ZONES);
+        }
+
+        timestampResults.resize(QUERIES_PER_FRAME);
+
+        auto& stats = GpuProfileStats::getInstance();
+        stats.timestampsSupported = timestampsSupported;
+        stats.statisticsSupported = statisticsSupported;
+
+        if (!timestampsSupported) {
+            std::cout << "GPU timestamps not supported on the graphics queue, GPU profiling disabled" << std::endl;
+        }
+    }
+
+    GpuProfiler::~GpuProfiler() {
+        for (auto& frame : frames) {
+            if (frame.timestampPool != VK_NULL_HANDLE) {
+                vkDestroyQueryPool(device.device(), frame.timestampPool, nullptr);
+            }
+            if (frame.statisticsPool != VK_NULL_HANDLE) {
+                vkDestroyQueryPool(device.device(), frame.statisticsPool, nullptr);
+            }
+        }
+    }
+
+    void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+        if (frameIndex >= frames.size()) return;
+        FrameQueries& frame = frames[frameIndex];
+
+        if (frame.recorded) {
+            resolve(frame);
+        }
+
+        frame.zones.clear();
+        frame.openZones.clear();
+        frame.queryCount = 0;
+        frame.recorded = false;
+        frame.statisticsActive = false;
+        frame.statisticsRecorded = false;
+
+        if (frame.timestampPool != VK_NULL_HANDLE) {
+            vkCmdResetQueryPool(commandBuffer, frame.timestampPool, 0, QUERIES_PER_FRAME);
+            writeTimestamp(commandBuffer, frame, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        }
+        if (frame.statisticsPool != VK_NULL_HANDLE) {
+            vkCmdResetQueryPool(commandBuffer, frame.statisticsPool, 0, 1);
+        }
+    }
+
+    void GpuProfiler::endFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+        if (frameIndex >= frames.size()) return;
+        FrameQueries& frame = frames[frameIndex];
+
+        // Same for a statistics query left running, and submitting with it active is invalid
+        if (frame.statisticsActive) {
+            endStatistics(commandBuffer, frameIndex);
+        }
+
+        // Unbalanced zones would leave queries unwritten and the readback would never be ready
+        while (!frame.openZones.empty()) {
+            endZone(commandBuffer, frameIndex);
+        }
+
+        if (frame.timestampPool != VK_NULL_HANDLE && frame.queryCount > 0) {
+            writeTimestamp(commandBuffer, frame, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+            frame.recorded = true;
+        }
+    }
+
+    uint32_t GpuProfiler::writeTimestamp(VkCommandBuffer commandBuffer, FrameQueries& frame, VkPipelineStageFlagBits stage) {
+        uint32_t query = frame.queryCount++;
+        vkCmdWriteTimestamp(commandBuffer, stage, frame.timestampPool, query);
+        return query;
+    }
+
+    void GpuProfiler::beginZone(VkCommandBuffer commandBuffer, uint32_t frameIndex, const char* name) {
+        if (frameIndex >= frames.size()) return;
+        FrameQueries& frame = frames[frameIndex];
+        if (frame.timestampPool == VK_NULL_HANDLE || frame.queryCount == 0) return;
+
+        // Out of queries, the zone is still pushed so its endZone pairs up
+        if (frame.zones.size() >= MAX_ZONES) {
+            frame.openZones.push_back(UINT32_MAX);
+            return;
+        }
+
+        Zone zone{};
+        zone.name = name;
+        zone.depth = static_cast<uint32_t>(frame.openZones.size());
+        zone.beginQuery = writeTimestamp(commandBuffer, frame, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        zone.endQuery = UINT32_MAX;
+
+        frame.openZones.push_back(static_cast<uint32_t>(frame.zones.size()));
+        frame.zones.push_back(zone);
+    }
+
+    void GpuProfiler::endZone(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+        if (frameIndex >= frames.size()) return;
+        FrameQueries& frame = frames[frameIndex];
+        if (frame.openZones.empty()) return;
+
+        uint32_t zoneIndex = frame.openZones.back();
+        frame.openZones.pop_back();
+        if (zoneIndex == UINT32_MAX) return;
+
+        frame.zones[zoneIndex].endQuery = writeTimestamp(commandBuffer, frame, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    }
+
+    void GpuProfiler::beginStatistics(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+        if (frameIndex >= frames.size()) return;
+        FrameQueries& frame = frames[frameIndex];
+        if (frame.statisticsPool == VK_NULL_HANDLE || frame.statisticsActive || frame.statisticsRecorded) return;
+
+        vkCmdBeginQuery(commandBuffer, frame.statisticsPool, 0, 0);
+        frame.statisticsActive = true;
+    }
+
+    void GpuProfiler::endStatistics(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+        if (frameIndex >= frames.size()) return;
+        FrameQueries& frame = frames[frameIndex];
+        if (!frame.statisticsActive) return;
+
+        vkCmdEndQuery(commandBuffer, frame.statisticsPool, 0);
+        frame.statisticsActive = false;
+        frame.statisticsRecorded = true;
+    }
+
+    VkQueryPipelineStatisticFlags GpuProfiler::getInheritedStatistics(uint32_t frameIndex) const {
+        if (frameIndex >= frames.size() || !frames[frameIndex].statisticsActive) return 0;
+        return STATISTIC_FLAGS;
+    }
+
+    void GpuProfiler::resolve(FrameQueries& frame) {
+        auto& stats = GpuProfileStats::getInstance();
+
+        // The slot's fence has signaled, so no WAIT, a NOT_READY just means we skip a frame
+        VkResult result = vkGetQueryPoolResults(device.device(), frame.timestampPool, 0, frame.queryCount,
+            frame.queryCount * sizeof(uint64_t), timestampResults.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (result == VK_SUCCESS) {
+            auto toMs = [this](uint64_t begin, uint64_t end) {
+                return static_cast<double>((end - begin) & timestampMask) * timestampPeriodNs / 1e6;
+            };
+
+            uint64_t frameBegin = timestampResults[0];
+            stats.resolvedFrames++;
+            stats.frameMs = toMs(frameBegin, timestampResults[frame.queryCount - 1]);
+            stats.passes.clear();
+            for (const auto& zone : frame.zones) {
+                if (zone.endQuery == UINT32_MAX) continue;
+                stats.passes.push_back({
+                    zone.name,
+                    zone.depth,
+                    toMs(frameBegin, timestampResults[zone.beginQuery]),
+                    toMs(timestampResults[zone.beginQuery], timestampResults[zone.endQuery]) });
+            }
+        }
+
+        stats.statisticsValid = false;
+        if (frame.statisticsRecorded) {
+            std::array<uint64_t, STATISTIC_COUNT> values{};
+            result = vkGetQueryPoolResults(device.device(), frame.statisticsPool, 0, 1,
+                sizeof(values), values.data(), sizeof(values), VK_QUERY_RESULT_64_BIT);
+            if (result == VK_SUCCESS) {
+                stats.viewportStatistics.inputAssemblyPrimitives = values[0];
+                stats.viewportStatistics.vertexShaderInvocations = values[1];
+                stats.viewportStatistics.clippingInvocations = values[2];
+                stats.viewportStatistics.clippingPrimitives = values[3];
+                stats.viewportStatistics.fragmentShaderInvocations = values[4];
+                stats.statisticsValid = true;
+            }
+        }
+    }
+}
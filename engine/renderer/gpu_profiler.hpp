@@ -0,0 +1,143 @@
+#pragma once
+
+#include "device.hpp"
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+namespace grape {
+
+    struct GpuPassTiming {
+        const char* name;
+        uint32_t depth;         // Nesting level, 0 = outermost
+        double startMs;         // From the start of the frame's command buffer
+        double durationMs;
+    };
+
+    // Counts over the viewport pass, to see what culling and LODs actually save
+    struct GpuPipelineStatistics {
+        uint64_t inputAssemblyPrimitives = 0;
+        uint64_t vertexShaderInvocations = 0;
+        uint64_t clippingInvocations = 0;       // Primitives that reached the clipper
+        uint64_t clippingPrimitives = 0;        // Primitives that came out of it
+        uint64_t fragmentShaderInvocations = 0;
+    };
+
+    // Latest frame the GPU profiler has resolved, what the profiler panel shows
+    struct GpuProfileStats {
+        bool timestampsSupported = false;
+        bool statisticsSupported = false;
+        bool statisticsValid = false;
+        double frameMs = 0.0;
+        uint64_t resolvedFrames = 0;    // Bumped every time a frame's timestamps come back
+        std::vector<GpuPassTiming> passes;
+        GpuPipelineStatistics viewportStatistics{};
+
+        static GpuProfileStats& getInstance() {
+            static GpuProfileStats instance;
+            return instance;
+        }
+    };
+
+    // Timestamp and pipeline statistics queries, one pool of each per frame in flight. A frame's
+    // results are read back the next time its slot comes around (its fence has signaled by then),
+    // so nothing waits on the GPU. Zones are primary command buffer only
+    class GpuProfiler {
+    public:
+        static constexpr uint32_t MAX_ZONES = 32;
+
+        GpuProfiler(Device& device, uint32_t frameCount);
+        ~GpuProfiler();
+
+        GpuProfiler(const GpuProfiler&) = delete;
+        GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+        // First thing in frameIndex's command buffer, after its fence. Publishes the results this
+        // slot recorded last time to GpuProfileStats and resets the pools
+        void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+        // Last thing before the command buffer ends
+        void endFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+        // Zones nest. Both calls must be outside a render pass or both inside the same subpass
+        void beginZone(VkCommandBuffer commandBuffer, uint32_t frameIndex, const char* name);
+        void endZone(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+        // Once per frame around the viewport pass. Secondaries executed inside it have to be begun
+        // with getInheritedStatistics() in their inheritance info
+        void beginStatistics(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+        void endStatistics(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+        VkQueryPipelineStatisticFlags getInheritedStatistics(uint32_t frameIndex) const;
+
+    private:
+        struct Zone {
+            const char* name;
+            uint32_t depth;
+            uint32_t beginQuery;
+            uint32_t endQuery;
+        };
+
+        struct FrameQueries {
+            VkQueryPool timestampPool = VK_NULL_HANDLE;
+            VkQueryPool statisticsPool = VK_NULL_HANDLE;
+            std::vector<Zone> zones;
+            std::vector<uint32_t> openZones;
+            uint32_t queryCount = 0;
+            bool recorded = false;
+            bool statisticsActive = false;
+            bool statisticsRecorded = false;
+        };
+
+        void resolve(FrameQueries& frame);
+        uint32_t writeTimestamp(VkCommandBuffer commandBuffer, FrameQueries& frame, VkPipelineStageFlagBits stage);
+
+        Device& device;
+        std::vector<FrameQueries> frames;
+        double timestampPeriodNs = 1.0;
+        uint64_t timestampMask = ~0ull;
+        bool timestampsSupported = false;
+        bool statisticsSupported = false;
+
+        std::vector<uint64_t> timestampResults;
+    };
+
+    // Zone for the lifetime of the scope, does nothing without a profiler
+    class GpuZone {
+    public:
+        GpuZone(GpuProfiler* profiler, VkCommandBuffer commandBuffer, uint32_t frameIndex, const char* name)
+            : profiler{ profiler }, commandBuffer{ commandBuffer }, frameIndex{ frameIndex } {
+            if (profiler) profiler->beginZone(commandBuffer, frameIndex, name);
+        }
+        ~GpuZone() {
+            if (profiler) profiler->endZone(commandBuffer, frameIndex);
+        }
+
+        GpuZone(const GpuZone&) = delete;
+        GpuZone& operator=(const GpuZone&) = delete;
+
+    private:
+        GpuProfiler* profiler;
+        VkCommandBuffer commandBuffer;
+        uint32_t frameIndex;
+    };
+
+    // Pipeline statistics query for the lifetime of the scope, so it's ended even if recording throws
+    class GpuStatisticsScope {
+    public:
+        GpuStatisticsScope(GpuProfiler* profiler, VkCommandBuffer commandBuffer, uint32_t frameIndex)
+            : profiler{ profiler }, commandBuffer{ commandBuffer }, frameIndex{ frameIndex } {
+            if (profiler) profiler->beginStatistics(commandBuffer, frameIndex);
+        }
+        ~GpuStatisticsScope() {
+            if (profiler) profiler->endStatistics(commandBuffer, frameIndex);
+        }
+
+        GpuStatisticsScope(const GpuStatisticsScope&) = delete;
+        GpuStatisticsScope& operator=(const GpuStatisticsScope&) = delete;
+
+    private:
+        GpuProfiler* profiler;
+        VkCommandBuffer commandBuffer;
+        uint32_t frameIndex;
+    };
+}
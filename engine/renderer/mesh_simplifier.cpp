@@ -0,0 +1,296 @@
+#include "mesh_simplifier.hpp"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+
+namespace grape {
+
+    namespace {
+        // Symmetric 4x4 plane quadric, error(p) = p'Ap + 2b'p + c. The planes are weighted, w is
+        // the total weight, so error / w is the mean squared distance to them
+        struct Quadric {
+            float a2 = 0.f, b2 = 0.f, c2 = 0.f;
+            float ab = 0.f, ac = 0.f, bc = 0.f;
+            float ad = 0.f, bd = 0.f, cd = 0.f;
+            float d2 = 0.f;
+            float w = 0.f;
+
+            void addPlane(const glm::vec3& n, float d, float weight) {
+                a2 += n.x * n.x * weight; b2 += n.y * n.y * weight; c2 += n.z * n.z * weight;
+                ab += n.x * n.y * weight; ac += n.x * n.z * weight; bc += n.y * n.z * weight;
+                ad += n.x * d * weight; bd += n.y * d * weight; cd += n.z * d * weight;
+                d2 += d * d * weight;
+                w += weight;
+            }
+
+            void add(const Quadric& q) {
+                a2 += q.a2; b2 += q.b2; c2 += q.c2;
+                ab += q.ab; ac += q.ac; bc += q.bc;
+                ad += q.ad; bd += q.bd; cd += q.cd;
+                d2 += q.d2;
+                w += q.w;
+            }
+
+            // Squared distance, not scaled by how much area went into the quadric
+            float evaluate(const glm::vec3& p) const {
+                if (w <= 0.f) return 0.f;
+                float result =
+                    a2 * p.x * p.x + b2 * p.y * p.y + c2 * p.z * p.z +
+                    2.f * (ab * p.x * p.y + ac * p.x * p.z + bc * p.y * p.z) +
+                    2.f * (ad * p.x + bd * p.y + cd * p.z) +
+                    d2;
+                return std::max(result / w, 0.f);
+            }
+        };
+
+        enum VertexKind : uint8_t {
+            KIND_MANIFOLD,  // Free to collapse onto any neighbour
+            KIND_BORDER,    // On an open edge, only collapses along it
+            KIND_LOCKED     // Seam or non-manifold, never moves
+        };
+
+        // Open borders are held in place by a plane through the edge, perpendicular to the face
+        constexpr float BORDER_WEIGHT = 10.f;
+
+        uint64_t edgeKey(uint32_t a, uint32_t b) {
+            if (a > b) std::swap(a, b);
+            return (static_cast<uint64_t>(a) << 32) | b;
+        }
+
+        struct Collapse {
+            uint32_t from;
+            uint32_t to;
+            float cost;
+        };
+    }
+
+    std::vector<uint32_t> simplifyMesh(
+        const std::vector<glm::vec3>& inputPositions,
+        const std::vector<uint32_t>& inputIndices,
+        size_t targetIndexCount,
+        float targetError,
+        float* resultError) {
+
+        std::vector<uint32_t> indices = inputIndices;
+        if (resultError) *resultError = 0.f;
+        if (indices.size() <= targetIndexCount || inputPositions.empty()) {
+            return indices;
+        }
+
+        const size_t vertexCount = inputPositions.size();
+
+        // Work in a unit box so the quadrics keep their float precision on big meshes
+        glm::vec3 boundsMin{ FLT_MAX };
+        glm::vec3 boundsMax{ -FLT_MAX };
+        for (uint32_t index : indices) {
+            boundsMin = glm::min(boundsMin, inputPositions[index]);
+            boundsMax = glm::max(boundsMax, inputPositions[index]);
+        }
+        glm::vec3 size = boundsMax - boundsMin;
+        float extent = std::max(std::max(size.x, size.y), std::max(size.z, 1e-6f));
+
+        std::vector<glm::vec3> positions(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++) {
+            positions[i] = (inputPositions[i] - boundsMin) / extent;
+        }
+
+        // Vertices split by the loader for differing UVs/normals share a position, weld them so
+        // seams don't look like open borders
+        std::vector<uint32_t> canonical(vertexCount);
+        std::vector<uint32_t> seamCopies(vertexCount, 0);
+        {
+            std::unordered_map<glm::vec3, uint32_t> positionToVertex;
+            std::vector<bool> used(vertexCount, false);
+            for (uint32_t index : indices) used[index] = true;
+
+            for (uint32_t i = 0; i < vertexCount; i++) {
+                auto [it, inserted] = positionToVertex.emplace(inputPositions[i], i);
+                canonical[i] = it->second;
+                if (used[i]) seamCopies[it->second]++;
+            }
+        }
+
+        // Plane of every triangle, weighted by area, plus the border planes
+        std::vector<Quadric> quadrics(vertexCount);
+        {
+            std::unordered_map<uint64_t, uint32_t> edgeUses;
+            for (size_t t = 0; t < indices.size(); t += 3) {
+                for (int e = 0; e < 3; e++) {
+                    edgeUses[edgeKey(canonical[indices[t + e]], canonical[indices[t + (e + 1) % 3]])]++;
+                }
+            }
+
+            for (size_t t = 0; t < indices.size(); t += 3) {
+                const glm::vec3& p0 = positions[indices[t + 0]];
+                const glm::vec3& p1 = positions[indices[t + 1]];
+                const glm::vec3& p2 = positions[indices[t + 2]];
+
+                glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                float area = glm::length(normal);
+                if (area <= 0.f) continue;
+                normal /= area;
+
+                Quadric face;
+                face.addPlane(normal, -glm::dot(normal, p0), area * 0.5f);
+                for (int corner = 0; corner < 3; corner++) {
+                    quadrics[indices[t + corner]].add(face);
+                }
+
+                for (int e = 0; e < 3; e++) {
+                    uint32_t a = indices[t + e];
+                    uint32_t b = indices[t + (e + 1) % 3];
+                    if (edgeUses[edgeKey(canonical[a], canonical[b])] != 1) continue;
+
+                    glm::vec3 edge = positions[b] - positions[a];
+                    float length = glm::length(edge);
+                    if (length <= 0.f) continue;
+
+                    glm::vec3 borderNormal = glm::normalize(glm::cross(edge, normal));
+                    Quadric border;
+                    border.addPlane(borderNormal, -glm::dot(borderNormal, positions[a]), length * length * BORDER_WEIGHT);
+                    quadrics[a].add(border);
+                    quadrics[b].add(border);
+                }
+            }
+        }
+
+        const float errorLimit = (targetError / extent) * (targetError / extent);
+        float maxError = 0.f;
+
+        std::vector<uint8_t> kinds(vertexCount);
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+        std::vector<uint32_t> adjacency;
+        std::vector<Collapse> collapses;
+        std::vector<uint32_t> remap(vertexCount);
+        std::vector<bool> touched(vertexCount);
+        std::unordered_map<uint64_t, uint32_t> edgeUses;
+
+        // Each pass picks the cheapest collapse per vertex, applies the ones that don't
+        // conflict in cost order, then rebuilds the topology for the next pass
+        while (indices.size() > targetIndexCount) {
+            edgeUses.clear();
+            for (size_t t = 0; t < indices.size(); t += 3) {
+                for (int e = 0; e < 3; e++) {
+                    edgeUses[edgeKey(canonical[indices[t + e]], canonical[indices[t + (e + 1) % 3]])]++;
+                }
+            }
+
+            for (size_t i = 0; i < vertexCount; i++) {
+                kinds[i] = seamCopies[canonical[i]] > 1 ? KIND_LOCKED : KIND_MANIFOLD;
+            }
+            for (size_t t = 0; t < indices.size(); t += 3) {
+                for (int e = 0; e < 3; e++) {
+                    uint32_t a = indices[t + e];
+                    uint32_t b = indices[t + (e + 1) % 3];
+                    uint32_t uses = edgeUses[edgeKey(canonical[a], canonical[b])];
+                    uint8_t kind = uses == 1 ? KIND_BORDER : uses > 2 ? KIND_LOCKED : KIND_MANIFOLD;
+                    kinds[a] = std::max(kinds[a], kind);
+                    kinds[b] = std::max(kinds[b], kind);
+                }
+            }
+
+            // Triangles around each vertex
+            std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+            for (uint32_t index : indices) adjacencyOffsets[index + 1]++;
+            for (size_t i = 0; i < vertexCount; i++) adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+            adjacency.resize(indices.size());
+            {
+                std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+                for (size_t i = 0; i < indices.size(); i++) {
+                    adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+                }
+            }
+
+            // Cheapest legal collapse out of every vertex
+            collapses.clear();
+            {
+                std::vector<Collapse> best(vertexCount, { 0, 0, FLT_MAX });
+                for (size_t t = 0; t < indices.size(); t += 3) {
+                    for (int e = 0; e < 3; e++) {
+                        for (int direction = 0; direction < 2; direction++) {
+                            uint32_t from = indices[t + (direction ? (e + 1) % 3 : e)];
+                            uint32_t to = indices[t + (direction ? e : (e + 1) % 3)];
+
+                            if (kinds[from] == KIND_LOCKED) continue;
+                            if (kinds[from] == KIND_BORDER && edgeUses[edgeKey(canonical[from], canonical[to])] != 1) continue;
+
+                            // Both sides' surfaces end up at positions[to], the error is the worse of the two
+                            float cost = std::max(quadrics[from].evaluate(positions[to]), quadrics[to].evaluate(positions[to]));
+                            if (cost < best[from].cost) {
+                                best[from] = { from, to, cost };
+                            }
+                        }
+                    }
+                }
+                for (const auto& collapse : best) {
+                    if (collapse.cost < FLT_MAX) collapses.push_back(collapse);
+                }
+            }
+
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+            for (size_t i = 0; i < vertexCount; i++) remap[i] = static_cast<uint32_t>(i);
+            std::fill(touched.begin(), touched.end(), false);
+
+            size_t trianglesToRemove = (indices.size() - targetIndexCount + 2) / 3;
+            size_t trianglesRemoved = 0;
+            size_t applied = 0;
+
+            for (const auto& collapse : collapses) {
+                if (collapse.cost > errorLimit) break;
+                if (touched[collapse.from] || touched[collapse.to]) continue;
+
+                // Reject collapses that would flip a surrounding triangle. Neighbours collapsed earlier
+                // in this pass are resolved through remap (they can't have moved twice)
+                bool flips = false;
+                for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !flips; a++) {
+                    size_t t = static_cast<size_t>(adjacency[a]) * 3;
+                    uint32_t v[3] = { remap[indices[t]], remap[indices[t + 1]], remap[indices[t + 2]] };
+                    if (v[0] == collapse.to || v[1] == collapse.to || v[2] == collapse.to) continue;
+
+                    glm::vec3 before = glm::cross(positions[v[1]] - positions[v[0]], positions[v[2]] - positions[v[0]]);
+                    for (auto& vertex : v) {
+                        if (vertex == collapse.from) vertex = collapse.to;
+                    }
+                    glm::vec3 after = glm::cross(positions[v[1]] - positions[v[0]], positions[v[2]] - positions[v[0]]);
+                    flips = glm::dot(before, after) <= 0.f;
+                }
+                if (flips) continue;
+
+                remap[collapse.from] = collapse.to;
+                quadrics[collapse.to].add(quadrics[collapse.from]);
+                touched[collapse.from] = true;
+                touched[collapse.to] = true;
+                maxError = std::max(maxError, collapse.cost);
+                applied++;
+
+                trianglesRemoved += kinds[collapse.from] == KIND_BORDER ? 1 : 2;
+                if (trianglesRemoved >= trianglesToRemove) break;
+            }
+
+            if (applied == 0) break;
+
+            // Rewrite and drop whatever degenerated (including triangles squashed onto a seam)
+            size_t write = 0;
+            for (size_t t = 0; t < indices.size(); t += 3) {
+                uint32_t a = remap[indices[t]];
+                uint32_t b = remap[indices[t + 1]];
+                uint32_t c = remap[indices[t + 2]];
+                if (canonical[a] == canonical[b] || canonical[b] == canonical[c] || canonical[a] == canonical[c]) continue;
+
+                indices[write++] = a;
+                indices[write++] = b;
+                indices[write++] = c;
+            }
+            indices.resize(write);
+        }
+
+        if (resultError) *resultError = std::sqrt(maxError) * extent;
+        return indices;
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace grape {
+
+    // Quadric error metric edge-collapse simplification (Garland & Heckbert). Vertices are never
+    // moved or added, a collapse snaps one vertex onto a neighbour, so the result indexes the same
+    // vertex buffer as the input and LODs can live side by side in one index buffer.
+    //
+    // UV/normal seams (vertices sharing a position) are kept in place and open borders only
+    // collapse along themselves, so silhouettes and texture charts hold up.
+    //
+    // Stops at targetIndexCount or once the next collapse would cost more than targetError
+    // (in position units). resultError gets the largest error actually introduced
+    std::vector<uint32_t> simplifyMesh(
+        const std::vector<glm::vec3>& positions,
+        const std::vector<uint32_t>& indices,
+        size_t targetIndexCount,
+        float targetError,
+        float* resultError = nullptr);
+}
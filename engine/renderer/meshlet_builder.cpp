@@ -0,0 +1,179 @@
+#include "meshlet_builder.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace grape {
+
+    namespace {
+        // Outward normal of a triangle as the loader stores it. OBJ winds counter-clockwise, the
+        // loader mirrors Y which turns that around, so the cross product is taken the other way
+        glm::vec3 triangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2) {
+            return glm::cross(p2 - p0, p1 - p0);
+        }
+
+        void finishMeshlet(Meshlet& meshlet, const std::vector<glm::vec3>& positions, const uint32_t* indices) {
+            meshlet.boundsMin = glm::vec3(FLT_MAX);
+            meshlet.boundsMax = glm::vec3(-FLT_MAX);
+            for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+                meshlet.boundsMin = glm::min(meshlet.boundsMin, positions[indices[i]]);
+                meshlet.boundsMax = glm::max(meshlet.boundsMax, positions[indices[i]]);
+            }
+
+            meshlet.center = (meshlet.boundsMin + meshlet.boundsMax) * 0.5f;
+            meshlet.radius = 0.f;
+            for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+                meshlet.radius = std::max(meshlet.radius, glm::length(positions[indices[i]] - meshlet.center));
+            }
+
+            glm::vec3 normalSum{ 0.f };
+            for (uint32_t i = 0; i < meshlet.indexCount; i += 3) {
+                glm::vec3 normal = triangleNormal(positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]]);
+                float length = glm::length(normal);
+                if (length > 0.f) normalSum += normal / length;
+            }
+
+            // No cull unless every normal is within ~84 degrees of the axis
+            meshlet.coneAxis = glm::vec3(0.f, 0.f, 1.f);
+            meshlet.coneCutoff = 1.f;
+            float sumLength = glm::length(normalSum);
+            if (sumLength <= 0.f) return;
+            meshlet.coneAxis = normalSum / sumLength;
+
+            float minDot = 1.f;
+            for (uint32_t i = 0; i < meshlet.indexCount; i += 3) {
+                glm::vec3 normal = triangleNormal(positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]]);
+                float length = glm::length(normal);
+                if (length > 0.f) minDot = std::min(minDot, glm::dot(normal / length, meshlet.coneAxis));
+            }
+
+            if (minDot > 0.1f) {
+                meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+            }
+        }
+    }
+
+    std::vector<Meshlet> buildMeshlets(
+        const std::vector<glm::vec3>& positions,
+        std::vector<uint32_t>& indices,
+        size_t indexCount,
+        size_t maxVertices,
+        size_t maxTriangles) {
+
+        std::vector<Meshlet> meshlets;
+        const size_t triangleCount = indexCount / 3;
+        if (triangleCount == 0) return meshlets;
+
+        // Triangles around each vertex
+        std::vector<uint32_t> adjacencyOffsets(positions.size() + 1, 0);
+        for (size_t i = 0; i < indexCount; i++) adjacencyOffsets[indices[i] + 1]++;
+        for (size_t i = 0; i < positions.size(); i++) adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+        std::vector<uint32_t> adjacency(indexCount);
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < indexCount; i++) {
+                adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        std::vector<uint32_t> reordered;
+        reordered.reserve(indexCount);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> vertexMeshlet(positions.size(), UINT32_MAX);   // Last meshlet that used the vertex
+        std::vector<uint32_t> candidates;
+
+        size_t seed = 0;
+        while (true) {
+            while (seed < triangleCount && emitted[seed]) seed++;
+            if (seed == triangleCount) break;
+
+            const uint32_t meshletId = static_cast<uint32_t>(meshlets.size());
+            Meshlet meshlet{};
+            meshlet.firstIndex = static_cast<uint32_t>(reordered.size());
+            size_t vertexCount = 0;
+            size_t meshletTriangles = 0;
+            glm::vec3 positionSum{ 0.f };
+            candidates.clear();
+
+            auto newVertices = [&](uint32_t triangle) {
+                int count = 0;
+                for (int corner = 0; corner < 3; corner++) {
+                    if (vertexMeshlet[indices[triangle * 3 + corner]] != meshletId) count++;
+                }
+                return count;
+            };
+
+            auto addTriangle = [&](uint32_t triangle) {
+                emitted[triangle] = true;
+                meshletTriangles++;
+                for (int corner = 0; corner < 3; corner++) {
+                    uint32_t vertex = indices[triangle * 3 + corner];
+                    reordered.push_back(vertex);
+                    if (vertexMeshlet[vertex] == meshletId) continue;
+
+                    vertexMeshlet[vertex] = meshletId;
+                    vertexCount++;
+                    positionSum += positions[vertex];
+                    for (uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; a++) {
+                        if (!emitted[adjacency[a]]) candidates.push_back(adjacency[a]);
+                    }
+                }
+            };
+
+            addTriangle(static_cast<uint32_t>(seed));
+
+            // Grow over neighbours, preferring triangles that add no new vertices and, among those,
+            // the ones closest to the cluster so it stays round instead of snaking along a strip
+            while (meshletTriangles < maxTriangles) {
+                glm::vec3 centroid = positionSum / static_cast<float>(vertexCount);
+                size_t best = SIZE_MAX;
+                int bestScore = 4;
+                float bestDistance = FLT_MAX;
+                for (size_t k = 0; k < candidates.size();) {
+                    if (emitted[candidates[k]]) {
+                        candidates[k] = candidates.back();
+                        candidates.pop_back();
+                        continue;
+                    }
+                    int score = newVertices(candidates[k]);
+                    if (score == 0) {
+                        best = k;
+                        bestScore = 0;
+                        break;
+                    }
+                    if (score <= bestScore) {
+                        const uint32_t* triangle = &indices[candidates[k] * 3];
+                        glm::vec3 center = (positions[triangle[0]] + positions[triangle[1]] + positions[triangle[2]]) / 3.f;
+                        float distance = glm::dot(center - centroid, center - centroid);
+                        if (score < bestScore || distance < bestDistance) {
+                            best = k;
+                            bestScore = score;
+                            bestDistance = distance;
+                        }
+                    }
+                    k++;
+                }
+
+                if (best == SIZE_MAX || vertexCount + bestScore > maxVertices) break;
+
+                uint32_t triangle = candidates[best];
+                candidates[best] = candidates.back();
+                candidates.pop_back();
+                addTriangle(triangle);
+            }
+
+            meshlet.indexCount = static_cast<uint32_t>(reordered.size()) - meshlet.firstIndex;
+            finishMeshlet(meshlet, positions, reordered.data() + meshlet.firstIndex);
+            meshlets.push_back(meshlet);
+        }
+
+        std::copy(reordered.begin(), reordered.end(), indices.begin());
+        return meshlets;
+    }
+
+    bool isMeshletBackfacing(const Meshlet& meshlet, const glm::vec3& cameraPosition) {
+        glm::vec3 toCenter = meshlet.center - cameraPosition;
+        return glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+    }
+}
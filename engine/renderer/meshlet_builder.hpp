@@ -0,0 +1,43 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace grape {
+
+    // A small, spatially coherent cluster of a submesh's triangles, stored as a contiguous
+    // range of its index buffer so it can be culled and drawn on its own
+    struct Meshlet {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        glm::vec3 center;       // Bounding sphere, for the cone test
+        float radius;
+
+        // Every triangle normal is within the cone around axis. cutoff is the sine of its half
+        // angle, >= 1 when the cluster faces too many ways to ever be backfacing as a whole
+        glm::vec3 coneAxis;
+        float coneCutoff;
+    };
+
+    constexpr size_t MESHLET_MAX_VERTICES = 64;
+    constexpr size_t MESHLET_MAX_TRIANGLES = 124;
+
+    // Greedily grows clusters over shared vertices and reorders indices[0, indexCount) so every
+    // meshlet's triangles are contiguous. Indices past indexCount are left alone
+    std::vector<Meshlet> buildMeshlets(
+        const std::vector<glm::vec3>& positions,
+        std::vector<uint32_t>& indices,
+        size_t indexCount,
+        size_t maxVertices = MESHLET_MAX_VERTICES,
+        size_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+    // True when the whole cluster faces away from a camera at cameraPosition (meshlet space)
+    bool isMeshletBackfacing(const Meshlet& meshlet, const glm::vec3& cameraPosition);
+}
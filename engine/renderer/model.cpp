@@ -1,12 +1,19 @@
 #include "model.hpp"
 #include "core/utils.hpp"
+#include "core/perf_counters.hpp"
+#include "core/hitch_detector.hpp"
+#include "core/profiler.hpp"
+#include "mesh_simplifier.hpp"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/hash.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 #include <cassert>
+#include <cmath>
 #include <cstring>
 #include <unordered_map>
 
@@ -15,17 +22,6 @@
 #endif
 #include <iostream>
 
-namespace std {
-	template <>
-	struct hash<grape::Model::Vertex> {
-		size_t operator()(grape::Model::Vertex const& vertex) const {
-			size_t seed = 0;
-			grape::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-			return seed;
-		}
-	};
-}
-
 namespace grape {
 	// --- Model Class Implementation ---
 	Model::Model(Device& device, Builder& builder) : grapeDevice{ device } {
@@ -45,53 +41,105 @@ namespace grape {
 	}
 
 	std::unique_ptr<Model> Model::createModelFromFile(Device& device, const std::string& filepath) {
+		GRAPE_PROFILE_SCOPE("Model Load");
+		uint64_t start = Profiler::now();
 		Builder builder;
 		builder.loadModel(device, ENGINE_DIR + filepath);
-		return std::make_unique<Model>(device, builder);
+		auto model = std::make_unique<Model>(device, builder);
+		HitchEvents::record("Model Load", filepath, start, Profiler::now());
+		return model;
 	}
 
-	std::vector<VkVertexInputBindingDescription> Model::Vertex::getBindingDescriptions()
+	std::vector<VkVertexInputBindingDescription> Model::PackedVertex::getBindingDescriptions()
 	{
-		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions(2);
 		bindingDescriptions[0].binding = 0;
-		bindingDescriptions[0].stride = sizeof(Vertex);
+		bindingDescriptions[0].stride = sizeof(PackedVertex);
 		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		bindingDescriptions[1].binding = 1;
+		bindingDescriptions[1].stride = sizeof(uint32_t);
+		bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 		return bindingDescriptions;
 	}
 
-	std::vector<VkVertexInputAttributeDescription> Model::Vertex::getAttributeDescriptions()
+	std::vector<VkVertexInputAttributeDescription> Model::PackedVertex::getAttributeDescriptions()
 	{
 		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
 
-		attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position) });
-		attributeDescriptions.push_back({ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color) });
-		attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal) });
-		attributeDescriptions.push_back({ 3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv) });
+		attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, position) });
+		attributeDescriptions.push_back({ 1, 1, VK_FORMAT_R8G8B8A8_UNORM, 0 });
+		attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal) });
+		attributeDescriptions.push_back({ 3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, uv) });
 
 		return attributeDescriptions;
 	}
 
-	void Model::drawSubmesh(VkCommandBuffer commandBuffer, uint32_t submeshIndex) {
+	std::vector<VkVertexInputBindingDescription> Model::PackedVertex::getPositionBindingDescriptions()
+	{
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+		bindingDescriptions[0].binding = 0;
+		bindingDescriptions[0].stride = sizeof(PackedVertex);
+		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return bindingDescriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> Model::PackedVertex::getPositionAttributeDescriptions()
+	{
+		return { { 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, position) } };
+	}
+
+	void Model::drawSubmesh(VkCommandBuffer commandBuffer, uint32_t submeshIndex, uint32_t firstInstance, uint32_t lod) {
 		assert(submeshIndex < submeshes.size() && "Submesh index out of bounds");
 		const auto& submesh = submeshes[submeshIndex];
-		if (submesh.indexCount > 0) {
-			vkCmdDrawIndexed(commandBuffer, submesh.indexCount, 1, 0, 0, 0);
+		if (submesh.lods.empty()) {
+			drawIndexRange(commandBuffer, 0, submesh.indexCount, firstInstance);
+			return;
+		}
+
+		const auto& range = submesh.lods[std::min<size_t>(lod, submesh.lods.size() - 1)];
+		drawIndexRange(commandBuffer, range.firstIndex, range.indexCount, firstInstance);
+	}
+
+	void Model::drawIndexRange(VkCommandBuffer commandBuffer, uint32_t firstIndex, uint32_t indexCount, uint32_t firstInstance) {
+		if (indexCount > 0) {
+			vkCmdDrawIndexed(commandBuffer, indexCount, 1, firstIndex, 0, firstInstance);
+			PerfCounters::add(PerfCounter::DrawCalls);
+			PerfCounters::add(PerfCounter::Triangles, indexCount / 3);
 		}
 	}
 
 	void Model::bindSubmesh(VkCommandBuffer commandBuffer, uint32_t submeshIndex) {
+		assert(submeshIndex < submeshes.size() && "Submesh index out of bounds");
+		const auto& submesh = submeshes[submeshIndex];
+		// Without a color stream binding 1 aliases the packed vertices, it's at least 4 bytes per vertex
+		// so the fetch stays in bounds and the shader ignores it (no OBJECT_FLAG_VERTEX_COLOR)
+		const Buffer& colors = submesh.colorBuffer ? *submesh.colorBuffer : *submesh.vertexBuffer;
+		VkBuffer buffers[] = { submesh.vertexBuffer->getBuffer(), colors.getBuffer() };
+		VkDeviceSize offsets[] = { 0, 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 2, buffers, offsets);
+		PerfCounters::add(PerfCounter::VertexBufferBinds);
+		if (submesh.indexBuffer) {
+			vkCmdBindIndexBuffer(commandBuffer, submesh.indexBuffer->getBuffer(), 0, submesh.indexType);
+			PerfCounters::add(PerfCounter::IndexBufferBinds);
+		}
+	}
+
+	void Model::bindSubmeshPositions(VkCommandBuffer commandBuffer, uint32_t submeshIndex) {
 		assert(submeshIndex < submeshes.size() && "Submesh index out of bounds");
 		const auto& submesh = submeshes[submeshIndex];
 		VkBuffer buffers[] = { submesh.vertexBuffer->getBuffer() };
 		VkDeviceSize offsets[] = { 0 };
 		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+		PerfCounters::add(PerfCounter::VertexBufferBinds);
 		if (submesh.indexBuffer) {
-			vkCmdBindIndexBuffer(commandBuffer, submesh.indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(commandBuffer, submesh.indexBuffer->getBuffer(), 0, submesh.indexType);
+			PerfCounters::add(PerfCounter::IndexBufferBinds);
 		}
 	}
 
 	// --- Builder Class Implementation ---
     void Model::Builder::loadModel(Device& device, const std::string& filepath) {
+        GRAPE_MEMORY_SCOPE(MemoryTag::Assets);
         tinyobj::attrib_t attrib;
         std::vector<tinyobj::shape_t> shapes;
         std::vector<tinyobj::material_t> materials;
@@ -190,27 +238,11 @@ namespace grape {
 
             // Step 3: Create sub-meshes and their Vulkan buffers
             for (auto const& [material_id, unique_vertices_map] : materialUniqueVertices) {
-                Submesh submesh{};
-                submesh.materialId = material_id;
-                submesh.indexCount = materialIndices.at(material_id).size();
-
                 std::vector<Vertex> submeshVertices(unique_vertices_map.size());
                 for (auto const& [vertex, index] : unique_vertices_map) {
                     submeshVertices[index] = vertex;
                 }
-
-                createVertexBuffers(device, submesh.vertexBuffer, submeshVertices);
-                createIndexBuffers(device, submesh.indexBuffer, materialIndices.at(material_id));
-
-                // Debug output
-                std::string textureName = materialIdToTexturePath.count(material_id) ?
-                    materialIdToTexturePath[material_id] : "None";
-                std::cout << "Created submesh for material " << material_id
-                    << " with texture: " << textureName
-                    << " (vertices: " << submeshVertices.size()
-                    << ", indices: " << submesh.indexCount << ")" << std::endl;
-
-                submeshes.push_back(std::move(submesh));
+                addSubmesh(device, submeshVertices, materialIndices.at(material_id), material_id);
             }
         }
 
@@ -229,58 +261,188 @@ namespace grape {
         }
     }
 
+    void Model::Builder::addSubmesh(Device& device, const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, int materialId) {
+        GRAPE_MEMORY_SCOPE(MemoryTag::Assets);
+        Submesh submesh{};
+        submesh.materialId = materialId;
+        submesh.indexCount = static_cast<uint32_t>(indices.size());
+
+        // The first submesh starts the bounds over, loadModel has already grown them by the same vertices
+        if (submeshes.empty()) {
+            boundingBoxMin = glm::vec3(FLT_MAX);
+            boundingBoxMax = glm::vec3(-FLT_MAX);
+        }
+        for (const auto& vertex : vertices) {
+            boundingBoxMin = glm::min(boundingBoxMin, vertex.position);
+            boundingBoxMax = glm::max(boundingBoxMax, vertex.position);
+        }
+
+        if (submesh.indexCount / 3 >= MESHLET_MIN_TRIANGLES) {
+            std::vector<glm::vec3> positions(vertices.size());
+            for (size_t i = 0; i < vertices.size(); i++) {
+                positions[i] = vertices[i].position;
+            }
+            // Reorders LOD 0 so each meshlet is a contiguous index range
+            submesh.meshlets = buildMeshlets(positions, indices, indices.size());
+        }
+        generateLods(vertices, indices, submesh);
+
+        createVertexBuffers(device, submesh, vertices);
+        createIndexBuffers(device, submesh, indices, vertices.size());
+
+        // Debug output
+        std::string textureName = materialIdToTexturePath.count(materialId) ?
+            materialIdToTexturePath[materialId] : "None";
+        std::cout << "Created submesh for material " << materialId
+            << " with texture: " << textureName
+            << " (vertices: " << vertices.size()
+            << ", indices: " << submesh.indexCount << ", LODs: " << submesh.lods.size()
+            << ", meshlets: " << submesh.meshlets.size()
+            << (submesh.indexType == VK_INDEX_TYPE_UINT16 ? ", 16-bit indices" : "")
+            << (submesh.colorBuffer ? ", vertex colors" : "") << ")" << std::endl;
+
+        submeshes.push_back(std::move(submesh));
+    }
+
 	// --- Builder Helper Functions ---
-	void Model::Builder::createVertexBuffers(Device& device, std::unique_ptr<Buffer>& buffer, const std::vector<Vertex>& vertices) {
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-		uint32_t vertexSize = sizeof(vertices[0]);
+	void Model::Builder::generateLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, Submesh& submesh) {
+		// Below this it isn't worth another level, and each level has to actually shrink
+		constexpr size_t MIN_LOD_TRIANGLES = 64;
+		constexpr float MIN_LOD_REDUCTION = 0.85f;
+		// Error limit per level relative to the submesh size, past that the shape falls apart
+		constexpr float MAX_LOD_ERROR = 0.05f;
+
+		submesh.lods.clear();
+		submesh.lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.f });
+
+		std::vector<glm::vec3> positions(vertices.size());
+		glm::vec3 boundsMin{ FLT_MAX };
+		glm::vec3 boundsMax{ -FLT_MAX };
+		for (size_t i = 0; i < vertices.size(); i++) {
+			positions[i] = vertices[i].position;
+			boundsMin = glm::min(boundsMin, positions[i]);
+			boundsMax = glm::max(boundsMax, positions[i]);
+		}
+		if (positions.empty()) return;
+		float size = glm::length(boundsMax - boundsMin);
 
-		Buffer stagingBuffer{
-			device,
-			vertexSize,
-			static_cast<uint32_t>(vertices.size()),
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		};
+		// Each level is simplified from the previous one, so errors add up along the chain
+		std::vector<uint32_t> previous(indices.begin(), indices.end());
+		float previousError = 0.f;
 
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)vertices.data());
+		while (submesh.lods.size() < MAX_LODS && previous.size() / 3 >= MIN_LOD_TRIANGLES * 2) {
+			size_t target = previous.size() / 6 * 3;
+			float error = 0.f;
+			std::vector<uint32_t> simplified = simplifyMesh(positions, previous, target, size * MAX_LOD_ERROR, &error);
 
-		buffer = std::make_unique<Buffer>(
-			device,
-			vertexSize,
-			static_cast<uint32_t>(vertices.size()),
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-		);
-		device.copyBuffer(stagingBuffer.getBuffer(), buffer->getBuffer(), bufferSize);
+			if (simplified.empty() || simplified.size() > previous.size() * MIN_LOD_REDUCTION) break;
+
+			previousError += error;
+			submesh.lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(simplified.size()), previousError });
+			indices.insert(indices.end(), simplified.begin(), simplified.end());
+			previous = std::move(simplified);
+		}
 	}
 
-	void Model::Builder::createIndexBuffers(Device& device, std::unique_ptr<Buffer>& buffer, const std::vector<uint32_t>& indices) {
-		if (indices.empty()) {
+	void Model::Builder::createVertexBuffers(Device& device, Submesh& submesh, const std::vector<Vertex>& vertices) {
+		if (vertices.empty()) {
 			return;
 		}
 
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-		uint32_t indexSize = sizeof(indices[0]);
+		glm::vec3 boundsMin{ FLT_MAX };
+		glm::vec3 boundsMax{ -FLT_MAX };
+		for (const auto& vertex : vertices) {
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+		// Flat submeshes still need a non-zero scale on the flat axis
+		glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+		submesh.dequantize = glm::scale(glm::translate(glm::mat4(1.f), boundsMin), extent);
+
+		std::vector<PackedVertex> packed(vertices.size());
+		std::vector<uint32_t> colors(vertices.size());
+		bool uniformColor = true;
+
+		for (size_t i = 0; i < vertices.size(); i++) {
+			const auto& vertex = vertices[i];
+			auto& out = packed[i];
+
+			glm::vec3 position = glm::clamp((vertex.position - boundsMin) / extent, 0.f, 1.f);
+			for (int axis = 0; axis < 3; axis++) {
+				out.position[axis] = static_cast<uint16_t>(std::round(position[axis] * 65535.f));
+			}
+			out.position[3] = 0;
+
+			// Octahedral: project onto the L1 sphere, fold the lower half over the diagonals
+			glm::vec3 normal = vertex.normal;
+			float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+			glm::vec2 octahedral{ 0.f };
+			if (l1 > 0.f) {
+				normal /= l1;
+				octahedral = glm::vec2(normal.x, normal.y);
+				if (normal.z < 0.f) {
+					octahedral = (1.f - glm::abs(glm::vec2(normal.y, normal.x))) *
+						glm::vec2(normal.x >= 0.f ? 1.f : -1.f, normal.y >= 0.f ? 1.f : -1.f);
+				}
+			}
+			out.normal = glm::packSnorm2x16(octahedral);
+			out.uv = glm::packHalf2x16(vertex.uv);
+
+			colors[i] = glm::packUnorm4x8(glm::vec4(vertex.color, 1.f));
+			uniformColor = uniformColor && colors[i] == colors[0];
+		}
+
+		createDeviceBuffer(device, submesh.vertexBuffer, packed.data(), sizeof(PackedVertex),
+			static_cast<uint32_t>(packed.size()), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+
+		// The loader fills white when the file has no colors, that's the common case and costs nothing
+		submesh.constantColor = colors[0];
+		if (!uniformColor) {
+			createDeviceBuffer(device, submesh.colorBuffer, colors.data(), sizeof(uint32_t),
+				static_cast<uint32_t>(colors.size()), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+		}
+	}
 
+	void Model::Builder::createDeviceBuffer(Device& device, std::unique_ptr<Buffer>& buffer, const void* data,
+		uint32_t instanceSize, uint32_t instanceCount, VkBufferUsageFlags usage) {
 		Buffer stagingBuffer{
 			device,
-			indexSize,
-			static_cast<uint32_t>(indices.size()),
+			instanceSize,
+			instanceCount,
 			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 		};
 
 		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)indices.data());
+		stagingBuffer.writeToBuffer(const_cast<void*>(data));
 
 		buffer = std::make_unique<Buffer>(
 			device,
-			indexSize,
-			static_cast<uint32_t>(indices.size()),
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			instanceSize,
+			instanceCount,
+			usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
 		);
-		device.copyBuffer(stagingBuffer.getBuffer(), buffer->getBuffer(), bufferSize);
+		device.copyBuffer(stagingBuffer.getBuffer(), buffer->getBuffer(), static_cast<VkDeviceSize>(instanceSize) * instanceCount);
+	}
+
+	void Model::Builder::createIndexBuffers(Device& device, Submesh& submesh, const std::vector<uint32_t>& indices, size_t vertexCount) {
+		if (indices.empty()) {
+			return;
+		}
+
+		// Every index (all LODs and meshlet ranges included) refers to this submesh's own vertices,
+		// so anything up to 65536 of them fits in 16 bits and halves the index memory
+		if (vertexCount <= 65536) {
+			std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+			submesh.indexType = VK_INDEX_TYPE_UINT16;
+			createDeviceBuffer(device, submesh.indexBuffer, shortIndices.data(), sizeof(uint16_t),
+				static_cast<uint32_t>(shortIndices.size()), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+			return;
+		}
+
+		submesh.indexType = VK_INDEX_TYPE_UINT32;
+		createDeviceBuffer(device, submesh.indexBuffer, indices.data(), sizeof(uint32_t),
+			static_cast<uint32_t>(indices.size()), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 	}
 }
\ No newline at end of file
@@ -2,10 +2,14 @@
 
 #include "device.hpp"
 #include "renderer/buffer.hpp"
+#include "renderer/meshlet_builder.hpp"
+#include "core/utils.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
 #include <vector>
 #include <memory>
 #include <unordered_map>
@@ -20,24 +24,58 @@ namespace grape {
             glm::vec3 normal{};
             glm::vec2 uv{};
 
-            static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
-            static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
-
             bool operator==(const Vertex& other) const {
                 return position == other.position && color == other.color && normal == other.normal && uv == other.uv;
             }
         };
 
+        // What actually goes to the GPU, 16 bytes instead of the 44 of Vertex. Positions are quantized
+        // to the submesh bounds (Submesh::dequantize maps them back), normals are octahedral encoded
+        // and UVs are half floats. Color has its own stream since most assets don't have any
+        struct PackedVertex {
+            uint16_t position[4];   // UNORM16, w unused
+            uint32_t normal;        // SNORM16 x2, octahedral
+            uint32_t uv;            // SFLOAT16 x2
+
+            // Binding 0 packed vertices, binding 1 RGBA8 colors
+            static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+            static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+
+            // Positions only, straight out of binding 0, for depth-only passes
+            static std::vector<VkVertexInputBindingDescription> getPositionBindingDescriptions();
+            static std::vector<VkVertexInputAttributeDescription> getPositionAttributeDescriptions();
+        };
+
+        // One level of detail, a range of the submesh's index buffer over the shared vertices
+        struct Lod {
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            float error;    // Worst deviation from LOD 0, in model units
+        };
+
         struct Submesh {
-            std::unique_ptr<Buffer> vertexBuffer;
+            std::unique_ptr<Buffer> vertexBuffer;   // PackedVertex
+            std::unique_ptr<Buffer> colorBuffer;    // RGBA8 per vertex, only when the colors actually vary
             std::unique_ptr<Buffer> indexBuffer;
-            uint32_t indexCount;
+            VkIndexType indexType = VK_INDEX_TYPE_UINT32;   // UINT16 whenever the vertex count fits
+            glm::mat4 dequantize{ 1.f };            // Quantized position -> model space, folded into the model matrix
+            uint32_t constantColor = 0xffffffff;    // RGBA8 of every vertex when there's no color stream
+            uint32_t indexCount;    // LOD 0
             int materialId; // Changed to int to match tinyobjloader's material_id
+            std::vector<Lod> lods;  // lods[0] is the full mesh, each next one roughly half the triangles
+            std::vector<Meshlet> meshlets;  // Clusters tiling LOD 0, only built for dense submeshes
         };
 
+        static constexpr uint32_t MAX_LODS = 5;
+        // Smaller submeshes are culled as a whole, splitting them isn't worth the extra draws
+        static constexpr uint32_t MESHLET_MIN_TRIANGLES = 2048;
+
         class Builder {
         public:
             void loadModel(Device& device, const std::string& filepath);
+            // Takes an already indexed mesh: builds its meshlets and LODs, uploads it and grows the
+            // bounds. loadModel feeds every material of the OBJ through here. Reorders indices
+            void addSubmesh(Device& device, const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, int materialId);
             std::vector<Submesh> submeshes;
             std::vector<std::string> texturePaths;
             std::map<int, std::string> materialIdToTexturePath;
@@ -46,8 +84,13 @@ namespace grape {
             glm::vec3 boundingBoxMax = glm::vec3(0.0f);
 
         private:
-            void createVertexBuffers(Device& device, std::unique_ptr<Buffer>& buffer, const std::vector<Vertex>& vertices);
-            void createIndexBuffers(Device& device, std::unique_ptr<Buffer>& buffer, const std::vector<uint32_t>& indices);
+            // Packs the vertices and fills the submesh's vertex/color streams and dequantize
+            void createVertexBuffers(Device& device, Submesh& submesh, const std::vector<Vertex>& vertices);
+            void createDeviceBuffer(Device& device, std::unique_ptr<Buffer>& buffer, const void* data,
+                uint32_t instanceSize, uint32_t instanceCount, VkBufferUsageFlags usage);
+            void createIndexBuffers(Device& device, Submesh& submesh, const std::vector<uint32_t>& indices, size_t vertexCount);
+            // Appends the simplified LOD chain to indices and records the ranges in submesh.lods
+            void generateLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, Submesh& submesh);
         };
 
         Model(Device& device, Builder& builder);
@@ -77,8 +120,12 @@ namespace grape {
             return "";
         }
 
-        void drawSubmesh(VkCommandBuffer commandBuffer, uint32_t submeshIndex);
+        void drawSubmesh(VkCommandBuffer commandBuffer, uint32_t submeshIndex, uint32_t firstInstance = 0, uint32_t lod = 0);
+        // Any index range of the bound submesh, e.g. a run of visible meshlets
+        void drawIndexRange(VkCommandBuffer commandBuffer, uint32_t firstIndex, uint32_t indexCount, uint32_t firstInstance = 0);
         void bindSubmesh(VkCommandBuffer commandBuffer, uint32_t submeshIndex);
+        // Binds only the packed stream, for pipelines using the position-only layout
+        void bindSubmeshPositions(VkCommandBuffer commandBuffer, uint32_t submeshIndex);
 
         void getBoundingBox(glm::vec3& min, glm::vec3& max) const;
 
@@ -91,4 +138,16 @@ namespace grape {
         glm::vec3 boundingBoxMin = glm::vec3(0.0f);
         glm::vec3 boundingBoxMax = glm::vec3(0.0f);
     };
-}
\ No newline at end of file
+}
+
+namespace std {
+    // Used to dedup vertices while loading, lives here so the benchmarks hash the real thing
+    template <>
+    struct hash<grape::Model::Vertex> {
+        size_t operator()(grape::Model::Vertex const& vertex) const {
+            size_t seed = 0;
+            grape::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
+            return seed;
+        }
+    };
+}
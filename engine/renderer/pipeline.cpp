@@ -1,6 +1,7 @@
 #include "pipeline.hpp"
 
 #include "model.hpp"
+#include "core/perf_counters.hpp"
 
 #include <fstream>
 #include <stdexcept>
@@ -26,13 +27,16 @@ namespace grape {
 	Pipeline::~Pipeline()
 	{
 		vkDestroyShaderModule(grapeDevice.device(), vertShaderModule, nullptr);
-		vkDestroyShaderModule(grapeDevice.device(), fragShaderModule, nullptr);
+		if (fragShaderModule != VK_NULL_HANDLE) {
+			vkDestroyShaderModule(grapeDevice.device(), fragShaderModule, nullptr);
+		}
 		vkDestroyPipeline(grapeDevice.device(), graphicsPipeline, nullptr);
 	}
 
 	void Pipeline::bind(VkCommandBuffer commandBuffer)
 	{
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+		PerfCounters::add(PerfCounter::PipelineBinds);
 	}
 
 	void Pipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo)
@@ -105,8 +109,8 @@ namespace grape {
 		configInfo.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
 		configInfo.dynamicStateInfo.flags = 0;
 
-		configInfo.bindingDescriptions = Model::Vertex::getBindingDescriptions();
-		configInfo.attributeDescriptions = Model::Vertex::getAttributeDescriptions();
+		configInfo.bindingDescriptions = Model::PackedVertex::getBindingDescriptions();
+		configInfo.attributeDescriptions = Model::PackedVertex::getAttributeDescriptions();
 	}
 
 	std::vector<char> Pipeline::readFile(const std::string& filepath)
@@ -135,10 +139,13 @@ namespace grape {
 		assert(configInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline:: no renderPass provided in configInfo");
 
 		auto vertCode = readFile(vertFilepath);
-		auto fragCode = readFile(fragFilepath);
-
 		createShaderModule(vertCode, &vertShaderModule);
-		createShaderModule(fragCode, &fragShaderModule);
+
+		fragShaderModule = VK_NULL_HANDLE;
+		if (!fragFilepath.empty()) {
+			auto fragCode = readFile(fragFilepath);
+			createShaderModule(fragCode, &fragShaderModule);
+		}
 
 		VkPipelineShaderStageCreateInfo shaderStages[2];
 		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -169,7 +176,7 @@ namespace grape {
 
 		VkGraphicsPipelineCreateInfo pipelineInfo{};
 		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-		pipelineInfo.stageCount = 2;
+		pipelineInfo.stageCount = fragShaderModule != VK_NULL_HANDLE ? 2 : 1;
 		pipelineInfo.pStages = shaderStages;
 		pipelineInfo.pVertexInputState = &vertexInputInfo;
 		pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
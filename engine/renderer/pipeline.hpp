@@ -30,6 +30,7 @@ namespace grape {
 	class Pipeline {
 	
 	public:
+		// An empty fragFilepath builds a vertex-only pipeline (depth-only passes)
 		Pipeline(Device &device, const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo);
 		~Pipeline();
 
@@ -1,14 +1,28 @@
 #include "renderer.hpp"
+#include "core/job_system.hpp"
+#include "core/hitch_detector.hpp"
+#include "core/profiler.hpp"
 
 #include <stdexcept>
 #include <array>
 #include <cassert>
+#include <algorithm>
+#include <iostream>
 
 namespace grape {
 
 	Renderer::Renderer(Window& window, Device& device) : grapeWindow{ window }, grapeDevice{ device } {
+		GRAPE_MEMORY_SCOPE(MemoryTag::Renderer);
+		const auto& settings = FramePacingSettings::getInstance();
+		framesInFlight = std::clamp(settings.framesInFlight, 1, SwapChain::MAX_FRAMES_IN_FLIGHT);
+		presentMode = settings.presentMode;
+
 		recreateSwapChain();
-		createCommandBuffers();
+
+		// One slot per job system worker plus one for the main thread
+		uint32_t threadCount = JobSystem::getInstance().getWorkerCount() + 1;
+		commandPools = std::make_unique<ThreadCommandPools>(grapeDevice, SwapChain::MAX_FRAMES_IN_FLIGHT, threadCount);
+		gpuProfiler = std::make_unique<GpuProfiler>(grapeDevice, SwapChain::MAX_FRAMES_IN_FLIGHT);
 	}
 
 	Renderer::~Renderer() {
@@ -35,7 +49,8 @@ namespace grape {
 		}
 		inFlightFences.clear();
 
-		freeCommandBuffers();
+		gpuProfiler.reset();
+		commandPools.reset();
 	}
 
 	VkCommandBuffer Renderer::beginFrame() {
@@ -69,7 +84,10 @@ namespace grape {
 
 		isFrameStarted = true;
 
-		auto commandBuffer = commandBuffers[currentFrame];
+		// The fence above means the GPU is done with everything this frame recorded last time round
+		commandPools->resetFrame(static_cast<uint32_t>(currentFrame));
+		currentCommandBuffer = commandPools->acquirePrimary(static_cast<uint32_t>(currentFrame), commandPools->getCurrentThreadSlot());
+		auto commandBuffer = currentCommandBuffer;
 
 		VkCommandBufferBeginInfo beginInfo{};
 		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -78,6 +96,8 @@ namespace grape {
 			throw std::runtime_error("failed to begin recording command buffer!");
 		}
 
+		gpuProfiler->beginFrame(commandBuffer, static_cast<uint32_t>(currentFrame));
+
 		return commandBuffer;
 	}
 
@@ -115,7 +135,9 @@ namespace grape {
 	void Renderer::endFrame() {
 		assert(isFrameStarted && "Can't call endFrame while frame is not started");
 
-		auto commandBuffer = commandBuffers[currentFrame];
+		auto commandBuffer = currentCommandBuffer;
+
+		gpuProfiler->endFrame(commandBuffer, static_cast<uint32_t>(currentFrame));
 
 		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
 			throw std::runtime_error("failed to record command buffer");
@@ -153,6 +175,11 @@ namespace grape {
 
 		auto result = vkQueuePresentKHR(grapeDevice.presentQueue(), &presentInfo);
 
+		// CPU-side latency only, the compositor/scanout adds to this
+		if (inputSampleTime.time_since_epoch().count() != 0) {
+			inputToPresentMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - inputSampleTime).count();
+		}
+
 		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || grapeWindow.wasWindowResized()) {
 			grapeWindow.resetWindowResizedFlag();
 			isFrameStarted = false;
@@ -163,7 +190,27 @@ namespace grape {
 		}
 
 		isFrameStarted = false;
-		currentFrame = (currentFrame + 1) % SwapChain::MAX_FRAMES_IN_FLIGHT;
+		currentFrame = (currentFrame + 1) % framesInFlight;
+	}
+
+	void Renderer::applyFramePacingSettings(const FramePacingSettings& settings) {
+		assert(!isFrameStarted && "Can't change frame pacing while frame is in progress");
+
+		int requestedFrames = std::clamp(settings.framesInFlight, 1, SwapChain::MAX_FRAMES_IN_FLIGHT);
+		if (requestedFrames != framesInFlight) {
+			// Sync objects exist for MAX_FRAMES_IN_FLIGHT already, once idle every fence is
+			// signaled so we only have to restart the ring
+			vkDeviceWaitIdle(grapeDevice.device());
+			framesInFlight = requestedFrames;
+			currentFrame = 0;
+			std::fill(imagesInFlight.begin(), imagesInFlight.end(), VK_NULL_HANDLE);
+			std::cout << "Frames in flight: " << framesInFlight << std::endl;
+		}
+
+		if (settings.presentMode != presentMode) {
+			presentMode = settings.presentMode;
+			recreateSwapChain();
+		}
 	}
 
 	void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
@@ -207,31 +254,6 @@ namespace grape {
 		vkCmdEndRenderPass(commandBuffer);
 	}
 
-	void Renderer::createCommandBuffers()
-	{
-		commandBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
-
-		VkCommandBufferAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandPool = grapeDevice.getCommandPool();
-		allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
-
-		if (vkAllocateCommandBuffers(grapeDevice.device(), &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate command buffers!");
-		}
-	}
-
-	void Renderer::freeCommandBuffers()
-	{
-		vkFreeCommandBuffers(
-			grapeDevice.device(),
-			grapeDevice.getCommandPool(),
-			static_cast<uint32_t>(commandBuffers.size()),
-			commandBuffers.data());
-		commandBuffers.clear();
-	}
-
 	void Renderer::recreateSwapChain() {
 		auto extent = grapeWindow.getExtent();
 		while (extent.width == 0 || extent.height == 0) {
@@ -239,14 +261,16 @@ namespace grape {
 			glfwWaitEvents();
 		}
 
+		GRAPE_PROFILE_FUNCTION();
+		uint64_t start = Profiler::now();
 		vkDeviceWaitIdle(grapeDevice.device());
 
 		if (grapeSwapChain == nullptr) {
-			grapeSwapChain = std::make_unique<SwapChain>(grapeDevice, extent);
+			grapeSwapChain = std::make_unique<SwapChain>(grapeDevice, extent, presentMode);
 			createSyncObjects();
 		} else {
 			std::shared_ptr<SwapChain> oldSwapChain = std::move(grapeSwapChain);
-			grapeSwapChain = std::make_unique<SwapChain>(grapeDevice, extent, oldSwapChain);
+			grapeSwapChain = std::make_unique<SwapChain>(grapeDevice, extent, oldSwapChain, presentMode);
 
 			if (!oldSwapChain->compareSwapFormats(*grapeSwapChain.get())) {
 				throw std::runtime_error("Swap chain image (or depth) format has changed!");
@@ -275,6 +299,9 @@ namespace grape {
 				createSyncObjects();
 			}
 		}
+
+		HitchEvents::record("Swapchain Recreate", std::to_string(extent.width) + "x" + std::to_string(extent.height),
+			start, Profiler::now());
 	}
 
 	void Renderer::beginOffscreenRenderPass(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, VkRenderPass renderPass, VkExtent2D extent) {
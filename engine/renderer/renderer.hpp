@@ -3,12 +3,28 @@
 #include "core/window.hpp"
 #include "device.hpp"
 #include "swap_chain.hpp"
+#include "thread_command_pools.hpp"
+#include "gpu_profiler.hpp"
 
 #include <memory>
 #include <vector>
 #include <cassert>
+#include <chrono>
 
 namespace grape {
+
+	// Latency vs throughput knobs, filled from the command line and editable in the debug panel
+	struct FramePacingSettings {
+		VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+		int framesInFlight = 2;		// 1..SwapChain::MAX_FRAMES_IN_FLIGHT
+		int frameRateLimit = 0;		// 0 = uncapped
+
+		static FramePacingSettings& getInstance() {
+			static FramePacingSettings instance;
+			return instance;
+		}
+	};
+
 	class Renderer {
 
 	public:
@@ -26,7 +42,7 @@ namespace grape {
 		// Corrected to use currentFrame consistently
 		VkCommandBuffer getCurrentCommandBuffer() const {
 			assert(isFrameStarted && "Cannot get command buffer when frame not in progress");
-			return commandBuffers[currentFrame];
+			return currentCommandBuffer;
 		}
 
 		// Corrected to use currentFrame consistently
@@ -44,22 +60,41 @@ namespace grape {
 		VkImageView getSwapChainImageView(int index) { return grapeSwapChain->getImageView(index); }
 		size_t getSwapChainImageCount() { return grapeSwapChain->imageCount(); }
 
+		// Per-frame, per-thread pools, the current frame's set is reset at the top of beginFrame
+		ThreadCommandPools& getCommandPools() { return *commandPools; }
+		// Frame begin/end are timed by beginFrame/endFrame, passes add their own zones
+		GpuProfiler& getGpuProfiler() { return *gpuProfiler; }
+
+		// Picks up frames in flight / present mode changes, must be called between frames
+		void applyFramePacingSettings(const FramePacingSettings& settings);
+		int getFramesInFlight() const { return framesInFlight; }
+		VkPresentModeKHR getPresentMode() const { return grapeSwapChain->getPresentMode(); }
+
+		// Call right after polling input, endFrame measures from here to the present call
+		void markInputSampled() { inputSampleTime = std::chrono::steady_clock::now(); }
+		float getInputToPresentLatency() const { return inputToPresentMs; }
+
 	private:
-		void createCommandBuffers();
-		void freeCommandBuffers();
 		void recreateSwapChain();
 		void createSyncObjects();
 
 		Window& grapeWindow;
 		Device& grapeDevice;
 		std::unique_ptr<SwapChain> grapeSwapChain;
-		std::vector<VkCommandBuffer> commandBuffers;
+		std::unique_ptr<ThreadCommandPools> commandPools;
+		std::unique_ptr<GpuProfiler> gpuProfiler;
+		VkCommandBuffer currentCommandBuffer = VK_NULL_HANDLE;
 
 		std::vector<VkSemaphore> imageAvailableSemaphores;
 		std::vector<VkSemaphore> renderFinishedSemaphores;
 		std::vector<VkFence> inFlightFences;
 		std::vector<VkFence> imagesInFlight; // to track which image is being rendered
 		size_t currentFrame = 0; // The primary frame index
+		int framesInFlight = 2;
+		VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+
+		std::chrono::steady_clock::time_point inputSampleTime{};
+		float inputToPresentMs = 0.0f;
 
 		uint32_t currentImageIndex = 0;
 		bool isFrameStarted = false;
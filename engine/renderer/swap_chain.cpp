@@ -11,13 +11,13 @@
 
 namespace grape {
 
-    SwapChain::SwapChain(Device& deviceRef, VkExtent2D extent)
-        : device{ deviceRef }, windowExtent{ extent } {
+    SwapChain::SwapChain(Device& deviceRef, VkExtent2D extent, VkPresentModeKHR preferredPresentMode)
+        : device{ deviceRef }, windowExtent{ extent }, preferredPresentMode{ preferredPresentMode } {
         init();
     }
 
-    SwapChain::SwapChain(Device& deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous)
-        : device{ deviceRef }, windowExtent{ windowExtent }, oldSwapChain{ previous } {
+    SwapChain::SwapChain(Device& deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous, VkPresentModeKHR preferredPresentMode)
+        : device{ deviceRef }, windowExtent{ windowExtent }, preferredPresentMode{ preferredPresentMode }, oldSwapChain{ previous } {
 
         init();
 
@@ -40,7 +40,7 @@ namespace grape {
         for (int i = 0; i < depthImages.size(); i++) {
             vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
             vkDestroyImage(device.device(), depthImages[i], nullptr);
-            vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+            device.freeMemory(depthImageMemorys[i]);
         }
 
         for (auto framebuffer : swapChainFramebuffers) {
@@ -74,7 +74,7 @@ namespace grape {
         SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-        VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+        presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
         VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
         uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -302,10 +302,29 @@ namespace grape {
 
     VkPresentModeKHR SwapChain::chooseSwapPresentMode(
         const std::vector<VkPresentModeKHR>& availablePresentModes) {
-        std::cout << "Present mode: V-Sync" << std::endl;
+        // FIFO is the only mode the spec guarantees, so it is the fallback
+        for (const auto& availablePresentMode : availablePresentModes) {
+            if (availablePresentMode == preferredPresentMode) {
+                std::cout << "Present mode: " << presentModeName(preferredPresentMode) << std::endl;
+                return preferredPresentMode;
+            }
+        }
+
+        std::cout << "Present mode " << presentModeName(preferredPresentMode)
+            << " not supported, falling back to V-Sync" << std::endl;
         return VK_PRESENT_MODE_FIFO_KHR;
     }
 
+    const char* SwapChain::presentModeName(VkPresentModeKHR mode) {
+        switch (mode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR: return "Immediate";
+        case VK_PRESENT_MODE_MAILBOX_KHR: return "Mailbox";
+        case VK_PRESENT_MODE_FIFO_KHR: return "V-Sync";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "V-Sync (Relaxed)";
+        default: return "Unknown";
+        }
+    }
+
     VkExtent2D SwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
         if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
             return capabilities.currentExtent;
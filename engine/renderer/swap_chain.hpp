@@ -14,10 +14,12 @@ namespace grape {
 
     class SwapChain {
     public:
-        static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+        // Upper bound for frames in flight. Per-frame resources are sized to this,
+        // the Renderer only cycles through the first getFramesInFlight() of them
+        static constexpr int MAX_FRAMES_IN_FLIGHT = 3;
 
-        SwapChain(Device& deviceRef, VkExtent2D windowExtent);
-        SwapChain(Device& deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous);
+        SwapChain(Device& deviceRef, VkExtent2D windowExtent, VkPresentModeKHR preferredPresentMode = VK_PRESENT_MODE_FIFO_KHR);
+        SwapChain(Device& deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous, VkPresentModeKHR preferredPresentMode = VK_PRESENT_MODE_FIFO_KHR);
         ~SwapChain();
 
         SwapChain(const SwapChain&) = delete;
@@ -30,6 +32,7 @@ namespace grape {
         VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
         VkExtent2D getSwapChainExtent() { return swapChainExtent; }
         VkSwapchainKHR getSwapChain() const { return swapChain; }
+        VkPresentModeKHR getPresentMode() const { return presentMode; }
         uint32_t width() { return swapChainExtent.width; }
         uint32_t height() { return swapChainExtent.height; }
 
@@ -37,6 +40,7 @@ namespace grape {
             return static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height);
         }
         VkFormat findDepthFormat();
+        static const char* presentModeName(VkPresentModeKHR mode);
 
         VkResult acquireNextImage(uint32_t* imageIndex, uint32_t frameIndex);
 
@@ -74,6 +78,8 @@ namespace grape {
 
         Device& device;
         VkExtent2D windowExtent;
+        VkPresentModeKHR preferredPresentMode;
+        VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
 
         VkSwapchainKHR swapChain;
         std::shared_ptr<SwapChain> oldSwapChain;
@@ -1,6 +1,8 @@
 #include "texture.hpp"
 #include "descriptors.hpp"
 #include "swap_chain.hpp"
+#include "core/hitch_detector.hpp"
+#include "core/profiler.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -30,20 +32,25 @@ namespace grape {
 
 	void Texture::createTextureFromFile(std::string texturePath)
 	{
+		GRAPE_MEMORY_SCOPE(MemoryTag::Assets);
+		GRAPE_PROFILE_SCOPE("Texture Load");
+		uint64_t start = Profiler::now();
 		createTextureImage(ENGINE_DIR + texturePath);
 		createTextureImageView();
 		createTextureSampler();
+		HitchEvents::record("Texture Load", texturePath, start, Profiler::now());
 	}
 
 	void Texture::createTextureImage(std::string texturePath)
 	{
-		stbi_set_flip_vertically_on_load(true);
+		// Per thread, textures decode in parallel during startup
+		stbi_set_flip_vertically_on_load_thread(true);
 
 		int texWidth, texHeight, texChannels;
 		stbi_uc* pixels = stbi_load(texturePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
 		VkDeviceSize imageSize = texWidth * texHeight * 4;
 
-		stbi_set_flip_vertically_on_load(false);
+		stbi_set_flip_vertically_on_load_thread(false);
 
 		if (!pixels) {
 			throw std::runtime_error("Failed to load texture");
@@ -81,7 +88,7 @@ namespace grape {
 		transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 		vkDestroyBuffer(grapeDevice.device(), stagingBuffer, nullptr);
-		vkFreeMemory(grapeDevice.device(), stagingBufferMemory, nullptr);
+		grapeDevice.freeMemory(stagingBufferMemory);
 	}
 
 	void Texture::createImage(
@@ -122,7 +129,7 @@ namespace grape {
 		allocInfo.allocationSize = memRequirements.size;
 		allocInfo.memoryTypeIndex = grapeDevice.findMemoryType(memRequirements.memoryTypeBits, properties);
 
-		if (vkAllocateMemory(grapeDevice.device(), &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+		if (grapeDevice.allocateMemory(allocInfo, &imageMemory, GpuMemoryKind::Image) != VK_SUCCESS) {
 			throw std::runtime_error("Failed to allocate image memory!");
 		}
 
@@ -131,8 +138,6 @@ namespace grape {
 
 	void Texture::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
 	{
-		VkCommandBuffer commandBuffer = grapeDevice.beginSingleTimeCommands();
-
 		VkImageMemoryBarrier barrier{};
 		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 		barrier.oldLayout = oldLayout;
@@ -174,20 +179,21 @@ namespace grape {
 			throw std::invalid_argument("unsupported layout transition!");
 		}
 
-		vkCmdPipelineBarrier(
-			commandBuffer,
-			sourceStage, destinationStage,
-			0,
-			0, nullptr,
-			0, nullptr,
-			1, &barrier
-		);
-
-		grapeDevice.endSingleTimeCommands(commandBuffer);
+		grapeDevice.submitOneShot([&](VkCommandBuffer commandBuffer) {
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				sourceStage, destinationStage,
+				0,
+				0, nullptr,
+				0, nullptr,
+				1, &barrier
+			);
+		});
 	}
 
 	// In texture.cpp
 	void Texture::createTextureFromColor(const glm::vec4& color) {
+		GRAPE_MEMORY_SCOPE(MemoryTag::Assets);
 		int texWidth = 1;
 		int texHeight = 1;
 		VkDeviceSize imageSize = texWidth * texHeight * 4;
@@ -229,7 +235,7 @@ namespace grape {
 		transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 		vkDestroyBuffer(grapeDevice.device(), stagingBuffer, nullptr);
-		vkFreeMemory(grapeDevice.device(), stagingBufferMemory, nullptr);
+		grapeDevice.freeMemory(stagingBufferMemory);
 
 		createTextureImageView();
 		createTextureSampler();
@@ -301,7 +307,7 @@ namespace grape {
 			textureImage = VK_NULL_HANDLE;
 		}
 		if (textureImageMemory != VK_NULL_HANDLE) {
-			vkFreeMemory(grapeDevice.device(), textureImageMemory, nullptr);
+			grapeDevice.freeMemory(textureImageMemory);
 			textureImageMemory = VK_NULL_HANDLE;
 		}
 	}
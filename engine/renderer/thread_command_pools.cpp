@@ -0,0 +1,83 @@
+#include "thread_command_pools.hpp"
+#include "core/job_system.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace grape {
+
+    ThreadCommandPools::ThreadCommandPools(Device& device, uint32_t frameCount, uint32_t threadCount)
+        : device{ device }, threadCount{ threadCount } {
+        pools.resize(static_cast<size_t>(frameCount) * threadCount);
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = device.findPhysicalQueueFamilies().graphicsFamily;
+        // No RESET_COMMAND_BUFFER bit, the pool is only ever reset as a whole (cheaper for the driver)
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        for (auto& threadPool : pools) {
+            if (vkCreateCommandPool(device.device(), &poolInfo, nullptr, &threadPool.pool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create thread command pool!");
+            }
+        }
+    }
+
+    ThreadCommandPools::~ThreadCommandPools() {
+        // Destroying a pool frees its buffers
+        for (auto& threadPool : pools) {
+            vkDestroyCommandPool(device.device(), threadPool.pool, nullptr);
+        }
+    }
+
+    void ThreadCommandPools::resetFrame(uint32_t frameIndex) {
+        for (uint32_t thread = 0; thread < threadCount; thread++) {
+            auto& threadPool = getPool(frameIndex, thread);
+
+            // Skip pools nobody recorded into, resetting them would be a wasted driver call
+            if (threadPool.primaries.used == 0 && threadPool.secondaries.used == 0) continue;
+
+            if (vkResetCommandPool(device.device(), threadPool.pool, 0) != VK_SUCCESS) {
+                throw std::runtime_error("failed to reset thread command pool!");
+            }
+            threadPool.primaries.used = 0;
+            threadPool.secondaries.used = 0;
+        }
+    }
+
+    VkCommandBuffer ThreadCommandPools::acquirePrimary(uint32_t frameIndex, uint32_t threadSlot) {
+        assert(threadSlot < threadCount && "Thread slot out of range");
+        auto& threadPool = getPool(frameIndex, threadSlot);
+        return acquire(threadPool.pool, threadPool.primaries, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    }
+
+    VkCommandBuffer ThreadCommandPools::acquireSecondary(uint32_t frameIndex, uint32_t threadSlot) {
+        assert(threadSlot < threadCount && "Thread slot out of range");
+        auto& threadPool = getPool(frameIndex, threadSlot);
+        return acquire(threadPool.pool, threadPool.secondaries, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    }
+
+    uint32_t ThreadCommandPools::getCurrentThreadSlot() const {
+        int workerIndex = JobSystem::getCurrentWorkerIndex();
+        return workerIndex >= 0 ? static_cast<uint32_t>(workerIndex) : threadCount - 1;
+    }
+
+    VkCommandBuffer ThreadCommandPools::acquire(VkCommandPool pool, BufferList& list, VkCommandBufferLevel level) {
+        // Buffers survive the pool reset, only grow when a thread records more than ever before
+        if (list.used == list.buffers.size()) {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.level = level;
+            allocInfo.commandPool = pool;
+            allocInfo.commandBufferCount = 1;
+
+            VkCommandBuffer commandBuffer;
+            if (vkAllocateCommandBuffers(device.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate command buffer!");
+            }
+            list.buffers.push_back(commandBuffer);
+        }
+
+        return list.buffers[list.used++];
+    }
+}
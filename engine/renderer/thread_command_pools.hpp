@@ -0,0 +1,51 @@
+#pragma once
+
+#include "device.hpp"
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+namespace grape {
+
+    // One transient command pool per (frame in flight, recording thread). Vulkan pools are externally
+    // synchronized, so giving every thread its own lets workers record without locking. Buffers are
+    // never freed or reset one by one, the whole frame's pools are reset once its fence has signaled
+    class ThreadCommandPools {
+    public:
+        ThreadCommandPools(Device& device, uint32_t frameCount, uint32_t threadCount);
+        ~ThreadCommandPools();
+
+        ThreadCommandPools(const ThreadCommandPools&) = delete;
+        ThreadCommandPools& operator=(const ThreadCommandPools&) = delete;
+
+        // Resets every pool of frameIndex, only valid once the GPU is done with that frame
+        void resetFrame(uint32_t frameIndex);
+
+        // Next unused buffer of threadSlot's pool, only that thread may call these
+        VkCommandBuffer acquirePrimary(uint32_t frameIndex, uint32_t threadSlot);
+        VkCommandBuffer acquireSecondary(uint32_t frameIndex, uint32_t threadSlot);
+
+        // Job system workers map to their index, every other thread shares the last slot
+        uint32_t getCurrentThreadSlot() const;
+        uint32_t getThreadCount() const { return threadCount; }
+
+    private:
+        struct BufferList {
+            std::vector<VkCommandBuffer> buffers;
+            size_t used = 0;
+        };
+
+        struct ThreadPool {
+            VkCommandPool pool = VK_NULL_HANDLE;
+            BufferList primaries;
+            BufferList secondaries;
+        };
+
+        ThreadPool& getPool(uint32_t frameIndex, uint32_t threadSlot) { return pools[frameIndex * threadCount + threadSlot]; }
+        VkCommandBuffer acquire(VkCommandPool pool, BufferList& list, VkCommandBufferLevel level);
+
+        Device& device;
+        uint32_t threadCount;
+        std::vector<ThreadPool> pools;
+    };
+}
@@ -2,6 +2,7 @@
 #include "texture.hpp"
 #include "imgui/imgui_impl_vulkan.h"
 #include "swap_chain.hpp"
+#include "buffer.hpp"
 
 #include <stdexcept>
 #include <array>
@@ -9,8 +10,8 @@
 
 namespace grape {
 
-    ViewportRenderer::ViewportRenderer(Device& device, VkExtent2D extent)
-        : device{ device }, extent{ extent } {
+    ViewportRenderer::ViewportRenderer(Device& device, VkExtent2D extent, bool useImGui)
+        : device{ device }, extent{ extent }, useImGui{ useImGui } {
         createResources();
     }
 
@@ -52,7 +53,7 @@ namespace grape {
                 extent.height,
                 VK_FORMAT_B8G8R8A8_SRGB,
                 VK_IMAGE_TILING_OPTIMAL,
-                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                 images[i],
                 memories[i]
@@ -61,8 +62,10 @@ namespace grape {
             imageViews[i] = t.createImageView(images[i], VK_FORMAT_B8G8R8A8_SRGB);
 
             // ImGui descriptor for this image
-            descriptorSets[i] =
-                ImGui_ImplVulkan_AddTexture(sampler, imageViews[i], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            if (useImGui) {
+                descriptorSets[i] =
+                    ImGui_ImplVulkan_AddTexture(sampler, imageViews[i], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            }
 
             // Create depth image, memory, and view
             VkImageCreateInfo depthImageInfo{};
@@ -76,7 +79,8 @@ namespace grape {
             depthImageInfo.format = findDepthFormat();
             depthImageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
             depthImageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            depthImageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+            // Copied out after the pass for occlusion culling
+            depthImageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
             depthImageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
             depthImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
@@ -92,7 +96,7 @@ namespace grape {
             allocInfo.allocationSize = memReqs.size;
             allocInfo.memoryTypeIndex = device.findMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-            if (vkAllocateMemory(device.device(), &allocInfo, nullptr, &depthMemories[i]) != VK_SUCCESS) {
+            if (device.allocateMemory(allocInfo, &depthMemories[i], GpuMemoryKind::Image) != VK_SUCCESS) {
                 throw std::runtime_error("failed to allocate viewport depth image memory!");
             }
 
@@ -131,11 +135,11 @@ namespace grape {
         depthAttachment.format = findDepthFormat();
         depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
         depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;     // Kept for the occlusion readback
         depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
 
         VkAttachmentReference depthAttachmentRef{};
         depthAttachmentRef.attachment = 1;
@@ -158,6 +162,17 @@ namespace grape {
         dependency.dstAccessMask =
             VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
+        // Depth writes have to land before recordDepthReadback copies them out
+        VkSubpassDependency readbackDependency = {};
+        readbackDependency.srcSubpass = 0;
+        readbackDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+        readbackDependency.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        readbackDependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        readbackDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        readbackDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        std::array<VkSubpassDependency, 2> dependencies = { dependency, readbackDependency };
+
         std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
         VkRenderPassCreateInfo rpInfo{};
         rpInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -165,8 +180,8 @@ namespace grape {
         rpInfo.pAttachments = attachments.data();
         rpInfo.subpassCount = 1;
         rpInfo.pSubpasses = &subpass;
-        rpInfo.dependencyCount = 1;
-        rpInfo.pDependencies = &dependency;
+        rpInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        rpInfo.pDependencies = dependencies.data();
 
         if (vkCreateRenderPass(device.device(), &rpInfo, nullptr, &renderPass) != VK_SUCCESS) {
             throw std::runtime_error("failed to create viewport render pass!");
@@ -189,6 +204,161 @@ namespace grape {
                 throw std::runtime_error("failed to create viewport framebuffer!");
             }
         }
+
+        // --- 5. Depth readback buffers ---
+        createDepthReadbackBuffers(imageCount);
+    }
+
+    void ViewportRenderer::createDepthReadbackBuffers(size_t imageCount) {
+        depthReadbacks.clear();
+        depthReadbackValid.assign(imageCount, false);
+
+        // A depth-aspect copy of these formats is tightly packed 32-bit floats, D24 would need unpacking
+        VkFormat depthFormat = findDepthFormat();
+        if (depthFormat != VK_FORMAT_D32_SFLOAT && depthFormat != VK_FORMAT_D32_SFLOAT_S8_UINT) {
+            std::cout << "Viewport depth format has no float readback, occlusion culling disabled" << std::endl;
+            return;
+        }
+
+        depthReadbacks.resize(imageCount);
+        for (size_t i = 0; i < imageCount; i++) {
+            // Cached memory makes the CPU reads a lot cheaper, not every device has it though
+            try {
+                depthReadbacks[i] = std::make_unique<Buffer>(
+                    device,
+                    sizeof(float),
+                    extent.width * extent.height,
+                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+            }
+            catch (const std::runtime_error&) {
+                depthReadbacks[i] = std::make_unique<Buffer>(
+                    device,
+                    sizeof(float),
+                    extent.width * extent.height,
+                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+            }
+            depthReadbacks[i]->map();
+        }
+    }
+
+    void ViewportRenderer::recordDepthReadback(VkCommandBuffer cmd, uint32_t frameIndex) {
+        if (frameIndex >= depthReadbacks.size()) return;
+
+        // The render pass already left the image in TRANSFER_SRC_OPTIMAL
+        VkBufferImageCopy region{};
+        region.bufferOffset = 0;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = { 0, 0, 0 };
+        region.imageExtent = { extent.width, extent.height, 1 };
+
+        vkCmdCopyImageToBuffer(cmd, depthImages[frameIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            depthReadbacks[frameIndex]->getBuffer(), 1, &region);
+
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = depthReadbacks[frameIndex]->getBuffer();
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+            0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+        depthReadbackValid[frameIndex] = true;
+    }
+
+    const float* ViewportRenderer::getDepthReadback(uint32_t frameIndex) {
+        if (frameIndex >= depthReadbacks.size() || !depthReadbackValid[frameIndex]) {
+            return nullptr;
+        }
+
+        depthReadbacks[frameIndex]->invalidate();
+        return static_cast<const float*>(depthReadbacks[frameIndex]->getMappedMemory());
+    }
+
+    void ViewportRenderer::recordColorReadback(VkCommandBuffer cmd, uint32_t frameIndex) {
+        if (frameIndex >= images.size()) return;
+
+        if (colorReadbacks.empty()) {
+            colorReadbacks.resize(images.size());
+            colorReadbackValid.assign(images.size(), false);
+            for (auto& readback : colorReadbacks) {
+                readback = std::make_unique<Buffer>(
+                    device,
+                    4,
+                    extent.width * extent.height,
+                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+                readback->map();
+            }
+        }
+
+        // The pass leaves the color image ready for sampling, borrow it for the copy and hand it back
+        VkImageMemoryBarrier toTransfer{};
+        toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        toTransfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        toTransfer.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toTransfer.image = images[frameIndex];
+        toTransfer.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = { 0, 0, 0 };
+        region.imageExtent = { extent.width, extent.height, 1 };
+
+        vkCmdCopyImageToBuffer(cmd, images[frameIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            colorReadbacks[frameIndex]->getBuffer(), 1, &region);
+
+        VkImageMemoryBarrier toShader = toTransfer;
+        toShader.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        toShader.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        toShader.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        toShader.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        VkBufferMemoryBarrier toHost{};
+        toHost.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        toHost.buffer = colorReadbacks[frameIndex]->getBuffer();
+        toHost.offset = 0;
+        toHost.size = VK_WHOLE_SIZE;
+
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+            0, 0, nullptr, 1, &toHost, 1, &toShader);
+
+        colorReadbackValid[frameIndex] = true;
+    }
+
+    const uint8_t* ViewportRenderer::getColorReadback(uint32_t frameIndex) {
+        if (frameIndex >= colorReadbacks.size() || !colorReadbackValid[frameIndex]) {
+            return nullptr;
+        }
+
+        colorReadbacks[frameIndex]->invalidate();
+        return static_cast<const uint8_t*>(colorReadbacks[frameIndex]->getMappedMemory());
     }
 
     VkFormat ViewportRenderer::findDepthFormat() {
@@ -312,7 +482,7 @@ namespace grape {
             for (size_t i = 0; i < memories.size(); i++) {
                 if (memories[i] != VK_NULL_HANDLE) {
                     std::cout << "Freeing memory " << i << std::endl;
-                    vkFreeMemory(device.device(), memories[i], nullptr);
+                    device.freeMemory(memories[i]);
                     memories[i] = VK_NULL_HANDLE;
                 }
             }
@@ -320,11 +490,16 @@ namespace grape {
             for (size_t i = 0; i < depthMemories.size(); i++) {
                 if (depthMemories[i] != VK_NULL_HANDLE) {
                     std::cout << "Freeing depth memory " << i << std::endl;
-                    vkFreeMemory(device.device(), depthMemories[i], nullptr);
+                    device.freeMemory(depthMemories[i]);
                     depthMemories[i] = VK_NULL_HANDLE;
                 }
             }
 
+            depthReadbacks.clear();
+            depthReadbackValid.clear();
+            colorReadbacks.clear();
+            colorReadbackValid.clear();
+
             // 7. Destroy sampler (independent, can be done anytime after ImGui cleanup)
             if (sampler != VK_NULL_HANDLE) {
                 std::cout << "Destroying sampler" << std::endl;
@@ -374,7 +549,7 @@ namespace grape {
         return descriptorSets[frameIndex];
     }
 
-    void ViewportRenderer::beginRenderPass(VkCommandBuffer cmd, uint32_t frameIndex) {
+    void ViewportRenderer::beginRenderPass(VkCommandBuffer cmd, uint32_t frameIndex, VkSubpassContents contents) {
         if (framebuffers.empty()) {
             std::cout << "ERROR: framebuffers vector is empty!" << std::endl;
             return;
@@ -400,8 +575,16 @@ namespace grape {
         rpInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         rpInfo.pClearValues = clearValues.data();
 
-        vkCmdBeginRenderPass(cmd, &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(cmd, &rpInfo, contents);
+        renderPassOpen = true;
+
+        // Dynamic state isn't inherited, each secondary sets its own
+        if (contents == VK_SUBPASS_CONTENTS_INLINE) {
+            setViewportAndScissor(cmd);
+        }
+    }
 
+    void ViewportRenderer::setViewportAndScissor(VkCommandBuffer cmd) {
         VkViewport viewport{};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
@@ -454,6 +637,7 @@ namespace grape {
 
     void ViewportRenderer::endRenderPass(VkCommandBuffer cmd) {
         vkCmdEndRenderPass(cmd);
+        renderPassOpen = false;
     }
 
 } // namespace grape
@@ -1,14 +1,17 @@
 #pragma once
 
 #include "device.hpp"
+#include "buffer.hpp"
 #include <vulkan/vulkan.h>
+#include <memory>
 #include <vector>
 
 namespace grape {
 
     class ViewportRenderer {
     public:
-        ViewportRenderer(Device& device, VkExtent2D extent);
+        // Without ImGui (headless) there are no ImGui textures and getImGuiDescriptorSet returns null
+        ViewportRenderer(Device& device, VkExtent2D extent, bool useImGui = true);
         ~ViewportRenderer();
 
         ViewportRenderer(const ViewportRenderer&) = delete;
@@ -16,9 +19,13 @@ namespace grape {
 
         void resize(VkExtent2D newExtent);
 
-        // Render pass control
-        void beginRenderPass(VkCommandBuffer cmd, uint32_t frameIndex);
+        // Render pass control. With SECONDARY_COMMAND_BUFFERS contents every draw (and the
+        // viewport/scissor, see setViewportAndScissor) has to come from executed secondaries
+        void beginRenderPass(VkCommandBuffer cmd, uint32_t frameIndex, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
         void endRenderPass(VkCommandBuffer cmd);
+        // Begun and not ended yet, so a failed recording can still close it
+        bool isRenderPassOpen() const { return renderPassOpen; }
+        void setViewportAndScissor(VkCommandBuffer cmd);
 
         // For ImGui::Image()
         VkDescriptorSet getImGuiDescriptorSet(uint32_t frameIndex);
@@ -26,9 +33,22 @@ namespace grape {
         VkFormat findDepthFormat();
 
         VkRenderPass getRenderPass() const { return renderPass; }
+        VkFramebuffer getFramebuffer(uint32_t frameIndex) const { return framebuffers[frameIndex]; }
+        VkExtent2D getExtent() const { return extent; }
 
         void cleanupImGuiDescriptors();
 
+        // Copies frameIndex's depth into its host buffer, record after endRenderPass
+        void recordDepthReadback(VkCommandBuffer cmd, uint32_t frameIndex);
+        // Depth from the last time frameIndex was recorded (extent sized, row 0 on top), only
+        // safe once that frame's fence has signaled. Null before the first copy or after a resize
+        const float* getDepthReadback(uint32_t frameIndex);
+
+        // Same for the color image, BGRA8 (sRGB encoded). The host buffers are only created the
+        // first time this is recorded, the editor never pays for them
+        void recordColorReadback(VkCommandBuffer cmd, uint32_t frameIndex);
+        const uint8_t* getColorReadback(uint32_t frameIndex);
+
     private:
         Device& device;
 
@@ -44,11 +64,19 @@ namespace grape {
         std::vector<VkDeviceMemory> depthMemories;
         std::vector<VkImageView> depthImageViews;
 
+        std::vector<std::unique_ptr<Buffer>> depthReadbacks;
+        std::vector<bool> depthReadbackValid;
+        std::vector<std::unique_ptr<Buffer>> colorReadbacks;
+        std::vector<bool> colorReadbackValid;
+
         VkSampler sampler{ VK_NULL_HANDLE };
 
+        bool useImGui = true;
         bool imguiDescriptorsCleanedUp = false;
+        bool renderPassOpen = false;
 
         void createResources();
+        void createDepthReadbackBuffers(size_t imageCount);
         void cleanup();
     };
 
@@ -8,11 +8,12 @@ namespace grape {
         viewerObject->transform.translation.z = -15.f;
     }
 
-    void CameraController::update(GLFWwindow* window, float frameTime, float aspectRatio) {
+    void CameraController::update(const FrameInput& input, float aspectRatio) {
         glm::vec3 cameraPosition = viewerObject->transform.translation;
         glm::vec3 forwardDirection = glm::normalize(viewerObject->transform.rotation * glm::vec3(0.0f, 0.0f, 1.0f));
 
-        movementController.moveInPlaneXZ(window, frameTime, *viewerObject);
+        // Headless input is empty unless it's replaying a recording, so the camera stays put
+        movementController.moveInPlaneXZ(input, input.frameTime, *viewerObject);
         camera.setViewDirection(cameraPosition, forwardDirection, glm::vec3(0.0f, -1.0f, 0.0f));
         camera.setPerspectiveProjection(glm::radians(45.0f), aspectRatio, 0.1f, 1000.0f);
     }
@@ -10,7 +10,7 @@ namespace grape {
         CameraController();
         ~CameraController() = default;
 
-        void update(GLFWwindow* window, float frameTime, float aspectRatio);
+        void update(const FrameInput& input, float aspectRatio);
         Camera& getCamera() { return camera; }
         const Camera& getCamera() const { return camera; }
 
@@ -69,6 +69,7 @@ namespace grape {
 
     struct PointLightComponent {
         float lightIntensity = 1.0f;
+        float range = 10.0f;    // Falls off to zero here, also the culling radius for the light clusters
     };
 
     // New Physics Component
@@ -158,18 +159,6 @@ namespace grape {
             }
         }
 
-        void setPhysicsTransform(const glm::vec3& position, const glm::quat& rotation = glm::quat(1, 0, 0, 0)) {
-            if (physicsComponent && physicsComponent->actor) {
-                PxTransform pxTransform(
-                    PxVec3(position.x, position.y, position.z),
-                    PxQuat(rotation.x, rotation.y, rotation.z, rotation.w)
-                );
-                physicsComponent->actor->setGlobalPose(pxTransform);
-                transform.translation = position;
-                transform.rotation = rotation;
-            }
-        }
-
         bool hasPhysics() const { return physicsComponent != nullptr; }
 
         // Public members
@@ -2,9 +2,16 @@
 #include "renderer/model.hpp"
 #include "renderer/texture.hpp"
 #include "game_object.hpp"
+#include "resource_manager.hpp"
+#include "core/job_system.hpp"
 
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
 #include <memory>
 #include <iostream>
+#include <random>
 
 namespace grape {
 
@@ -18,132 +25,253 @@ namespace grape {
 		loadedTextures.clear(); // This calls the destructors for all unique_ptr<Texture> objects
 	}
 
-	void GameObjectLoader::loadGameObjects(Device& grapeDevice, Physics physics, GameObject::Map& gameObjects)
+	namespace {
+		// Filled in by the model tasks, used by the scene task once they're done
+		struct SceneModels {
+			std::shared_ptr<Model> arcade;
+			std::shared_ptr<Model> plane;
+			std::shared_ptr<Model> trash;
+		};
+	}
+
+	StartupTaskId GameObjectLoader::addLoadTasks(StartupGraph& graph, Device& grapeDevice, Physics& physics, GameObject::Map& gameObjects,
+		const std::vector<StartupTaskId>& assetsAfter, const std::vector<StartupTaskId>& sceneAfter)
 	{
-		// Load the arcade model
-		std::shared_ptr<Model> arcadeModel = Model::createModelFromFile(grapeDevice, "resources/models/Asteroids.obj");
+		auto models = std::make_shared<SceneModels>();
+
+		// Material textures are only known once a model is parsed, so they wait for it
+		StartupTaskId arcadeModel = graph.add("Model Asteroids.obj", [&grapeDevice, models]() {
+			models->arcade = Model::createModelFromFile(grapeDevice, "resources/models/Asteroids.obj");
+		}, assetsAfter);
+		StartupTaskId arcadeTextures = graph.add("Textures Asteroids.obj", [this, &grapeDevice, models]() {
+			loadTextures(grapeDevice, models->arcade->getTexturePaths());
+		}, { arcadeModel });
+
+		StartupTaskId planeModel = graph.add("Model plane.obj", [&grapeDevice, models]() {
+			models->plane = Model::createModelFromFile(grapeDevice, "resources/models/plane.obj");
+		}, assetsAfter);
+		StartupTaskId planeTextures = graph.add("Textures plane.obj", [this, &grapeDevice, models]() {
+			loadTextures(grapeDevice, models->plane->getTexturePaths());
+		}, { planeModel });
+
+		StartupTaskId trashModel = graph.add("Model trash_box_fixes.obj", [&grapeDevice, models]() {
+			models->trash = Model::createModelFromFile(grapeDevice, "resources/models/trash_box_fixes.obj");
+		}, assetsAfter);
+		StartupTaskId trashTexture = graph.add("Texture trash_box_BaseColor", [this, &grapeDevice]() {
+			loadTextures(grapeDevice, { "trash_box_BaseColor.tga.png" });
+		}, assetsAfter);
+
+		std::vector<StartupTaskId> sceneDependencies{ arcadeModel, arcadeTextures, planeModel, planeTextures, trashModel, trashTexture };
+		sceneDependencies.insert(sceneDependencies.end(), sceneAfter.begin(), sceneAfter.end());
+
+		return graph.add("Build Scene", [this, &grapeDevice, &physics, &gameObjects, models]() {
+			GRAPE_MEMORY_SCOPE(MemoryTag::Scene);
+
+			// Create the arcade game object
+			auto arcade = GameObject::createPhysicsObject(physics, glm::vec3(0.f, -5.f, 0.f), true, false);
+			arcade.name = "Arcade";
+			arcade.model = models->arcade;
+			arcade.transform.scale = glm::vec3(1.f);
+			arcade.transform.rotation = glm::angleAxis(glm::radians(0.0f), glm::vec3(1.f, 0.f, 0.f));
+
+			// Compute bounding box
+			glm::vec3 min, max;
+			models->arcade->getBoundingBox(min, max);
+			glm::vec3 size = max - min;
+			glm::vec3 halfExtents = 0.5f * size * arcade.transform.scale;
+
+			std::cout << "Arcade model bounding box:" << std::endl;
+			std::cout << "  Min: (" << min.x << ", " << min.y << ", " << min.z << ")" << std::endl;
+			std::cout << "  Max: (" << max.x << ", " << max.y << ", " << max.z << ")" << std::endl;
+			std::cout << "  Half extents: (" << halfExtents.x << ", " << halfExtents.y << ", " << halfExtents.z << ")" << std::endl;
+			std::cout << "  Submesh count: " << models->arcade->getSubmeshCount() << std::endl;
+
+			// Add collider with correct size
+			arcade.addBoxCollider(physics, halfExtents);
+			gameObjects.emplace(arcade.getId(), std::move(arcade));
+
+			// Create point lights
+			std::vector<glm::vec3> lightColors{
+				{1.f, .1f, .1f},
+				{.1f, .1f, 1.f},
+				{.1f, 1.f, .1f},
+				{1.f, 1.f, .1f},
+				{.1f, 1.f, 1.f},
+				{1.f, 1.f, 1.f}
+			};
+
+			for (int i = 0; i < lightColors.size(); i++) {
+				auto pointLight = GameObject::makePointLight(1.2f);
+				pointLight.color = lightColors[i];
+
+				// Calculate angle for this light in the circle
+				float angle = (i * glm::two_pi<float>()) / lightColors.size();
+
+				// Position lights in a circle ABOVE the floor
+				float radius = 2.0f;  // Distance from center
+				float height = -2.0f;  // Height above floor (positive Y)
+
+				pointLight.transform.translation = glm::vec3(
+					radius * cos(angle),  // X position (circle)
+					height,               // Y position (above floor)
+					radius * sin(angle)   // Z position (circle)
+				);
+
+				gameObjects.emplace(pointLight.getId(), std::move(pointLight));
+			}
 
-		// Get the material-to-texture mapping from the builder
-		const auto& modelTexturePaths = arcadeModel->getTexturePaths();
+			// Create floor game object
+			auto floor = GameObject::createGameObject();
+			floor.name = "Floor";
+			floor.model = models->plane;
+			floor.transform.translation = glm::vec3(0.f, 1.f, 0.f);
+			floor.transform.scale = glm::vec3(10.f, 1.f, 10.f);
+			gameObjects.emplace(floor.getId(), std::move(floor));
+
+			auto trash = GameObject::createGameObject();
+			trash.name = "Trash";
+			trash.model = models->trash;
+			trash.transform.translation = glm::vec3(0.f, -1.f, 0.f);
+			trash.transform.scale = glm::vec3(1.5f, 1.f, 1.5f);
+			gameObjects.emplace(trash.getId(), std::move(trash));
+
+			finishLoading(grapeDevice, gameObjects);
+		}, sceneDependencies);
+	}
+
+	void GameObjectLoader::loadTextures(Device& grapeDevice, const std::vector<std::string>& paths)
+	{
+		// Claim each path first, so two models sharing a texture don't both decode it
+		std::vector<std::string> claimed;
+		{
+			std::lock_guard<std::mutex> lock(loadedTexturesMutex);
+			for (const auto& path : paths) {
+				if (!path.empty() && loadedTextures.emplace(path, nullptr).second) {
+					claimed.push_back(path);
+				}
+			}
+		}
 
-		std::cout << "Loading textures for arcade model:" << std::endl;
-		for (const auto& path : modelTexturePaths) {
-			if (!path.empty() && loadedTextures.find(path) == loadedTextures.end()) {
-				std::cout << "  Loading texture: " << path << std::endl;
+		std::vector<std::unique_ptr<Texture>> textures(claimed.size());
+		JobSystem::getInstance().parallelFor(claimed.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
 				try {
-					auto newTexture = std::make_unique<Texture>(grapeDevice);
-					newTexture->createTextureFromFile("resources/textures/" + path);
-					loadedTextures.emplace(path, std::move(newTexture));
-					std::cout << "    Success!" << std::endl;
+					auto texture = std::make_unique<Texture>(grapeDevice);
+					texture->createTextureFromFile("resources/textures/" + claimed[i]);
+					textures[i] = std::move(texture);
 				}
 				catch (const std::exception& e) {
-					std::cout << "    Failed to load texture " << path << ": " << e.what() << std::endl;
+					std::cout << "Failed to load texture " << claimed[i] << ": " << e.what() << std::endl;
 				}
 			}
-			else if (!path.empty()) {
-				std::cout << "  Texture already loaded: " << path << std::endl;
+		});
+
+		std::lock_guard<std::mutex> lock(loadedTexturesMutex);
+		for (size_t i = 0; i < claimed.size(); i++) {
+			if (textures[i]) {
+				std::cout << "  Loaded texture: " << claimed[i] << std::endl;
+				loadedTextures[claimed[i]] = std::move(textures[i]);
+			}
+			else {
+				loadedTextures.erase(claimed[i]);
 			}
 		}
+	}
 
-		// Create the arcade game object
-		auto arcade = GameObject::createPhysicsObject(physics, glm::vec3(0.f, -5.f, 0.f), true, false);
-		arcade.name = "Arcade";
-		arcade.model = arcadeModel;
-		arcade.transform.scale = glm::vec3(1.f);
-		arcade.transform.rotation = glm::angleAxis(glm::radians(0.0f), glm::vec3(1.f, 0.f, 0.f));
-
-		// Compute bounding box
-		glm::vec3 min, max;
-		arcadeModel->getBoundingBox(min, max);
-		glm::vec3 size = max - min;
-		glm::vec3 halfExtents = 0.5f * size * arcade.transform.scale;
-
-		std::cout << "Arcade model bounding box:" << std::endl;
-		std::cout << "  Min: (" << min.x << ", " << min.y << ", " << min.z << ")" << std::endl;
-		std::cout << "  Max: (" << max.x << ", " << max.y << ", " << max.z << ")" << std::endl;
-		std::cout << "  Half extents: (" << halfExtents.x << ", " << halfExtents.y << ", " << halfExtents.z << ")" << std::endl;
-		std::cout << "  Submesh count: " << arcadeModel->getSubmeshCount() << std::endl;
-
-		// Add collider with correct size
-		arcade.addBoxCollider(physics, halfExtents);
-		gameObjects.emplace(arcade.getId(), std::move(arcade));
-
-		// Create point lights
-		std::vector<glm::vec3> lightColors{
-			{1.f, .1f, .1f},
-			{.1f, .1f, 1.f},
-			{.1f, 1.f, .1f},
-			{1.f, 1.f, .1f},
-			{.1f, 1.f, 1.f},
-			{1.f, 1.f, 1.f}
-		};
-
-		for (int i = 0; i < lightColors.size(); i++) {
-			auto pointLight = GameObject::makePointLight(1.2f);
-			pointLight.color = lightColors[i];
-
-			// Calculate angle for this light in the circle
-			float angle = (i * glm::two_pi<float>()) / lightColors.size();
-
-			// Position lights in a circle ABOVE the floor
-			float radius = 2.0f;  // Distance from center
-			float height = -2.0f;  // Height above floor (positive Y)
-
-			pointLight.transform.translation = glm::vec3(
-				radius * cos(angle),  // X position (circle)
-				height,               // Y position (above floor)
-				radius * sin(angle)   // Z position (circle)
-			);
+	void GameObjectLoader::loadStressScene(Device& grapeDevice, Physics& physics, GameObject::Map& gameObjects, const StressSceneSettings& settings)
+	{
+		std::mt19937 rng{ settings.seed };
+		std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+
+		const uint32_t textureCount = std::clamp(settings.textures, 1u, ResourceManager::MAX_TEXTURES - 1);
+		const uint32_t meshCount = std::max(settings.uniqueMeshes, 1u);
+		const uint32_t bodyCount = std::min(settings.dynamicBodies, settings.instances);
+		if (textureCount != settings.textures) {
+			std::cout << "Stress scene: clamped textures to " << textureCount << " (bindless array size)" << std::endl;
+		}
 
-			gameObjects.emplace(pointLight.getId(), std::move(pointLight));
+		for (uint32_t i = 0; i < textureCount; i++) {
+			auto texture = std::make_unique<Texture>(grapeDevice);
+			texture->createTextureFromColor(stressTextureColor(i));
+			loadedTextures.emplace(stressTexturePath(i), std::move(texture));
 		}
-		// Load the plane model for floor
-		std::shared_ptr<Model> planeModel = Model::createModelFromFile(grapeDevice, "resources/models/plane.obj");
 
-		// Load textures for plane
-		const auto& planeTexturePaths = planeModel->getTexturePaths();
-		for (const auto& path : planeTexturePaths) {
-			if (!path.empty() && loadedTextures.find(path) == loadedTextures.end()) {
-				try {
-					auto newTexture = std::make_unique<Texture>(grapeDevice);
-					newTexture->createTextureFromFile("resources/textures/" + path);
-					loadedTextures.emplace(path, std::move(newTexture));
-				}
-				catch (const std::exception& e) {
-					std::cout << "Failed to load plane texture " << path << ": " << e.what() << std::endl;
-				}
-			}
+		std::vector<std::shared_ptr<Model>> meshes;
+		for (uint32_t i = 0; i < meshCount; i++) {
+			meshes.push_back(createStressMesh(grapeDevice, i, stressTexturePath(i % textureCount)));
 		}
 
-		// Create floor game object
+		// Square grid centered on the origin, the floor is y = 1 (Y points down)
+		const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(std::max(settings.instances, 1u)))));
+		const float halfWidth = side * settings.spacing * 0.5f;
+		gameObjects.reserve(gameObjects.size() + settings.instances + settings.pointLights + 1);
+
+		// Mesh 0 is always the box
 		auto floor = GameObject::createGameObject();
-		floor.name = "Floor";
-		floor.model = planeModel;
-		floor.transform.translation = glm::vec3(0.f, 1.f, 0.f);
-		floor.transform.scale = glm::vec3(10.f, 1.f, 10.f);
+		floor.name = "Stress Floor";
+		floor.model = meshes[0];
+		floor.transform.translation = glm::vec3(0.f, 1.5f, 0.f);
+		floor.transform.scale = glm::vec3(halfWidth * 2.f + settings.spacing, 1.f, halfWidth * 2.f + settings.spacing);
 		gameObjects.emplace(floor.getId(), std::move(floor));
 
-		std::shared_ptr<Model> trashModel = Model::createModelFromFile(grapeDevice, "resources/models/trash_box_fixes.obj");
+		// Dynamic bodies are spread evenly over the instances and start a few units up so they fall
+		const uint32_t bodyStride = bodyCount > 0 ? settings.instances / bodyCount : 0;
+		uint32_t bodiesPlaced = 0;
+
+		for (uint32_t i = 0; i < settings.instances; i++) {
+			const uint32_t meshIndex = i % meshCount;
+			const float scale = 0.6f + unit(rng) * 0.8f;
+			glm::vec3 boundsMin, boundsMax;
+			meshes[meshIndex]->getBoundingBox(boundsMin, boundsMax);
+			const glm::vec3 position{
+				(i % side + 0.5f) * settings.spacing - halfWidth + (unit(rng) - 0.5f) * settings.spacing * 0.3f,
+				1.f - boundsMax.y * scale,
+				(i / side + 0.5f) * settings.spacing - halfWidth + (unit(rng) - 0.5f) * settings.spacing * 0.3f };
+			const glm::quat rotation = glm::angleAxis(unit(rng) * glm::two_pi<float>(), glm::vec3(0.f, 1.f, 0.f));
+
+			if (bodyStride > 0 && bodiesPlaced < bodyCount && i % bodyStride == 0) {
+				auto body = GameObject::createPhysicsObject(physics, position - glm::vec3(0.f, 3.f + unit(rng) * 3.f, 0.f), true, false);
+				body.name = "Stress Body " + std::to_string(bodiesPlaced);
+				body.model = meshes[meshIndex];
+				body.transform.scale = glm::vec3(scale);
+				body.transform.rotation = rotation;
+				body.physicsComponent->actor->setGlobalPose(body.transform.toPxTransform());
+				body.addBoxCollider(physics, (boundsMax - boundsMin) * 0.5f * scale);
+				gameObjects.emplace(body.getId(), std::move(body));
+				bodiesPlaced++;
+				continue;
+			}
+
+			auto prop = GameObject::createGameObject();
+			prop.model = meshes[meshIndex];
+			prop.transform.translation = position;
+			prop.transform.scale = glm::vec3(scale);
+			prop.transform.rotation = rotation;
+			gameObjects.emplace(prop.getId(), std::move(prop));
+		}
+
+		for (uint32_t i = 0; i < settings.pointLights; i++) {
+			auto pointLight = GameObject::makePointLight(1.2f);
+			pointLight.color = glm::vec3(stressTextureColor(i));
+			pointLight.pointLight->range = settings.spacing * 3.f;
+			pointLight.transform.translation = glm::vec3(
+				(unit(rng) - 0.5f) * halfWidth * 2.f,
+				-0.5f - unit(rng) * 2.f,
+				(unit(rng) - 0.5f) * halfWidth * 2.f);
+			gameObjects.emplace(pointLight.getId(), std::move(pointLight));
+		}
 
-		auto newTexture = std::make_unique<Texture>(grapeDevice);
-		newTexture->createTextureFromFile("resources/textures/trash_box_BaseColor.tga.png");
-		loadedTextures.emplace("trash_box_BaseColor.tga.png", std::move(newTexture));
+		std::cout << "Stress scene: " << settings.instances << " instances (" << bodiesPlaced << " dynamic), "
+			<< meshCount << " meshes, " << textureCount << " textures, " << settings.pointLights << " lights" << std::endl;
 
-		auto trash = GameObject::createGameObject();
-		trash.name = "Trash";
-		trash.model = trashModel;
-		trash.transform.translation = glm::vec3(0.f, -1.f, 0.f);
-		trash.transform.scale = glm::vec3(1.5f, 1.f, 1.5f);
-		gameObjects.emplace(trash.getId(), std::move(trash));
+		finishLoading(grapeDevice, gameObjects);
+	}
 
+	void GameObjectLoader::finishLoading(Device& grapeDevice, GameObject::Map& gameObjects)
+	{
 		// IMPORTANT: Create the texture mapping after all textures are loaded
 		createTexturePathToIndexMapping(gameObjects);
 
-		if (loadedTextures.empty()) {
-			fallbackTexture = std::make_unique<Texture>(grapeDevice);
-			fallbackTexture->createTextureFromColor(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
-		}
-
 		std::cout << "Creating fallback texture..." << std::endl;
 		try {
 			fallbackTexture = std::make_unique<Texture>(grapeDevice);
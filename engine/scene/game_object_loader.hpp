@@ -2,10 +2,13 @@
 
 #include "game_object_loader.hpp"
 #include "game_object.hpp"
+#include "stress_scene.hpp"
 
 #include "renderer/model.hpp"
 #include "renderer/texture.hpp"
+#include "core/startup_graph.hpp"
 
+#include <mutex>
 #include <vector>
 
 namespace grape {
@@ -16,7 +19,13 @@ namespace grape {
 		GameObjectLoader();
 		~GameObjectLoader();
 
-		void loadGameObjects(Device& grapeDevice, Physics physics, GameObject::Map& gameObjects);
+		// The hand placed scene as startup tasks: models and their textures load in parallel after
+		// assetsAfter, the game objects get built once they're all in and sceneAfter is done.
+		// Returns the task that finishes the scene
+		StartupTaskId addLoadTasks(StartupGraph& graph, Device& grapeDevice, Physics& physics, GameObject::Map& gameObjects,
+			const std::vector<StartupTaskId>& assetsAfter, const std::vector<StartupTaskId>& sceneAfter);
+		// Procedural scene for scaling tests instead of the hand placed one, see StressSceneSettings
+		void loadStressScene(Device& grapeDevice, Physics& physics, GameObject::Map& gameObjects, const StressSceneSettings& settings);
 
 		// Optional: getter for loaded textures (might be useful for debugging)
 		const std::unordered_map<std::string, std::unique_ptr<Texture>>& getLoadedTextures() const {
@@ -30,6 +39,9 @@ namespace grape {
 
 		int getTextureDescriptorIndex(const std::string& texturePath) const;
 
+        // Unique texture paths of every model, in first-seen order
+        static std::vector<std::string> collectUniqueTexturePaths(const GameObject::Map& gameObjects);
+
         std::vector<std::string> getOrderedTexturePaths() const {
             return orderedTexturePaths;
         }
@@ -54,15 +66,18 @@ namespace grape {
         }
 
 	private:
+		// Decodes and uploads the ones nobody has loaded yet in parallel, any thread
+		void loadTextures(Device& grapeDevice, const std::vector<std::string>& paths);
+
 		std::unordered_map<std::string, std::unique_ptr<Texture>> loadedTextures;
+		std::mutex loadedTexturesMutex;     // While loading, the texture tasks share the map
 		std::unordered_map<std::string, int> texturePathToDescriptorIndex;
 
 		void createTexturePathToIndexMapping(GameObject::Map &gameObjects);
+		// Texture mapping and fallback texture, the last step of either scene
+		void finishLoading(Device& grapeDevice, GameObject::Map& gameObjects);
 
         std::vector<std::string> orderedTexturePaths;  // Keep track of texture order
         mutable std::unique_ptr<Texture> fallbackTexture;  // Fallback texture
-
-        // Helper method to collect unique texture paths
-        std::vector<std::string> collectUniqueTexturePaths(const GameObject::Map& gameObjects);
 	};
 }
\ No newline at end of file
@@ -1,28 +1,193 @@
 #include "render_manager.hpp"
+#include "core/job_system.hpp"
+#include "core/profiler.hpp"
+#include "core/memory_tracker.hpp"
+
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 
 namespace grape {
-    RenderManager::RenderManager(Device& device, Renderer& renderer, VkDescriptorSetLayout globalSetLayout)
-        : device(device), renderer(renderer),
-        simpleRenderSystem(device, renderer.getSwapChainRenderPass(), globalSetLayout),
-        pointLightSystem(device, renderer.getSwapChainRenderPass(), globalSetLayout) {
+
+    namespace {
+        // Ends the viewport pass if recording threw while it was open
+        struct ViewportPassGuard {
+            ViewportRenderer& renderer;
+            VkCommandBuffer commandBuffer;
+
+            ~ViewportPassGuard() {
+                if (renderer.isRenderPassOpen()) renderer.endRenderPass(commandBuffer);
+            }
+        };
+    }
+
+    RenderManager::RenderManager(Device& device, VkRenderPass renderPass, ThreadCommandPools& commandPools, VkDescriptorSetLayout globalSetLayout)
+        : device(device), commandPools(commandPools),
+        lightClusterSystem(device),
+        pointShadowSystem(device),
+        simpleRenderSystem(device, renderPass, globalSetLayout, lightClusterSystem.getSetLayout(),
+            pointShadowSystem.getSetLayout()),
+        pointLightSystem(device, renderPass, globalSetLayout) {
     }
 
     void RenderManager::render(FrameInfo& frameInfo, std::unique_ptr<ViewportRenderer>& viewportRenderer, bool needsViewportResize) {
         if (!needsViewportResize && viewportRenderer) {
             try {
-                viewportRenderer->beginRenderPass(frameInfo.commandBuffer, frameInfo.frameIndex);
-                simpleRenderSystem.renderGameObjects(frameInfo);
-                pointLightSystem.render(frameInfo);
-                viewportRenderer->endRenderPass(frameInfo.commandBuffer);
+                frameInfo.lightDescriptorSet = lightClusterSystem.getDescriptorSet(frameInfo.frameIndex);
+                frameInfo.shadowDescriptorSet = pointShadowSystem.getDescriptorSet(frameInfo.frameIndex);
+                frameInfo.viewportExtent = viewportRenderer->getExtent();
+
+                // Shadow faces that changed, sampled by the lit pass below
+                {
+                    GRAPE_PROFILE_SCOPE("Point Shadows");
+                    GpuZone gpuZone{ frameInfo.gpuProfiler, frameInfo.commandBuffer, static_cast<uint32_t>(frameInfo.frameIndex), "Point Shadows" };
+                    pointShadowSystem.render(frameInfo);
+                }
+
+                {
+                    GRAPE_PROFILE_SCOPE("Occlusion Pyramid");
+                    buildOcclusionPyramid(frameInfo, *viewportRenderer);
+                }
+
+                uint32_t drawCount;
+                {
+                    GRAPE_PROFILE_SCOPE("Prepare Draws");
+                    drawCount = simpleRenderSystem.prepareDraws(frameInfo, &depthPyramid);
+                }
+
+                GRAPE_PROFILE_SCOPE("Record Viewport");
+                {
+                    // The statistics query has to be active before any secondary is begun, they inherit it.
+                    // Destroyed in reverse, so if recording throws the pass is closed before the query
+                    // and the zone are ended outside it, and the command buffer can still be submitted
+                    uint32_t frameIndex = static_cast<uint32_t>(frameInfo.frameIndex);
+                    GpuZone gpuZone{ frameInfo.gpuProfiler, frameInfo.commandBuffer, frameIndex, "Viewport" };
+                    GpuStatisticsScope statistics{ frameInfo.gpuProfiler, frameInfo.commandBuffer, frameIndex };
+                    ViewportPassGuard passGuard{ *viewportRenderer, frameInfo.commandBuffer };
+
+                    if (drawCount < PARALLEL_RECORD_THRESHOLD) {
+                        viewportRenderer->beginRenderPass(frameInfo.commandBuffer, frameInfo.frameIndex);
+                        if (simpleRenderSystem.usesDepthPrepass()) {
+                            simpleRenderSystem.recordDepthPrepass(frameInfo, 0, drawCount);
+                        }
+                        simpleRenderSystem.recordDraws(frameInfo, 0, drawCount);
+                        pointLightSystem.render(frameInfo);
+                        viewportRenderer->endRenderPass(frameInfo.commandBuffer);
+                    }
+                    else {
+                        recordParallel(frameInfo, *viewportRenderer, drawCount);
+                    }
+                }
+
+                // Depth for the next time this frame slot comes around
+                readbackRecorded[frameInfo.frameIndex] = DebugSettings::getInstance().occlusionCulling;
+                if (readbackRecorded[frameInfo.frameIndex]) {
+                    viewportRenderer->recordDepthReadback(frameInfo.commandBuffer, frameInfo.frameIndex);
+                    readbackViewProj[frameInfo.frameIndex] = frameInfo.camera.getProjection() * frameInfo.camera.getView();
+                }
             }
             catch (const std::exception& e) {
+                // The guards above have left the command buffer submittable, just without this frame's
+                // viewport. No depth copy was recorded for the slot either
+                readbackRecorded[frameInfo.frameIndex] = false;
                 std::cerr << "Error during viewport rendering: " << e.what() << std::endl;
             }
         }
     }
 
-    void RenderManager::updateLights(FrameInfo& frameInfo, GlobalUbo& ubo) {
-        pointLightSystem.update(frameInfo, ubo);
+    void RenderManager::recordParallel(FrameInfo& frameInfo, ViewportRenderer& viewportRenderer, uint32_t drawCount) {
+        auto& jobs = JobSystem::getInstance();
+        uint32_t threadCount = commandPools.getThreadCount();
+
+        // Roughly one chunk per thread, stealing evens out the rest
+        uint32_t grain = std::max(MIN_DRAWS_PER_SECONDARY, (drawCount + threadCount - 1) / threadCount);
+        uint32_t chunkCount = (drawCount + grain - 1) / grain;
+
+        // Layout: [pre-pass chunks][lit chunks][light billboards]. Every pre-pass chunk has to run
+        // before any lit chunk (EQUAL depth test), so each chunk records one buffer per pass
+        bool prepass = simpleRenderSystem.usesDepthPrepass();
+        uint32_t litBase = prepass ? chunkCount : 0;
+        secondaries.assign(litBase + chunkCount + 1, VK_NULL_HANDLE);
+
+        jobs.parallelFor(drawCount, grain, [&](size_t begin, size_t end) {
+            GRAPE_PROFILE_SCOPE("Record Chunk");
+            GRAPE_MEMORY_SCOPE(MemoryTag::Renderer);
+            uint32_t chunk = static_cast<uint32_t>(begin / grain);
+            FrameInfo chunkInfo = frameInfo;
+
+            if (prepass) {
+                chunkInfo.commandBuffer = beginSecondary(frameInfo, viewportRenderer);
+                simpleRenderSystem.recordDepthPrepass(chunkInfo, static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+                if (vkEndCommandBuffer(chunkInfo.commandBuffer) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to record secondary command buffer!");
+                }
+                secondaries[chunk] = chunkInfo.commandBuffer;
+            }
+
+            chunkInfo.commandBuffer = beginSecondary(frameInfo, viewportRenderer);
+            simpleRenderSystem.recordDraws(chunkInfo, static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+            if (vkEndCommandBuffer(chunkInfo.commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to record secondary command buffer!");
+            }
+            secondaries[litBase + chunk] = chunkInfo.commandBuffer;
+        });
+
+        VkCommandBuffer lightSecondary = beginSecondary(frameInfo, viewportRenderer);
+        FrameInfo lightInfo = frameInfo;
+        lightInfo.commandBuffer = lightSecondary;
+        pointLightSystem.render(lightInfo);
+        if (vkEndCommandBuffer(lightSecondary) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record secondary command buffer!");
+        }
+        secondaries.back() = lightSecondary;
+
+        // Executed in submission order, so draw order is the same as the inline path
+        viewportRenderer.beginRenderPass(frameInfo.commandBuffer, frameInfo.frameIndex, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        vkCmdExecuteCommands(frameInfo.commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+        viewportRenderer.endRenderPass(frameInfo.commandBuffer);
+    }
+
+    VkCommandBuffer RenderManager::beginSecondary(FrameInfo& frameInfo, ViewportRenderer& viewportRenderer) {
+        VkCommandBuffer secondary = commandPools.acquireSecondary(frameInfo.frameIndex, commandPools.getCurrentThreadSlot());
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = viewportRenderer.getRenderPass();
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = viewportRenderer.getFramebuffer(frameInfo.frameIndex);
+        if (frameInfo.gpuProfiler) {
+            inheritanceInfo.pipelineStatistics = frameInfo.gpuProfiler->getInheritedStatistics(frameInfo.frameIndex);
+        }
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+        if (vkBeginCommandBuffer(secondary, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin secondary command buffer!");
+        }
+
+        viewportRenderer.setViewportAndScissor(secondary);
+        return secondary;
+    }
+
+    void RenderManager::buildOcclusionPyramid(FrameInfo& frameInfo, ViewportRenderer& viewportRenderer) {
+        depthPyramid.clear();
+        if (!DebugSettings::getInstance().occlusionCulling || !readbackRecorded[frameInfo.frameIndex]) return;
+
+        // The frame's fence has been waited on, so the copy recorded last time is complete
+        const float* depth = viewportRenderer.getDepthReadback(frameInfo.frameIndex);
+        if (depth == nullptr) return;
+
+        VkExtent2D extent = viewportRenderer.getExtent();
+        depthPyramid.build(depth, extent.width, extent.height, readbackViewProj[frameInfo.frameIndex]);
+    }
+
+    void RenderManager::updateLights(FrameInfo& frameInfo) {
+        GRAPE_PROFILE_FUNCTION();
+        pointLightSystem.update(frameInfo, frameLights);
+        pointShadowSystem.assignLights(frameInfo, frameLights);
+        lightClusterSystem.update(frameInfo, frameLights);
     }
-}
\ No newline at end of file
+}
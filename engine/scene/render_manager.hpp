@@ -1,26 +1,54 @@
 #pragma once
 #include "systems/simple_render_system.hpp"
 #include "systems/point_light_system.hpp"
+#include "systems/light_cluster_system.hpp"
+#include "systems/point_shadow_system.hpp"
 #include "renderer/viewport_renderer.hpp"
 #include "renderer/frame_info.hpp"
-#include "renderer/renderer.hpp"
+#include "renderer/thread_command_pools.hpp"
+#include "renderer/gpu_profiler.hpp"
+#include "renderer/swap_chain.hpp"
+#include "renderer/culling.hpp"
 
+#include <array>
 #include <memory>
+#include <vector>
 #include <vulkan/vulkan.h>
 
 namespace grape {
     class RenderManager {
     public:
-        RenderManager(Device& device, Renderer& renderer, VkDescriptorSetLayout globalSetLayout);
+        // renderPass only has to be compatible with the viewport's, pipelines are built against it
+        RenderManager(Device& device, VkRenderPass renderPass, ThreadCommandPools& commandPools, VkDescriptorSetLayout globalSetLayout);
         ~RenderManager() = default;
 
         void render(FrameInfo& frameInfo, std::unique_ptr<ViewportRenderer>& viewportRenderer, bool needsViewportResize);
-        void updateLights(FrameInfo& frameInfo, GlobalUbo& ubo);
+        void updateLights(FrameInfo& frameInfo);
+
+        // Below this many draws recording inline beats the cost of farming it out
+        static constexpr uint32_t PARALLEL_RECORD_THRESHOLD = 256;
+        static constexpr uint32_t MIN_DRAWS_PER_SECONDARY = 128;
 
     private:
+        void recordParallel(FrameInfo& frameInfo, ViewportRenderer& viewportRenderer, uint32_t drawCount);
+        VkCommandBuffer beginSecondary(FrameInfo& frameInfo, ViewportRenderer& viewportRenderer);
+        void buildOcclusionPyramid(FrameInfo& frameInfo, ViewportRenderer& viewportRenderer);
+
+        // Declared first, the simple render pipeline needs their set layouts
+        LightClusterSystem lightClusterSystem;
+        PointShadowSystem pointShadowSystem;
         SimpleRenderSystem simpleRenderSystem;
         PointLightSystem pointLightSystem;
         Device& device;
-        Renderer& renderer;
+        ThreadCommandPools& commandPools;
+
+        std::vector<VkCommandBuffer> secondaries;
+        std::vector<PointLight> frameLights;
+
+        // Occlusion culling tests against depth copied out the last time this frame slot ran,
+        // together with the camera it was rendered from
+        DepthPyramid depthPyramid;
+        std::array<glm::mat4, SwapChain::MAX_FRAMES_IN_FLIGHT> readbackViewProj{};
+        std::array<bool, SwapChain::MAX_FRAMES_IN_FLIGHT> readbackRecorded{};
     };
-}
\ No newline at end of file
+}
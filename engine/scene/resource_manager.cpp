@@ -17,7 +17,7 @@ namespace grape {
         globalPool = DescriptorPool::Builder(device)
             .setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT * 2)
             .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
-            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SwapChain::MAX_FRAMES_IN_FLIGHT * 64)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SwapChain::MAX_FRAMES_IN_FLIGHT * MAX_TEXTURES)
             .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
             .build();
 
@@ -51,7 +51,7 @@ namespace grape {
                 VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
                 VK_SHADER_STAGE_FRAGMENT_BIT,
                 VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT_EXT,
-                64)
+                MAX_TEXTURES)
             .build();
     }
 
@@ -87,8 +87,7 @@ namespace grape {
 
         for (int i = 0; i < globalDescriptorSets.size(); i++) {
             auto bufferInfo = uboBuffers[i]->descriptorInfo();
-            const int MAX_TEXTURES_IN_SET = 20;
-            std::vector<VkDescriptorImageInfo> descriptorInfos(MAX_TEXTURES_IN_SET);
+            std::vector<VkDescriptorImageInfo> descriptorInfos(MAX_TEXTURES);
 
             // Setup fallback texture at index 0
             descriptorInfos[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -96,14 +95,14 @@ namespace grape {
             descriptorInfos[0].imageView = fallbackTexture->getTextureImageView();
 
             // Setup actual textures
-            for (uint32_t j = 1; j < MAX_TEXTURES_IN_SET; j++) {
+            for (uint32_t j = 1; j < MAX_TEXTURES; j++) {
                 const Texture* texture = loader.getTextureAtIndex(j);
                 descriptorInfos[j].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
                 descriptorInfos[j].sampler = texture->getTextureSampler();
                 descriptorInfos[j].imageView = texture->getTextureImageView();
             }
 
-            uint32_t textureCount = static_cast<uint32_t>(std::min(static_cast<size_t>(MAX_TEXTURES_IN_SET), orderedTexturePaths.size() + 1));
+            uint32_t textureCount = static_cast<uint32_t>(std::min(static_cast<size_t>(MAX_TEXTURES), orderedTexturePaths.size() + 1));
 
             DescriptorWriter writer(*globalSetLayout, *globalPool);
             if (!writer.writeBuffer(0, &bufferInfo)
@@ -15,6 +15,9 @@ namespace grape {
 
     class ResourceManager {
     public:
+        // Size of the bindless texture array in set 0, slot 0 is the fallback
+        static constexpr uint32_t MAX_TEXTURES = 64;
+
         ResourceManager(Device& device);
         ~ResourceManager() = default;
 
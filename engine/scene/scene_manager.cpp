@@ -1,4 +1,6 @@
 #include "scene_manager.hpp"
+#include "core/profiler.hpp"
+#include "core/memory_tracker.hpp"
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include "systems/simple_render_system.hpp"
@@ -8,53 +10,64 @@ namespace grape {
         : device(device), physics(physics) {
     }
 
-    void SceneManager::loadScene() {
-        loader.loadGameObjects(device, physics, gameObjects);
+    SceneManager::~SceneManager() {
+        stopSimulation();
     }
 
-    void SceneManager::updateScene(float frameTime, GLFWwindow* window) {
-        updatePhysics(frameTime);
-        handleKinematicMovement(frameTime, window);
-    }
-
-    void SceneManager::updatePhysics(float frameTime) {
+    StartupTaskId SceneManager::addLoadTasks(StartupGraph& graph, const std::vector<StartupTaskId>& assetsAfter,
+        const std::vector<StartupTaskId>& sceneAfter) {
+        StartupTaskId sceneLoaded;
+        const auto& stressSettings = StressSceneSettings::getInstance();
+        if (stressSettings.enabled) {
+            // Generated meshes and flat textures, one task is plenty
+            std::vector<StartupTaskId> dependencies = assetsAfter;
+            dependencies.insert(dependencies.end(), sceneAfter.begin(), sceneAfter.end());
+            sceneLoaded = graph.add("Stress Scene", [this, &stressSettings]() {
+                GRAPE_MEMORY_SCOPE(MemoryTag::Scene);
+                loader.loadStressScene(device, physics, gameObjects, stressSettings);
+            }, dependencies);
+        }
+        else {
+            sceneLoaded = loader.addLoadTasks(graph, device, physics, gameObjects, assetsAfter, sceneAfter);
+        }
 
-        const auto& debugSettings = DebugSettings::getInstance();
-        static bool lastPhysicsDebugState = false;
+        return graph.add("Start Simulation", [this]() {
+            GRAPE_MEMORY_SCOPE(MemoryTag::Scene);
+            simulation = std::make_unique<SimulationThread>(physics, gameObjects);
+            if (!deterministic) {
+                simulation->start();
+            }
+        }, { sceneLoaded });
+    }
 
-        if (debugSettings.showPhysicsDebug != lastPhysicsDebugState) {
-            // Physics debug toggle changed
-            physics.setDebugVisualization(debugSettings.showPhysicsDebug);
-            lastPhysicsDebugState = debugSettings.showPhysicsDebug;
+    void SceneManager::stopSimulation() {
+        if (simulation) {
+            simulation->stop();
         }
+    }
 
-        physics.StepPhysics(frameTime);
+    void SceneManager::updateScene(const FrameInput& input) {
+        GRAPE_PROFILE_FUNCTION();
+        GRAPE_MEMORY_SCOPE(MemoryTag::Scene);
+        if (!simulation) return;
 
-        for (auto& kv : gameObjects) {
-            auto& obj = kv.second;
-            if (obj.hasPhysics()) {
-                obj.updatePhysics();
-            }
+        // Physics runs at a fixed rate on the simulation thread, or here in lockstep when deterministic
+        simulation->setInput(sampleSimulationInput(input));
+        if (deterministic) {
+            simulation->advance(input.frameTime);
         }
+        simulation->interpolate(gameObjects);
     }
 
-    void SceneManager::handleKinematicMovement(float frameTime, GLFWwindow* window) {
-        for (auto& kv : gameObjects) {
-            auto& obj = kv.second;
-            if (obj.hasPhysics() && obj.physicsComponent->isKinematic) {
-                glm::vec3 movement(0.f);
-                if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS) movement.z -= 1.f;
-                if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS) movement.z += 1.f;
-                if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS) movement.x -= 1.f;
-                if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS) movement.x += 1.f;
-
-                if (glm::length(movement) > 0.f) {
-                    movement = glm::normalize(movement) * frameTime * 3.f;
-                    glm::vec3 newPos = obj.transform.translation + movement;
-                    obj.setPhysicsTransform(newPos);
-                }
-                break;
-            }
-        }
+    SimulationInput SceneManager::sampleSimulationInput(const FrameInput& frameInput) const {
+        SimulationInput input{};
+        input.physicsDebug = DebugSettings::getInstance().showPhysicsDebug;
+
+        if (frameInput.isKeyDown(GLFW_KEY_I)) input.kinematicMove.z -= 1.f;
+        if (frameInput.isKeyDown(GLFW_KEY_K)) input.kinematicMove.z += 1.f;
+        if (frameInput.isKeyDown(GLFW_KEY_J)) input.kinematicMove.x -= 1.f;
+        if (frameInput.isKeyDown(GLFW_KEY_L)) input.kinematicMove.x += 1.f;
+
+        return input;
     }
 }
\ No newline at end of file
@@ -2,6 +2,9 @@
 #include "game_object.hpp"
 #include "systems/physics.hpp"
 #include "game_object_loader.hpp"
+#include "simulation_thread.hpp"
+#include "core/frame_input.hpp"
+#include "core/startup_graph.hpp"
 #include <unordered_map>
 #include <memory>
 
@@ -9,23 +12,35 @@ namespace grape {
     class SceneManager {
     public:
         SceneManager(Device& device, Physics& physics);
-        ~SceneManager() = default;
+        ~SceneManager();
 
-        void loadScene();
-        void updateScene(float frameTime, GLFWwindow* window);
+        // Loads the scene as startup tasks (see GameObjectLoader::addLoadTasks), the last one starts
+        // the fixed-timestep simulation thread and is returned. Assets load after assetsAfter, the
+        // game objects get built after sceneAfter (physics init)
+        StartupTaskId addLoadTasks(StartupGraph& graph, const std::vector<StartupTaskId>& assetsAfter,
+            const std::vector<StartupTaskId>& sceneAfter);
+        // Render thread side: hands input to the simulation and applies the interpolated snapshot
+        void updateScene(const FrameInput& input);
+        // Before the load tasks run. Steps the simulation from the frame times on the render thread
+        // instead of in real time on its own, so recorded input replays to the same scene
+        void setDeterministic(bool enabled) { deterministic = enabled; }
+        void stopSimulation();
 
         std::unordered_map<GameObject::id_t, GameObject>& getGameObjects() { return gameObjects; }
         const std::unordered_map<GameObject::id_t, GameObject>& getGameObjects() const { return gameObjects; }
         const GameObjectLoader& getLoader() { return loader; }
+        // Null until the load tasks have run
+        SimulationThread* getSimulation() { return simulation.get(); }
 
 
     private:
-        void updatePhysics(float frameTime);
-        void handleKinematicMovement(float frameTime, GLFWwindow* window);
+        SimulationInput sampleSimulationInput(const FrameInput& frameInput) const;
 
         std::unordered_map<GameObject::id_t, GameObject> gameObjects;
         GameObjectLoader loader;
         Physics& physics;
         Device& device;
+        std::unique_ptr<SimulationThread> simulation;
+        bool deterministic = false;
     };
 }
\ No newline at end of file
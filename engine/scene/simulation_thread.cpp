@@ -0,0 +1,230 @@
+#include "simulation_thread.hpp"
+#include "core/profiler.hpp"
+#include "core/memory_tracker.hpp"
+#include "core/perf_counters.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace grape {
+
+    SimulationThread::SimulationThread(Physics& physics, GameObject::Map& gameObjects) : physics(physics) {
+        // Only the simulation thread touches PhysX once started, so grab everything it needs up front
+        for (auto& kv : gameObjects) {
+            auto& obj = kv.second;
+            if (obj.hasPhysics() && obj.physicsComponent->actor) {
+                bodies.push_back({ kv.first, obj.physicsComponent->actor, obj.physicsComponent->isKinematic, obj.transform });
+            }
+        }
+
+        // Seed both visible snapshots so interpolation is a no-op until the first tick lands
+        for (auto& snapshot : snapshots) {
+            snapshot.entries.reserve(bodies.size());
+            for (const auto& body : bodies) {
+                snapshot.entries.push_back({ body.id, body.transform.translation, body.transform.rotation });
+            }
+            snapshot.publishTime = std::chrono::steady_clock::now();
+        }
+    }
+
+    SimulationThread::~SimulationThread() {
+        stop();
+    }
+
+    void SimulationThread::start() {
+        if (running) return;
+        running = true;
+        thread = std::thread(&SimulationThread::run, this);
+    }
+
+    void SimulationThread::stop() {
+        running = false;
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    void SimulationThread::setInput(const SimulationInput& newInput) {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        input = newInput;
+    }
+
+    void SimulationThread::queueEdit(const PhysicsEdit& edit) {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        pendingEdits.push_back(edit);
+    }
+
+    void SimulationThread::advance(float frameTime) {
+        lockstep = true;
+        accumulator += frameTime;
+
+        int ticks = 0;
+        while (accumulator >= FIXED_TIMESTEP && ticks < MAX_CATCH_UP_TICKS) {
+            tick();
+            accumulator -= FIXED_TIMESTEP;
+            ticks++;
+        }
+
+        // Same backlog drop as run()
+        if (accumulator >= FIXED_TIMESTEP) {
+            accumulator = std::fmod(accumulator, FIXED_TIMESTEP);
+        }
+    }
+
+    void SimulationThread::run() {
+        GRAPE_PROFILE_THREAD("Simulation");
+        using clock = std::chrono::steady_clock;
+        const auto tickPeriod = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(FIXED_TIMESTEP));
+
+        auto nextTick = clock::now();
+        while (running) {
+            int ticksThisWakeup = 0;
+            while (clock::now() >= nextTick && ticksThisWakeup < MAX_CATCH_UP_TICKS) {
+                tick();
+                nextTick += tickPeriod;
+                ticksThisWakeup++;
+            }
+
+            // Too far behind (debugger, hitch), drop the backlog instead of fast-forwarding
+            if (clock::now() >= nextTick) {
+                nextTick = clock::now() + tickPeriod;
+            }
+
+            std::this_thread::sleep_until(nextTick);
+        }
+    }
+
+    void SimulationThread::tick() {
+        GRAPE_PROFILE_FUNCTION();
+        GRAPE_MEMORY_SCOPE(MemoryTag::Scene);
+        SimulationInput tickInput;
+        {
+            std::lock_guard<std::mutex> lock(inputMutex);
+            tickInput = input;
+            tickEdits.swap(pendingEdits);
+        }
+        applyEdits();
+
+        if (tickInput.physicsDebug != lastPhysicsDebug) {
+            physics.setDebugVisualization(tickInput.physicsDebug);
+            lastPhysicsDebug = tickInput.physicsDebug;
+        }
+
+        // Kinematic bodies are driven by input, same speed as before but with a fixed dt
+        if (glm::length(tickInput.kinematicMove) > 0.f) {
+            for (auto& body : bodies) {
+                if (!body.isKinematic) continue;
+
+                glm::vec3 movement = glm::normalize(tickInput.kinematicMove) * FIXED_TIMESTEP * 3.f;
+                body.transform.translation += movement;
+
+                // Same Y flip as TransformComponent::updateFromPhysX so the round trip is stable
+                PxTransform pose = body.actor->getGlobalPose();
+                const auto& t = body.transform.translation;
+                pose.p = PxVec3(t.x, -t.y, t.z);
+                body.actor->setGlobalPose(pose);
+                break;
+            }
+        }
+
+        physics.StepPhysics(FIXED_TIMESTEP);
+
+        int64_t dynamicBodies = 0;
+        int64_t awakeBodies = 0;
+        for (auto& body : bodies) {
+            body.transform.updateFromPhysX(body.actor);
+
+            if (body.isKinematic) continue;
+            if (auto* dynamic = body.actor->is<PxRigidDynamic>()) {
+                dynamicBodies++;
+                if (!dynamic->isSleeping()) awakeBodies++;
+            }
+        }
+        auto& perf = PerfCounters::getInstance();
+        perf.setGauge(PerfGauge::DynamicBodies, dynamicBodies);
+        perf.setGauge(PerfGauge::AwakeBodies, awakeBodies);
+
+        tickCount++;
+        publish();
+    }
+
+    void SimulationThread::applyEdits() {
+        for (const auto& edit : tickEdits) {
+            auto* dynamic = edit.actor ? edit.actor->is<PxRigidDynamic>() : nullptr;
+            switch (edit.type) {
+            case PhysicsEdit::Type::Mass:
+                if (dynamic) PxRigidBodyExt::updateMassAndInertia(*dynamic, edit.value.x);
+                break;
+            case PhysicsEdit::Type::Material: {
+                PxMaterial* materials[1];
+                if (edit.shape && edit.shape->getMaterials(materials, 1) == 1) {
+                    materials[0]->setStaticFriction(edit.value.x);
+                    materials[0]->setDynamicFriction(edit.value.y);
+                    materials[0]->setRestitution(edit.value.z);
+                }
+                break;
+            }
+            case PhysicsEdit::Type::Impulse:
+                if (dynamic) dynamic->addForce(PxVec3(edit.value.x, edit.value.y, edit.value.z), PxForceMode::eIMPULSE);
+                break;
+            case PhysicsEdit::Type::ResetVelocity:
+                if (dynamic) {
+                    dynamic->setLinearVelocity(PxVec3(0, 0, 0));
+                    dynamic->setAngularVelocity(PxVec3(0, 0, 0));
+                }
+                break;
+            case PhysicsEdit::Type::Pose: {
+                if (!edit.actor) break;
+                // Same Y flip as TransformComponent::updateFromPhysX, the snapshot reads it straight back
+                const auto& q = edit.rotation;
+                edit.actor->setGlobalPose(PxTransform(PxVec3(edit.value.x, -edit.value.y, edit.value.z), PxQuat(q.x, q.y, q.z, q.w)));
+                for (auto& body : bodies) {
+                    if (body.actor != edit.actor) continue;
+                    // Kinematic movement works from this, not the pose
+                    body.transform.translation = edit.value;
+                    body.transform.rotation = edit.rotation;
+                    break;
+                }
+                break;
+            }
+            }
+        }
+        tickEdits.clear();
+    }
+
+    void SimulationThread::publish() {
+        auto& back = snapshots[backIndex];
+        back.tick = tickCount;
+        back.entries.clear();
+        for (const auto& body : bodies) {
+            back.entries.push_back({ body.id, body.transform.translation, body.transform.rotation });
+        }
+
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        back.publishTime = std::chrono::steady_clock::now();
+        int oldPrevious = previousIndex;
+        previousIndex = latestIndex;
+        latestIndex = backIndex;
+        backIndex = oldPrevious;
+    }
+
+    void SimulationThread::interpolate(GameObject::Map& gameObjects) {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        const auto& previous = snapshots[previousIndex];
+        const auto& latest = snapshots[latestIndex];
+
+        // Render one tick behind the simulation: alpha goes 0 -> 1 over the tick after latest was published
+        float elapsed = lockstep ? accumulator
+            : std::chrono::duration<float>(std::chrono::steady_clock::now() - latest.publishTime).count();
+        float alpha = std::clamp(elapsed / FIXED_TIMESTEP, 0.f, 1.f);
+
+        for (size_t i = 0; i < latest.entries.size(); i++) {
+            auto it = gameObjects.find(latest.entries[i].id);
+            if (it == gameObjects.end()) continue;
+
+            auto& transform = it->second.transform;
+            transform.translation = glm::mix(previous.entries[i].translation, latest.entries[i].translation, alpha);
+            transform.rotation = glm::slerp(previous.entries[i].rotation, latest.entries[i].rotation, alpha);
+        }
+    }
+}
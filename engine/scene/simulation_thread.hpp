@@ -0,0 +1,112 @@
+#pragma once
+#include "game_object.hpp"
+#include "systems/physics.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace grape {
+
+    // Input sampled on the main thread (GLFW can only be polled there) and handed to the simulation
+    struct SimulationInput {
+        glm::vec3 kinematicMove{ 0.f };    // unnormalized direction, zero when no key is held
+        bool physicsDebug = false;
+    };
+
+    // Change to a PhysX object asked for on the main thread (the inspector), queued and applied
+    // at the start of the next tick
+    struct PhysicsEdit {
+        enum class Type { Mass, Material, Impulse, ResetVelocity, Pose };
+
+        Type type;
+        PxRigidActor* actor = nullptr;
+        PxShape* shape = nullptr;       // Material only
+        glm::vec3 value{ 0.f };         // Mass in x, static/dynamic friction and restitution, the impulse or the position
+        glm::quat rotation{ 1.f, 0.f, 0.f, 0.f };  // Pose only
+    };
+
+    // State of every physics-driven object at the end of one simulation tick
+    struct SceneSnapshot {
+        struct Entry {
+            GameObject::id_t id;
+            glm::vec3 translation;
+            glm::quat rotation;
+        };
+
+        uint64_t tick = 0;
+        std::chrono::steady_clock::time_point publishTime{};
+        std::vector<Entry> entries;
+    };
+
+    // Steps physics at a fixed rate on its own thread. Each tick is published as a snapshot,
+    // the render thread keeps the last two and interpolates between them, so rendering never
+    // touches PhysX and simulation cost overlaps with command recording
+    class SimulationThread {
+    public:
+        static constexpr float FIXED_TIMESTEP = 1.f / 60.f;
+        // Ticks simulated per wakeup before we give up catching up (avoids the spiral of death)
+        static constexpr int MAX_CATCH_UP_TICKS = 5;
+
+        SimulationThread(Physics& physics, GameObject::Map& gameObjects);
+        ~SimulationThread();
+
+        SimulationThread(const SimulationThread&) = delete;
+        SimulationThread& operator=(const SimulationThread&) = delete;
+
+        void start();
+        void stop();
+        bool isRunning() const { return running; }
+
+        // Main thread only
+        void setInput(const SimulationInput& newInput);
+        void queueEdit(const PhysicsEdit& edit);
+        void interpolate(GameObject::Map& gameObjects);
+        // Lockstep instead of start(): ticks on the calling thread for every FIXED_TIMESTEP of
+        // frame time fed in, so the result depends on the frame times alone (input replay)
+        void advance(float frameTime);
+
+        uint64_t getTickCount() const { return tickCount; }
+
+    private:
+        struct Body {
+            GameObject::id_t id;
+            PxRigidActor* actor;
+            bool isKinematic;
+            TransformComponent transform;
+        };
+
+        void run();
+        void tick();
+        void applyEdits();
+        void publish();
+
+        Physics& physics;
+        std::vector<Body> bodies;
+
+        std::thread thread;
+        std::atomic<bool> running{ false };
+        std::atomic<uint64_t> tickCount{ 0 };
+
+        bool lockstep = false;
+        float accumulator = 0.f;    // Lockstep frame time not simulated yet
+
+        std::mutex inputMutex;
+        SimulationInput input{};
+        std::vector<PhysicsEdit> pendingEdits;  // Under inputMutex
+        std::vector<PhysicsEdit> tickEdits;
+        bool lastPhysicsDebug = false;
+
+        // previous/latest are what the render thread reads, back is written by the simulation
+        // and rotated in on publish
+        std::mutex snapshotMutex;
+        std::array<SceneSnapshot, 3> snapshots;
+        int previousIndex = 0;
+        int latestIndex = 1;
+        int backIndex = 2;
+    };
+}
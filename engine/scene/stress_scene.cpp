@@ -0,0 +1,172 @@
+#include "stress_scene.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+namespace grape {
+
+    namespace {
+        struct MeshData {
+            std::vector<Model::Vertex> vertices;
+            std::vector<uint32_t> indices;
+        };
+
+        // Shapes are written Y up like an OBJ and stored the way loadModel stores one, Y mirrored
+        // with the normals left alone, so they light and cull exactly like loaded models
+        uint32_t addVertex(MeshData& mesh, const glm::vec3& position, const glm::vec3& normal, const glm::vec2& uv) {
+            Model::Vertex vertex{};
+            vertex.position = { position.x, -position.y, position.z };
+            vertex.color = glm::vec3(1.f);
+            vertex.normal = normal;
+            vertex.uv = uv;
+            mesh.vertices.push_back(vertex);
+            return static_cast<uint32_t>(mesh.vertices.size() - 1);
+        }
+
+        // Winds the triangle counter-clockwise around its vertex normals (OBJ order) and drops it
+        // when it has no area, like the ones at a sphere's poles
+        void addTriangle(MeshData& mesh, uint32_t a, uint32_t b, uint32_t c) {
+            auto objPosition = [&](uint32_t index) {
+                const glm::vec3& p = mesh.vertices[index].position;
+                return glm::vec3(p.x, -p.y, p.z);
+            };
+            glm::vec3 faceNormal = glm::cross(objPosition(b) - objPosition(a), objPosition(c) - objPosition(a));
+            if (glm::dot(faceNormal, faceNormal) < 1e-12f) return;
+
+            glm::vec3 vertexNormal = mesh.vertices[a].normal + mesh.vertices[b].normal + mesh.vertices[c].normal;
+            if (glm::dot(faceNormal, vertexNormal) < 0.f) std::swap(b, c);
+
+            mesh.indices.push_back(a);
+            mesh.indices.push_back(b);
+            mesh.indices.push_back(c);
+        }
+
+        // (columns + 1) x (rows + 1) vertices from surface(u, v, position, normal), two triangles a cell
+        void addGrid(MeshData& mesh, uint32_t columns, uint32_t rows,
+            const std::function<void(float, float, glm::vec3&, glm::vec3&)>& surface) {
+            const uint32_t base = static_cast<uint32_t>(mesh.vertices.size());
+            for (uint32_t row = 0; row <= rows; row++) {
+                for (uint32_t column = 0; column <= columns; column++) {
+                    float u = static_cast<float>(column) / columns;
+                    float v = static_cast<float>(row) / rows;
+                    glm::vec3 position, normal;
+                    surface(u, v, position, normal);
+                    addVertex(mesh, position, normal, { u, v });
+                }
+            }
+            for (uint32_t row = 0; row < rows; row++) {
+                for (uint32_t column = 0; column < columns; column++) {
+                    uint32_t a = base + row * (columns + 1) + column;
+                    uint32_t b = a + columns + 1;
+                    addTriangle(mesh, a, b, a + 1);
+                    addTriangle(mesh, a + 1, b, b + 1);
+                }
+            }
+        }
+
+        void buildBox(MeshData& mesh, uint32_t detail) {
+            for (int axis = 0; axis < 3; axis++) {
+                for (float side : { -1.f, 1.f }) {
+                    glm::vec3 normal{ 0.f };
+                    normal[axis] = side;
+                    const int uAxis = (axis + 1) % 3;
+                    const int vAxis = (axis + 2) % 3;
+                    addGrid(mesh, detail, detail, [&](float u, float v, glm::vec3& position, glm::vec3& outNormal) {
+                        position[axis] = side * 0.5f;
+                        position[uAxis] = u - 0.5f;
+                        position[vAxis] = v - 0.5f;
+                        outNormal = normal;
+                    });
+                }
+            }
+        }
+
+        void buildSphere(MeshData& mesh, uint32_t detail) {
+            const float pi = glm::pi<float>();
+            addGrid(mesh, detail * 2, detail, [&](float u, float v, glm::vec3& position, glm::vec3& normal) {
+                float theta = 2.f * pi * u;
+                float phi = pi * v;
+                normal = { std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta) };
+                position = normal * 0.5f;
+            });
+        }
+
+        void buildCylinder(MeshData& mesh, uint32_t detail) {
+            const float pi = glm::pi<float>();
+            const uint32_t segments = detail * 2;
+            addGrid(mesh, segments, std::max(detail / 4, 1u), [&](float u, float v, glm::vec3& position, glm::vec3& normal) {
+                float theta = 2.f * pi * u;
+                normal = { std::cos(theta), 0.f, std::sin(theta) };
+                position = { normal.x * 0.5f, v - 0.5f, normal.z * 0.5f };
+            });
+
+            // Caps as fans with their own flat normals
+            for (float side : { -1.f, 1.f }) {
+                glm::vec3 normal{ 0.f, side, 0.f };
+                uint32_t center = addVertex(mesh, { 0.f, side * 0.5f, 0.f }, normal, { 0.5f, 0.5f });
+                uint32_t first = static_cast<uint32_t>(mesh.vertices.size());
+                for (uint32_t segment = 0; segment <= segments; segment++) {
+                    float theta = 2.f * pi * segment / segments;
+                    glm::vec2 circle{ std::cos(theta), std::sin(theta) };
+                    addVertex(mesh, { circle.x * 0.5f, side * 0.5f, circle.y * 0.5f }, normal, circle * 0.5f + 0.5f);
+                }
+                for (uint32_t segment = 0; segment < segments; segment++) {
+                    addTriangle(mesh, center, first + segment, first + segment + 1);
+                }
+            }
+        }
+
+        void buildTorus(MeshData& mesh, uint32_t detail) {
+            const float pi = glm::pi<float>();
+            const float majorRadius = 0.35f;
+            const float minorRadius = 0.15f;
+            addGrid(mesh, detail * 2, detail, [&](float u, float v, glm::vec3& position, glm::vec3& normal) {
+                float theta = 2.f * pi * u;
+                float phi = 2.f * pi * v;
+                glm::vec3 ring{ std::cos(theta), 0.f, std::sin(theta) };
+                normal = ring * std::cos(phi) + glm::vec3(0.f, std::sin(phi), 0.f);
+                position = ring * majorRadius + normal * minorRadius;
+            });
+        }
+    }
+
+    std::string stressTexturePath(uint32_t index) {
+        return "stress/texture_" + std::to_string(index);
+    }
+
+    glm::vec4 stressTextureColor(uint32_t index) {
+        // Golden ratio steps around the hue wheel keep neighbouring indices apart
+        float hue = std::fmod(index * 0.618034f, 1.f) * 6.f;
+        float x = 1.f - std::abs(std::fmod(hue, 2.f) - 1.f);
+        glm::vec3 rgb = hue < 1.f ? glm::vec3(1.f, x, 0.f)
+            : hue < 2.f ? glm::vec3(x, 1.f, 0.f)
+            : hue < 3.f ? glm::vec3(0.f, 1.f, x)
+            : hue < 4.f ? glm::vec3(0.f, x, 1.f)
+            : hue < 5.f ? glm::vec3(x, 0.f, 1.f)
+            : glm::vec3(1.f, 0.f, x);
+        return glm::vec4(0.25f + rgb * 0.75f, 1.f);
+    }
+
+    std::shared_ptr<Model> createStressMesh(Device& device, uint32_t variant, const std::string& texturePath) {
+        GRAPE_MEMORY_SCOPE(MemoryTag::Assets);
+        const uint32_t detail = 8 * (1 + variant / 4);
+
+        MeshData mesh;
+        switch (variant % 4) {
+        case 0: buildBox(mesh, detail / 4); break;
+        case 1: buildSphere(mesh, detail); break;
+        case 2: buildCylinder(mesh, detail); break;
+        default: buildTorus(mesh, detail); break;
+        }
+
+        Model::Builder builder;
+        builder.texturePaths.push_back(texturePath);
+        builder.materialIdToTexturePath[0] = texturePath;
+        builder.addSubmesh(device, mesh.vertices, mesh.indices, 0);
+        return std::make_shared<Model>(device, builder);
+    }
+}
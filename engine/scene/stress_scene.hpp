@@ -0,0 +1,36 @@
+#pragma once
+#include "renderer/model.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace grape {
+
+    // Procedural scene for scaling tests, loaded instead of the hand placed one when enabled
+    // (--stress on the command line). The same seed and counts always give the same scene
+    struct StressSceneSettings {
+        bool enabled = false;
+        uint32_t instances = 10000;     // Mesh instances on a grid, dynamic bodies included
+        uint32_t uniqueMeshes = 16;     // Distinct models (own GPU buffers) the instances cycle through
+        uint32_t textures = 16;         // Solid color textures, model m uses texture m % textures
+        uint32_t pointLights = 64;
+        uint32_t dynamicBodies = 256;   // Instances dropped in as dynamic boxes instead of static props
+        uint32_t seed = 1;
+        float spacing = 3.f;            // Grid cell size
+
+        static StressSceneSettings& getInstance() {
+            static StressSceneSettings instance;
+            return instance;
+        }
+    };
+
+    // Texture path the stress scene registers for texture index, there's no file behind it
+    std::string stressTexturePath(uint32_t index);
+    glm::vec4 stressTextureColor(uint32_t index);
+
+    // One of the procedural meshes, each fitting a unit cube around the origin. variant % 4
+    // picks box, sphere, cylinder or torus, variant / 4 the tessellation, so later variants get
+    // dense enough for meshlets and LODs
+    std::shared_ptr<Model> createStressMesh(Device& device, uint32_t variant, const std::string& texturePath);
+}
@@ -3,28 +3,29 @@
 #include <iostream>
 
 namespace grape {
-    void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, GameObject& gameObject) {
+    void KeyboardMovementController::moveInPlaneXZ(const FrameInput& input, float dt, GameObject& gameObject) {
         glm::vec3 rotate{ 0 };
 
         // Keyboard rotation
-        if (glfwGetKey(window, keys.lookRight) == GLFW_PRESS) rotate.y += 1.f;
-        if (glfwGetKey(window, keys.lookLeft) == GLFW_PRESS) rotate.y -= 1.f;
-        if (glfwGetKey(window, keys.lookUp) == GLFW_PRESS) rotate.x += 1.f;
-        if (glfwGetKey(window, keys.lookDown) == GLFW_PRESS) rotate.x -= 1.f;
+        if (input.isKeyDown(keys.lookRight)) rotate.y += 1.f;
+        if (input.isKeyDown(keys.lookLeft)) rotate.y -= 1.f;
+        if (input.isKeyDown(keys.lookUp)) rotate.x += 1.f;
+        if (input.isKeyDown(keys.lookDown)) rotate.x -= 1.f;
 
         // Increase this value to make arrow key rotation faster
         float keyboardLookSpeed = 100.f; // Adjust this value
         rotate *= keyboardLookSpeed;
 
         // Mouse rotation
-        if (glfwGetMouseButton(window, keys.rotateCamera) == GLFW_PRESS) {
+        if (input.isMouseButtonDown(keys.rotateCamera)) {
             if (!canRotate) {
-                glfwGetCursorPos(window, &lastXpos, &lastYpos);
+                lastXpos = input.cursorX;
+                lastYpos = input.cursorY;
             }
             canRotate = true;
 
-            double xpos, ypos;
-            glfwGetCursorPos(window, &xpos, &ypos);
+            double xpos = input.cursorX;
+            double ypos = input.cursorY;
 
             rotate.y -= static_cast<float>(xpos - lastXpos) * lookSpeed;
             rotate.x += static_cast<float>(ypos - lastYpos) * lookSpeed;
@@ -47,12 +48,12 @@ namespace grape {
         const glm::vec3 fowardDir = gameObject.transform.rotation * glm::vec3(0.0f, 0.0f, 1.0f);
 
         glm::vec3 moveDir{ 0.f };
-        if (glfwGetKey(window, keys.moveForward) == GLFW_PRESS) moveDir += fowardDir;
-        if (glfwGetKey(window, keys.moveBackward) == GLFW_PRESS) moveDir -= fowardDir;
-        if (glfwGetKey(window, keys.moveRight) == GLFW_PRESS) moveDir += rightDir;
-        if (glfwGetKey(window, keys.moveLeft) == GLFW_PRESS) moveDir -= rightDir;
-        if (glfwGetKey(window, keys.moveUp) == GLFW_PRESS) moveDir += upDir;
-        if (glfwGetKey(window, keys.moveDown) == GLFW_PRESS) moveDir -= upDir;
+        if (input.isKeyDown(keys.moveForward)) moveDir += fowardDir;
+        if (input.isKeyDown(keys.moveBackward)) moveDir -= fowardDir;
+        if (input.isKeyDown(keys.moveRight)) moveDir += rightDir;
+        if (input.isKeyDown(keys.moveLeft)) moveDir -= rightDir;
+        if (input.isKeyDown(keys.moveUp)) moveDir += upDir;
+        if (input.isKeyDown(keys.moveDown)) moveDir -= upDir;
 
         if (glm::dot(moveDir, moveDir) > std::numeric_limits<float>::epsilon()) {
             gameObject.transform.translation += moveSpeed * dt * glm::normalize(moveDir);
@@ -2,7 +2,7 @@
 
 #include "scene/game_object.hpp"
 
-#include "core/window.hpp"
+#include "core/frame_input.hpp"
 
 namespace grape {
 	class KeyboardMovementController {
@@ -23,7 +23,8 @@ namespace grape {
             int rotateCamera = GLFW_MOUSE_BUTTON_2;
         };
 
-        void moveInPlaneXZ(GLFWwindow* window, float dt, GameObject &gameObject);
+        // Only keys in FrameInput::TRACKED_KEYS can be mapped
+        void moveInPlaneXZ(const FrameInput& input, float dt, GameObject &gameObject);
 
         KeyMappings keys{};
         float moveSpeed{ 3.f };
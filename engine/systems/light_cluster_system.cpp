@@ -0,0 +1,291 @@
+#include "light_cluster_system.hpp"
+#include "renderer/swap_chain.hpp"
+#include "core/job_system.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace grape {
+
+    static_assert(sizeof(ClusterInfo) == sizeof(PointLight), "ClusterInfo takes the first slot of the light buffer");
+
+    LightClusterSystem::LightClusterSystem(Device& device) : device{ device } {
+        createBuffers();
+        clusterBounds.resize(CLUSTER_COUNT);
+    }
+
+    void LightClusterSystem::createBuffers() {
+        lightPool = DescriptorPool::Builder(device)
+            .setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT * 3)
+            .build();
+
+        lightSetLayout = DescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .build();
+
+        lightBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        clusterBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        indexBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        lightDescriptorSets.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+        for (int i = 0; i < lightDescriptorSets.size(); i++) {
+            // Slot 0 holds the ClusterInfo header, lights follow
+            lightBuffers[i] = std::make_unique<Buffer>(
+                device, sizeof(PointLight), MAX_POINT_LIGHTS + 1,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+            clusterBuffers[i] = std::make_unique<Buffer>(
+                device, sizeof(ClusterRange), CLUSTER_COUNT,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+            indexBuffers[i] = std::make_unique<Buffer>(
+                device, sizeof(uint32_t), MAX_LIGHT_INDICES,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+
+            lightBuffers[i]->map();
+            clusterBuffers[i]->map();
+            indexBuffers[i]->map();
+
+            auto lightInfo = lightBuffers[i]->descriptorInfo();
+            auto clusterInfo = clusterBuffers[i]->descriptorInfo();
+            auto indexInfo = indexBuffers[i]->descriptorInfo();
+            if (!DescriptorWriter(*lightSetLayout, *lightPool)
+                .writeBuffer(0, &lightInfo)
+                .writeBuffer(1, &clusterInfo)
+                .writeBuffer(2, &indexInfo)
+                .build(lightDescriptorSets[i])) {
+                throw std::runtime_error("failed to allocate light cluster descriptor set!");
+            }
+        }
+    }
+
+    void LightClusterSystem::buildClusterBounds(const glm::mat4& projection, float nearPlane, float farPlane) {
+        nearClip = nearPlane;
+        farClip = farPlane;
+
+        // slice = log(depth) * scale - bias, same formula as the fragment shader
+        float logRatio = std::log(farClip / nearClip);
+        sliceScale = static_cast<float>(CLUSTER_Z) / logRatio;
+        sliceBias = static_cast<float>(CLUSTER_Z) * std::log(nearClip) / logRatio;
+
+        const glm::mat4 inverseProjection = glm::inverse(projection);
+        auto unproject = [&](float x, float y, float z) {
+            glm::vec4 p = inverseProjection * glm::vec4(x, y, z, 1.f);
+            return glm::vec3(p) / p.w;
+        };
+
+        for (uint32_t y = 0; y < CLUSTER_Y; y++) {
+            for (uint32_t x = 0; x < CLUSTER_X; x++) {
+                float ndcX[2] = { -1.f + 2.f * x / CLUSTER_X, -1.f + 2.f * (x + 1) / CLUSTER_X };
+                float ndcY[2] = { -1.f + 2.f * y / CLUSTER_Y, -1.f + 2.f * (y + 1) / CLUSTER_Y };
+
+                // Rays through the tile corners, from the near to the far plane
+                glm::vec3 nearPoints[4];
+                glm::vec3 farPoints[4];
+                for (int c = 0; c < 4; c++) {
+                    nearPoints[c] = unproject(ndcX[c & 1], ndcY[c >> 1], 0.f);
+                    farPoints[c] = unproject(ndcX[c & 1], ndcY[c >> 1], 1.f);
+                }
+
+                for (uint32_t z = 0; z < CLUSTER_Z; z++) {
+                    float sliceNear = nearClip * std::pow(farClip / nearClip, static_cast<float>(z) / CLUSTER_Z);
+                    float sliceFar = nearClip * std::pow(farClip / nearClip, static_cast<float>(z + 1) / CLUSTER_Z);
+
+                    Bounds bounds{ glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+                    for (int c = 0; c < 4; c++) {
+                        // View space looks down -z, depth is -z
+                        float nearDepth = -nearPoints[c].z;
+                        float farDepth = -farPoints[c].z;
+                        for (float depth : { sliceNear, sliceFar }) {
+                            float t = (depth - nearDepth) / (farDepth - nearDepth);
+                            glm::vec3 p = glm::mix(nearPoints[c], farPoints[c], t);
+                            bounds.min = glm::min(bounds.min, p);
+                            bounds.max = glm::max(bounds.max, p);
+                        }
+                    }
+                    clusterBounds[z * CLUSTERS_PER_SLICE + y * CLUSTER_X + x] = bounds;
+                }
+            }
+        }
+
+        boundsProjection = projection;
+    }
+
+    uint32_t LightClusterSystem::sliceForDepth(float depth) const {
+        float slice = std::log(std::max(depth, nearClip)) * sliceScale - sliceBias;
+        return static_cast<uint32_t>(std::clamp(slice, 0.f, static_cast<float>(CLUSTER_Z - 1)));
+    }
+
+    LightClusterSystem::LightBin LightClusterSystem::binLight(const PointLight& light, const glm::mat4& view, const glm::mat4& projection) const {
+        glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(light.position), 1.f));
+        float radius = light.position.w;
+        float depth = -center.z;
+
+        LightBin bin{ glm::vec4(center, radius), 0, CLUSTER_X - 1, 0, CLUSTER_Y - 1, 1, 0 };
+
+        // Entirely in front of the near plane or behind the far plane, empty z range
+        if (radius <= 0.f || depth + radius < nearClip || depth - radius > farClip) {
+            return bin;
+        }
+        bin.minZ = sliceForDepth(depth - radius);
+        bin.maxZ = sliceForDepth(depth + radius);
+
+        // Crossing the near plane makes the projected bounds meaningless, keep the whole screen
+        if (depth - radius <= nearClip) {
+            return bin;
+        }
+
+        glm::vec2 ndcMin(FLT_MAX);
+        glm::vec2 ndcMax(-FLT_MAX);
+        for (int c = 0; c < 8; c++) {
+            glm::vec3 corner = center + radius * glm::vec3(c & 1 ? 1.f : -1.f, c & 2 ? 1.f : -1.f, c & 4 ? 1.f : -1.f);
+            glm::vec4 clip = projection * glm::vec4(corner, 1.f);
+            glm::vec2 ndc = glm::vec2(clip) / clip.w;
+            ndcMin = glm::min(ndcMin, ndc);
+            ndcMax = glm::max(ndcMax, ndc);
+        }
+
+        if (ndcMax.x < -1.f || ndcMin.x > 1.f || ndcMax.y < -1.f || ndcMin.y > 1.f) {
+            bin.minZ = 1;
+            bin.maxZ = 0;
+            return bin;
+        }
+
+        auto toTile = [](float ndc, uint32_t tiles) {
+            float tile = (ndc * 0.5f + 0.5f) * static_cast<float>(tiles);
+            return static_cast<uint32_t>(std::clamp(tile, 0.f, static_cast<float>(tiles - 1)));
+        };
+        bin.minX = toTile(ndcMin.x, CLUSTER_X);
+        bin.maxX = toTile(ndcMax.x, CLUSTER_X);
+        bin.minY = toTile(ndcMin.y, CLUSTER_Y);
+        bin.maxY = toTile(ndcMax.y, CLUSTER_Y);
+        return bin;
+    }
+
+    void LightClusterSystem::cullSlice(uint32_t slice, const std::vector<LightBin>& lightBins) {
+        auto& list = slices[slice];
+        list.counts.fill(0);
+        list.clusterOfEntry.clear();
+        list.lightOfEntry.clear();
+
+        const Bounds* sliceBounds = &clusterBounds[slice * CLUSTERS_PER_SLICE];
+
+        // Light-major so the cost scales with the clusters lights actually touch
+        for (uint32_t lightIndex = 0; lightIndex < lightBins.size(); lightIndex++) {
+            const auto& bin = lightBins[lightIndex];
+            if (slice < bin.minZ || slice > bin.maxZ) continue;
+
+            glm::vec3 center(bin.sphere);
+            float radiusSquared = bin.sphere.w * bin.sphere.w;
+
+            for (uint32_t y = bin.minY; y <= bin.maxY; y++) {
+                for (uint32_t x = bin.minX; x <= bin.maxX; x++) {
+                    uint32_t localCluster = y * CLUSTER_X + x;
+                    const auto& bounds = sliceBounds[localCluster];
+
+                    // Sphere vs box: distance from the center to the closest point of the box
+                    glm::vec3 closest = glm::clamp(center, bounds.min, bounds.max);
+                    glm::vec3 delta = closest - center;
+                    if (glm::dot(delta, delta) > radiusSquared) continue;
+
+                    list.counts[localCluster]++;
+                    list.clusterOfEntry.push_back(localCluster);
+                    list.lightOfEntry.push_back(lightIndex);
+                }
+            }
+        }
+
+        // Counting sort the pairs so each cluster's lights are contiguous
+        std::array<uint32_t, CLUSTERS_PER_SLICE> cursor;
+        uint32_t running = 0;
+        for (uint32_t i = 0; i < CLUSTERS_PER_SLICE; i++) {
+            cursor[i] = running;
+            running += list.counts[i];
+        }
+        list.sortedLights.resize(list.lightOfEntry.size());
+        for (size_t i = 0; i < list.lightOfEntry.size(); i++) {
+            list.sortedLights[cursor[list.clusterOfEntry[i]]++] = list.lightOfEntry[i];
+        }
+    }
+
+    void LightClusterSystem::update(FrameInfo& frameInfo, const std::vector<PointLight>& lights) {
+        const auto& camera = frameInfo.camera;
+        const glm::mat4& projection = camera.getProjection();
+        const glm::mat4& view = camera.getView();
+
+        if (projection != boundsProjection || camera.getNearClip() != nearClip || camera.getFarClip() != farClip) {
+            buildClusterBounds(projection, camera.getNearClip(), camera.getFarClip());
+        }
+
+        lightCount = static_cast<uint32_t>(std::min<size_t>(lights.size(), MAX_POINT_LIGHTS));
+
+        auto& jobs = JobSystem::getInstance();
+        bins.resize(lightCount);
+        jobs.parallelFor(lightCount, 256, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                bins[i] = binLight(lights[i], view, projection);
+            }
+        });
+
+        jobs.parallelFor(CLUSTER_Z, 1, [&](size_t begin, size_t end) {
+            for (size_t slice = begin; slice < end; slice++) {
+                cullSlice(static_cast<uint32_t>(slice), bins);
+            }
+        });
+
+        // Slices are packed back to back in the index buffer
+        std::array<uint32_t, CLUSTER_Z> sliceBase;
+        uint32_t total = 0;
+        for (uint32_t slice = 0; slice < CLUSTER_Z; slice++) {
+            sliceBase[slice] = total;
+            total += static_cast<uint32_t>(slices[slice].sortedLights.size());
+        }
+        if (total > MAX_LIGHT_INDICES && !warnedIndexOverflow) {
+            std::cout << "Light clusters need " << total << " indices, only " << MAX_LIGHT_INDICES << " fit, some lights will be dropped" << std::endl;
+            warnedIndexOverflow = true;
+        }
+        lightIndexCount = std::min(total, MAX_LIGHT_INDICES);
+
+        auto* ranges = static_cast<ClusterRange*>(clusterBuffers[frameInfo.frameIndex]->getMappedMemory());
+        auto* indices = static_cast<uint32_t*>(indexBuffers[frameInfo.frameIndex]->getMappedMemory());
+
+        jobs.parallelFor(CLUSTER_Z, 4, [&](size_t begin, size_t end) {
+            for (size_t slice = begin; slice < end; slice++) {
+                const auto& list = slices[slice];
+                uint32_t offset = sliceBase[slice];
+                for (uint32_t i = 0; i < CLUSTERS_PER_SLICE; i++) {
+                    uint32_t start = std::min(offset, MAX_LIGHT_INDICES);
+                    uint32_t count = std::min(offset + list.counts[i], MAX_LIGHT_INDICES) - start;
+                    ranges[slice * CLUSTERS_PER_SLICE + i] = { start, count };
+                    offset += list.counts[i];
+                }
+
+                uint32_t base = sliceBase[slice];
+                if (base < MAX_LIGHT_INDICES) {
+                    size_t copyCount = std::min<size_t>(list.sortedLights.size(), MAX_LIGHT_INDICES - base);
+                    std::memcpy(indices + base, list.sortedLights.data(), copyCount * sizeof(uint32_t));
+                }
+            }
+        });
+
+        auto* lightData = static_cast<PointLight*>(lightBuffers[frameInfo.frameIndex]->getMappedMemory());
+        ClusterInfo info{};
+        info.gridSize = glm::uvec4(CLUSTER_X, CLUSTER_Y, CLUSTER_Z, lightCount);
+        info.depthParams = glm::vec4(nearClip, farClip, sliceScale, sliceBias);
+        std::memcpy(lightData, &info, sizeof(ClusterInfo));
+        if (lightCount > 0) {
+            std::memcpy(lightData + 1, lights.data(), lightCount * sizeof(PointLight));
+        }
+
+        lightBuffers[frameInfo.frameIndex]->flush();
+        clusterBuffers[frameInfo.frameIndex]->flush();
+        if (lightIndexCount > 0) {
+            indexBuffers[frameInfo.frameIndex]->flush();
+        }
+    }
+}
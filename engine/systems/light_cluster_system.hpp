@@ -0,0 +1,106 @@
+#pragma once
+#include "renderer/device.hpp"
+#include "renderer/frame_info.hpp"
+#include "renderer/buffer.hpp"
+#include "renderer/descriptors.hpp"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace grape {
+
+    // Header at the start of the light buffer, layout must match ClusterInfo in simple_shader.frag
+    struct ClusterInfo {
+        glm::uvec4 gridSize{ 0 };       // tiles x, tiles y, depth slices, light count
+        glm::vec4 depthParams{ 0.f };   // near, far, slice scale, slice bias
+        glm::vec4 padding{ 0.f };       // Pads the header to one light slot
+    };
+
+    // Where a cluster's lights start in the index buffer and how many there are (uvec2 in the shader)
+    struct ClusterRange {
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    // Clustered forward lighting. The view frustum is split into a grid of screen tiles times
+    // exponential depth slices, every frame each light's range sphere is binned into the clusters
+    // it touches (on the job system) and the fragment shader only loops over its own cluster's list.
+    // Owns descriptor set 2 of the simple render pipeline: lights, cluster ranges, light indices
+    class LightClusterSystem {
+    public:
+        static constexpr uint32_t CLUSTER_X = 16;
+        static constexpr uint32_t CLUSTER_Y = 9;
+        static constexpr uint32_t CLUSTER_Z = 24;
+        static constexpr uint32_t CLUSTERS_PER_SLICE = CLUSTER_X * CLUSTER_Y;
+        static constexpr uint32_t CLUSTER_COUNT = CLUSTERS_PER_SLICE * CLUSTER_Z;
+
+        static constexpr uint32_t MAX_POINT_LIGHTS = 16384;
+        static constexpr uint32_t MAX_LIGHT_INDICES = 1u << 19;
+
+        LightClusterSystem(Device& device);
+        ~LightClusterSystem() = default;
+
+        LightClusterSystem(const LightClusterSystem&) = delete;
+        LightClusterSystem& operator=(const LightClusterSystem&) = delete;
+
+        // Culls the lights against the camera's clusters and uploads everything for this frame
+        void update(FrameInfo& frameInfo, const std::vector<PointLight>& lights);
+
+        VkDescriptorSetLayout getSetLayout() const { return lightSetLayout->getDescriptorSetLayout(); }
+        VkDescriptorSet getDescriptorSet(int frameIndex) const { return lightDescriptorSets[frameIndex]; }
+
+        uint32_t getLightCount() const { return lightCount; }
+        uint32_t getLightIndexCount() const { return lightIndexCount; }
+
+    private:
+        struct Bounds {
+            glm::vec3 min;
+            glm::vec3 max;
+        };
+
+        // A light's view-space sphere and the block of clusters its bounds project onto
+        struct LightBin {
+            glm::vec4 sphere;
+            uint32_t minX, maxX, minY, maxY, minZ, maxZ;
+        };
+
+        struct SliceList {
+            std::array<uint32_t, CLUSTERS_PER_SLICE> counts;
+            std::vector<uint32_t> clusterOfEntry;   // local cluster of each (cluster, light) pair
+            std::vector<uint32_t> lightOfEntry;
+            std::vector<uint32_t> sortedLights;     // lights grouped by cluster, in cluster order
+        };
+
+        void createBuffers();
+        void buildClusterBounds(const glm::mat4& projection, float nearClip, float farClip);
+        LightBin binLight(const PointLight& light, const glm::mat4& view, const glm::mat4& projection) const;
+        void cullSlice(uint32_t slice, const std::vector<LightBin>& bins);
+
+        uint32_t sliceForDepth(float depth) const;
+
+        Device& device;
+
+        std::unique_ptr<DescriptorPool> lightPool;
+        std::unique_ptr<DescriptorSetLayout> lightSetLayout;
+        std::vector<std::unique_ptr<Buffer>> lightBuffers;
+        std::vector<std::unique_ptr<Buffer>> clusterBuffers;
+        std::vector<std::unique_ptr<Buffer>> indexBuffers;
+        std::vector<VkDescriptorSet> lightDescriptorSets;
+
+        // View-space cluster boxes only change with the projection
+        std::vector<Bounds> clusterBounds;
+        glm::mat4 boundsProjection{ 0.f };
+        float nearClip = 0.1f;
+        float farClip = 1000.f;
+        float sliceScale = 0.f;
+        float sliceBias = 0.f;
+
+        std::vector<LightBin> bins;
+        std::array<SliceList, CLUSTER_Z> slices;
+
+        uint32_t lightCount = 0;
+        uint32_t lightIndexCount = 0;
+        bool warnedIndexOverflow = false;
+    };
+}
@@ -1,7 +1,13 @@
 #include "physics.hpp"
 #include "renderer/frame_info.hpp"  // Add this include
+#include "core/job_system.hpp"
+#include "core/profiler.hpp"
+#include "core/memory_tracker.hpp"
+#include "core/perf_counters.hpp"
 
+#include <chrono>
 #include <iostream>
+#include <new>
 
 #define PVD_HOST "127.0.0.1"
 
@@ -18,11 +24,46 @@ namespace grape {
 		}
 	}gErrorCallback;
 
+	// Runs PhysX tasks on the engine job system instead of a private thread pool
+	class JobSystemDispatcher : public PxCpuDispatcher
+	{
+	public:
+		virtual void submitTask(PxBaseTask& task)
+		{
+			JobSystem::getInstance().schedule([&task]() {
+				task.run();
+				task.release();
+			});
+		}
+
+		virtual uint32_t getWorkerCount() const
+		{
+			return JobSystem::getInstance().getWorkerCount();
+		}
+	}gJobSystemDispatcher;
+
+	// PxDefaultAllocator with the memory charged to Physics, whichever thread PhysX allocates on.
+	// PhysX wants 16 byte aligned blocks
+	class TrackingAllocator : public PxAllocatorCallback
+	{
+	public:
+		virtual void* allocate(size_t size, const char*, const char*, int)
+		{
+			GRAPE_MEMORY_SCOPE(MemoryTag::Physics);
+			return ::operator new(size, std::align_val_t(16), std::nothrow);
+		}
+
+		virtual void deallocate(void* ptr)
+		{
+			::operator delete(ptr, std::align_val_t(16));
+		}
+	};
+
 	PxFoundation* _foundation;
-	PxDefaultAllocator _allocator;
+	TrackingAllocator _allocator;
 	PxPvd* _pvd = NULL;
 	PxPhysics* _physics = NULL;
-	PxDefaultCpuDispatcher* _dispatcher = NULL;
+	PxCpuDispatcher* _dispatcher = NULL;
 	PxScene* _scene = NULL;
 	PxScene* _editorScene = NULL;
 	PxMaterial* _defaultMaterial = NULL;
@@ -30,6 +71,11 @@ namespace grape {
 	PxShape* _groundShape = NULL;
 
 	Physics::Physics() {
+	}
+
+	void Physics::init() {
+		GRAPE_PROFILE_FUNCTION();
+		GRAPE_MEMORY_SCOPE(MemoryTag::Physics);
 		_foundation = PxCreateFoundation(PX_PHYSICS_VERSION, _allocator, gErrorCallback);
 		if (!_foundation) {
 			//PxCreateFoundation failed!
@@ -46,7 +92,7 @@ namespace grape {
 
 		PxSceneDesc sceneDesc(_physics->getTolerancesScale());
 		sceneDesc.gravity = PxVec3(0.0f, -9.81f, 0.0f);
-		_dispatcher = PxDefaultCpuDispatcherCreate(2);
+		_dispatcher = &gJobSystemDispatcher;
 		sceneDesc.cpuDispatcher = _dispatcher;
 		sceneDesc.filterShader = PxDefaultSimulationFilterShader;
 		_scene = _physics->createScene(sceneDesc);
@@ -73,8 +119,13 @@ namespace grape {
 
 	void Physics::StepPhysics(float deltaTime)
 	{
+		GRAPE_PROFILE_FUNCTION();
+		GRAPE_MEMORY_SCOPE(MemoryTag::Physics);
+		auto start = std::chrono::steady_clock::now();
 		_scene->simulate(deltaTime);
 		_scene->fetchResults(true);
+		PerfCounters::getInstance().setGauge(PerfGauge::PhysicsStepUs,
+			std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
 
 		// Update debug data if visualization is enabled
 		if (debugVisualizationEnabled) {
@@ -20,6 +20,9 @@ namespace grape {
     public:
         Physics();
         ~Physics();
+        // PhysX foundation, PVD connection and the scene. Separate from the constructor so it can
+        // run on a worker while the rest of startup goes on, call once before anything else
+        void init();
         void StepPhysics(float deltaTime);
         inline PxMat44 GlmMat4ToPxMat44(glm::mat4 glmMatrix);
         PxRigidDynamic* CreateRigidDynamic(PxTransform transform, bool kinematic);
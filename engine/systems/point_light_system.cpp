@@ -1,4 +1,5 @@
 #include "point_light_system.hpp"
+#include "core/perf_counters.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -62,14 +63,14 @@ namespace grape {
 		grapePipeline = std::make_unique<Pipeline>(grapeDevice, "resources/shaders/point_light.vert.spv", "resources/shaders/point_light.frag.spv", pipelineConfig);
 	}
 
-	void PointLightSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo)
+	void PointLightSystem::update(FrameInfo& frameInfo, std::vector<PointLight>& lights)
 	{
 		auto rotateLight = glm::rotate(
 			glm::mat4(1.f),
 			frameInfo.frameTime,
 			{ 0.f, -1.f, 0.f });
 
-		int lightIndex = 0;
+		lights.clear();
 
 		for (auto& kv : frameInfo.gameObjects) {
 
@@ -79,17 +80,13 @@ namespace grape {
 				continue;
 			}
 
-			assert(lightIndex < MAX_LIGHTS && "Point Light exceed maximum specified");
-
 			obj.transform.translation = glm::vec3(rotateLight * glm::vec4(obj.transform.translation, 1.f));
 
-			ubo.pointLights[lightIndex].position = glm::vec4(obj.transform.translation, 1.f);
-			ubo.pointLights[lightIndex].color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
-
-			lightIndex += 1;
+			PointLight light{};
+			light.position = glm::vec4(obj.transform.translation, obj.pointLight->range);
+			light.color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
+			lights.push_back(light);
 		}
-
-		ubo.numLights = lightIndex;
 	}
 
 	void PointLightSystem::render(FrameInfo& frameInfo)
@@ -104,6 +101,7 @@ namespace grape {
 			&frameInfo.globalDescriptorSet,
 			0, nullptr
 		);
+		PerfCounters::add(PerfCounter::DescriptorSetBinds);
 
 		for (auto& kv : frameInfo.gameObjects) {
 
@@ -127,6 +125,8 @@ namespace grape {
 				&push);
 
 			vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
+			PerfCounters::add(PerfCounter::DrawCalls);
+			PerfCounters::add(PerfCounter::Triangles, 2);
 		}
 	}
 }
\ No newline at end of file
@@ -21,7 +21,8 @@ namespace grape {
 		PointLightSystem(const PointLightSystem&) = delete;
 		PointLightSystem& operator=(const PointLightSystem&) = delete;
 
-		void update(FrameInfo& frameInfo, GlobalUbo& ubo);
+		// Animates the lights and gathers them for the light clusters
+		void update(FrameInfo& frameInfo, std::vector<PointLight>& lights);
 		void render(FrameInfo& frameInfo);
 
 	private:
@@ -0,0 +1,704 @@
+#include "point_shadow_system.hpp"
+#include "systems/simple_render_system.hpp"
+#include "renderer/swap_chain.hpp"
+#include "renderer/culling.hpp"
+#include "core/job_system.hpp"
+#include "core/utils.hpp"
+#include "core/perf_counters.hpp"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/hash.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace grape {
+
+    namespace {
+        struct ShadowPushConstants {
+            glm::mat4 faceViewProjection{ 1.f };
+        };
+
+        // Face order the fragment shader picks with the major axis of the light-to-fragment vector
+        const glm::vec3 FACE_DIRECTIONS[PointShadowSystem::FACE_COUNT] = {
+            { 1.f, 0.f, 0.f }, { -1.f, 0.f, 0.f },
+            { 0.f, 1.f, 0.f }, { 0.f, -1.f, 0.f },
+            { 0.f, 0.f, 1.f }, { 0.f, 0.f, -1.f }
+        };
+        const glm::vec3 FACE_UPS[PointShadowSystem::FACE_COUNT] = {
+            { 0.f, 1.f, 0.f }, { 0.f, 1.f, 0.f },
+            { 0.f, 0.f, 1.f }, { 0.f, 0.f, 1.f },
+            { 0.f, 1.f, 0.f }, { 0.f, 1.f, 0.f }
+        };
+    }
+
+    PointShadowSystem::PointShadowSystem(Device& device) : device{ device } {
+        createShadowImages();
+        createRenderPasses();
+        createFramebuffers();
+        createDescriptors();
+        createPipeline();
+    }
+
+    PointShadowSystem::~PointShadowSystem() {
+        VkDevice vkDevice = device.device();
+
+        shadowPipeline.reset();
+        vkDestroyPipelineLayout(vkDevice, pipelineLayout, nullptr);
+
+        for (auto framebuffer : cacheFramebuffers) vkDestroyFramebuffer(vkDevice, framebuffer, nullptr);
+        for (auto framebuffer : shadowFramebuffers) vkDestroyFramebuffer(vkDevice, framebuffer, nullptr);
+        vkDestroyRenderPass(vkDevice, cachePass, nullptr);
+        vkDestroyRenderPass(vkDevice, overlayPass, nullptr);
+
+        for (auto view : cacheLayerViews) vkDestroyImageView(vkDevice, view, nullptr);
+        for (auto view : shadowLayerViews) vkDestroyImageView(vkDevice, view, nullptr);
+        vkDestroyImageView(vkDevice, shadowArrayView, nullptr);
+        vkDestroySampler(vkDevice, shadowSampler, nullptr);
+
+        vkDestroyImage(vkDevice, cacheImage, nullptr);
+        device.freeMemory(cacheMemory);
+        vkDestroyImage(vkDevice, shadowImage, nullptr);
+        device.freeMemory(shadowMemory);
+    }
+
+    void PointShadowSystem::createShadowImages() {
+        // 16 bits is plenty over a light's range and halves the memory of 2 x 48 layers
+        shadowFormat = device.findSupportedFormat(
+            { VK_FORMAT_D16_UNORM, VK_FORMAT_D32_SFLOAT },
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+
+        auto createLayers = [&](VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& memory) {
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.extent = { SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 1 };
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = LAYER_COUNT;
+            imageInfo.format = shadowFormat;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = usage;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, memory);
+        };
+
+        createLayers(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            shadowImage, shadowMemory);
+        createLayers(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            cacheImage, cacheMemory);
+
+        auto createView = [&](VkImage image, VkImageViewType viewType, uint32_t baseLayer, uint32_t layerCount) {
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = image;
+            viewInfo.viewType = viewType;
+            viewInfo.format = shadowFormat;
+            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+            viewInfo.subresourceRange.baseMipLevel = 0;
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.baseArrayLayer = baseLayer;
+            viewInfo.subresourceRange.layerCount = layerCount;
+
+            VkImageView view;
+            if (vkCreateImageView(device.device(), &viewInfo, nullptr, &view) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create shadow map image view!");
+            }
+            return view;
+        };
+
+        shadowArrayView = createView(shadowImage, VK_IMAGE_VIEW_TYPE_2D_ARRAY, 0, LAYER_COUNT);
+        for (uint32_t layer = 0; layer < LAYER_COUNT; layer++) {
+            shadowLayerViews.push_back(createView(shadowImage, VK_IMAGE_VIEW_TYPE_2D, layer, 1));
+            cacheLayerViews.push_back(createView(cacheImage, VK_IMAGE_VIEW_TYPE_2D, layer, 1));
+        }
+
+        // Hardware PCF where the format can filter, otherwise single comparisons
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), shadowFormat, &formatProperties);
+        VkFilter filter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)
+            ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = filter;
+        samplerInfo.minFilter = filter;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.compareEnable = VK_TRUE;
+        samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+        samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+
+        if (vkCreateSampler(device.device(), &samplerInfo, nullptr, &shadowSampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow sampler!");
+        }
+
+        // Lights without a rendered face yet sample the far plane, i.e. unshadowed
+        device.submitOneShot([&](VkCommandBuffer commandBuffer) {
+            VkImageSubresourceRange range{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, LAYER_COUNT };
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = shadowImage;
+            barrier.subresourceRange = range;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            VkClearDepthStencilValue clearValue{ 1.0f, 0 };
+            vkCmdClearDepthStencilImage(commandBuffer, shadowImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearValue, 1, &range);
+
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                0, 0, nullptr, 0, nullptr, 1, &barrier);
+        });
+    }
+
+    void PointShadowSystem::createRenderPasses() {
+        auto createPass = [&](VkAttachmentLoadOp loadOp, VkImageLayout initialLayout, VkImageLayout finalLayout,
+            const std::vector<VkSubpassDependency>& dependencies, VkRenderPass& renderPass) {
+            VkAttachmentDescription depthAttachment{};
+            depthAttachment.format = shadowFormat;
+            depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+            depthAttachment.loadOp = loadOp;
+            depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+            depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            depthAttachment.initialLayout = initialLayout;
+            depthAttachment.finalLayout = finalLayout;
+
+            VkAttachmentReference depthRef{};
+            depthRef.attachment = 0;
+            depthRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+            VkSubpassDescription subpass{};
+            subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+            subpass.colorAttachmentCount = 0;
+            subpass.pDepthStencilAttachment = &depthRef;
+
+            VkRenderPassCreateInfo rpInfo{};
+            rpInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+            rpInfo.attachmentCount = 1;
+            rpInfo.pAttachments = &depthAttachment;
+            rpInfo.subpassCount = 1;
+            rpInfo.pSubpasses = &subpass;
+            rpInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+            rpInfo.pDependencies = dependencies.data();
+
+            if (vkCreateRenderPass(device.device(), &rpInfo, nullptr, &renderPass) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create shadow render pass!");
+            }
+        };
+
+        const VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        const VkAccessFlags depthAccess = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        // Cache: the last copy out of the layer has to finish before it's cleared, and the new
+        // depth has to land before it's copied again
+        VkSubpassDependency cacheIn{};
+        cacheIn.srcSubpass = VK_SUBPASS_EXTERNAL;
+        cacheIn.dstSubpass = 0;
+        cacheIn.srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        cacheIn.srcAccessMask = 0;
+        cacheIn.dstStageMask = depthStages;
+        cacheIn.dstAccessMask = depthAccess;
+
+        VkSubpassDependency cacheOut{};
+        cacheOut.srcSubpass = 0;
+        cacheOut.dstSubpass = VK_SUBPASS_EXTERNAL;
+        cacheOut.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        cacheOut.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        cacheOut.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        cacheOut.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        createPass(VK_ATTACHMENT_LOAD_OP_CLEAR, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            { cacheIn, cacheOut }, cachePass);
+
+        // Overlay: the copy is made visible by an explicit barrier, the result is sampled by the lit pass
+        VkSubpassDependency overlayOut{};
+        overlayOut.srcSubpass = 0;
+        overlayOut.dstSubpass = VK_SUBPASS_EXTERNAL;
+        overlayOut.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        overlayOut.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        overlayOut.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        overlayOut.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        createPass(VK_ATTACHMENT_LOAD_OP_LOAD, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            { overlayOut }, overlayPass);
+    }
+
+    void PointShadowSystem::createFramebuffers() {
+        auto createFramebuffer = [&](VkRenderPass renderPass, VkImageView view) {
+            VkFramebufferCreateInfo fbInfo{};
+            fbInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            fbInfo.renderPass = renderPass;
+            fbInfo.attachmentCount = 1;
+            fbInfo.pAttachments = &view;
+            fbInfo.width = SHADOW_MAP_SIZE;
+            fbInfo.height = SHADOW_MAP_SIZE;
+            fbInfo.layers = 1;
+
+            VkFramebuffer framebuffer;
+            if (vkCreateFramebuffer(device.device(), &fbInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create shadow framebuffer!");
+            }
+            return framebuffer;
+        };
+
+        for (uint32_t layer = 0; layer < LAYER_COUNT; layer++) {
+            cacheFramebuffers.push_back(createFramebuffer(cachePass, cacheLayerViews[layer]));
+            shadowFramebuffers.push_back(createFramebuffer(overlayPass, shadowLayerViews[layer]));
+        }
+    }
+
+    void PointShadowSystem::createDescriptors() {
+        shadowPool = DescriptorPool::Builder(device)
+            .setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT * 2)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT * 2)
+            .build();
+
+        shadowSetLayout = DescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .build();
+
+        casterSetLayout = DescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+            .build();
+
+        faceBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        casterBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        shadowDescriptorSets.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        casterDescriptorSets.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.sampler = shadowSampler;
+        imageInfo.imageView = shadowArrayView;
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        for (int i = 0; i < shadowDescriptorSets.size(); i++) {
+            faceBuffers[i] = std::make_unique<Buffer>(
+                device, sizeof(glm::mat4), LAYER_COUNT,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+            casterBuffers[i] = std::make_unique<Buffer>(
+                device, sizeof(glm::mat4), MAX_SHADOW_CASTERS,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+            faceBuffers[i]->map();
+            casterBuffers[i]->map();
+
+            auto faceInfo = faceBuffers[i]->descriptorInfo();
+            if (!DescriptorWriter(*shadowSetLayout, *shadowPool)
+                .writeImage(0, &imageInfo)
+                .writeBuffer(1, &faceInfo)
+                .build(shadowDescriptorSets[i])) {
+                throw std::runtime_error("failed to allocate shadow descriptor set!");
+            }
+
+            auto casterInfo = casterBuffers[i]->descriptorInfo();
+            if (!DescriptorWriter(*casterSetLayout, *shadowPool)
+                .writeBuffer(0, &casterInfo)
+                .build(casterDescriptorSets[i])) {
+                throw std::runtime_error("failed to allocate shadow caster descriptor set!");
+            }
+        }
+    }
+
+    void PointShadowSystem::createPipeline() {
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(ShadowPushConstants);
+
+        VkDescriptorSetLayout setLayout = casterSetLayout->getDescriptorSetLayout();
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &setLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow pipeline layout!");
+        }
+
+        // Depth only out of the position stream. Slope-scaled bias keeps lit surfaces from
+        // shadowing themselves, the shader adds a normal offset on top
+        PipelineConfigInfo pipelineConfig{};
+        Pipeline::defaultPipelineConfigInfo(pipelineConfig);
+        pipelineConfig.bindingDescriptions = Model::PackedVertex::getPositionBindingDescriptions();
+        pipelineConfig.attributeDescriptions = Model::PackedVertex::getPositionAttributeDescriptions();
+        pipelineConfig.colorBlendInfo.attachmentCount = 0;
+        pipelineConfig.rasterizationInfo.depthBiasEnable = VK_TRUE;
+        pipelineConfig.rasterizationInfo.depthBiasConstantFactor = 1.25f;
+        pipelineConfig.rasterizationInfo.depthBiasSlopeFactor = 1.75f;
+        pipelineConfig.renderPass = cachePass;     // Compatible with overlayPass, only the load op differs
+        pipelineConfig.pipelineLayout = pipelineLayout;
+        shadowPipeline = std::make_unique<Pipeline>(device, "resources/shaders/point_shadow.vert.spv", "", pipelineConfig);
+    }
+
+    void PointShadowSystem::buildFaces(Slot& slot, const glm::vec4& sphere) {
+        slot.sphere = sphere;
+
+        const glm::vec3 position{ sphere };
+        const glm::mat4 projection = glm::perspectiveRH_ZO(glm::half_pi<float>(), 1.f, SHADOW_NEAR_CLIP,
+            std::max(sphere.w, SHADOW_NEAR_CLIP * 2.f));
+        for (uint32_t face = 0; face < FACE_COUNT; face++) {
+            slot.faceViewProjection[face] = projection * glm::lookAt(position, position + FACE_DIRECTIONS[face], FACE_UPS[face]);
+        }
+    }
+
+    void PointShadowSystem::assignLights(FrameInfo& frameInfo, std::vector<PointLight>& lights) {
+        activeSlots.clear();
+
+        if (!DebugSettings::getInstance().pointShadows) {
+            for (auto& slot : slots) slot.used = false;
+            return;
+        }
+
+        struct Candidate {
+            float distance;
+            GameObject::id_t id;
+            uint32_t lightIndex;
+        };
+        std::vector<Candidate> candidates;
+
+        // Only lights that can light something on screen, nearest first
+        const Frustum frustum(frameInfo.camera.getProjection() * frameInfo.camera.getView());
+        const glm::vec3 cameraPosition = glm::vec3(frameInfo.camera.getInverseView()[3]);
+
+        uint32_t lightIndex = 0;
+        for (auto& kv : frameInfo.gameObjects) {
+            if (kv.second.pointLight == nullptr) continue;
+            if (lightIndex >= lights.size()) break;
+
+            const uint32_t index = lightIndex++;
+            const glm::vec3 center{ lights[index].position };
+            const float range = lights[index].position.w;
+            if (range <= 0.f || !frustum.intersectsBox(center - glm::vec3(range), center + glm::vec3(range))) continue;
+
+            candidates.push_back({ std::max(glm::length(center - cameraPosition) - range, 0.f), kv.first, index });
+        }
+
+        const size_t pickCount = std::min<size_t>(candidates.size(), MAX_SHADOWED_LIGHTS);
+        std::partial_sort(candidates.begin(), candidates.begin() + pickCount, candidates.end(),
+            [](const Candidate& a, const Candidate& b) {
+                return a.distance < b.distance || (a.distance == b.distance && a.id < b.id);
+            });
+
+        // Lights keep their slot (and cached faces) for as long as they stay picked
+        std::array<int, MAX_SHADOWED_LIGHTS> slotOfPick;
+        std::array<bool, MAX_SHADOWED_LIGHTS> keep{};
+        slotOfPick.fill(-1);
+        for (size_t pick = 0; pick < pickCount; pick++) {
+            for (uint32_t s = 0; s < MAX_SHADOWED_LIGHTS; s++) {
+                if (slots[s].used && slots[s].light == candidates[pick].id) {
+                    slotOfPick[pick] = static_cast<int>(s);
+                    keep[s] = true;
+                    break;
+                }
+            }
+        }
+        for (uint32_t s = 0; s < MAX_SHADOWED_LIGHTS; s++) {
+            if (!keep[s]) slots[s].used = false;
+        }
+
+        auto* faceData = static_cast<glm::mat4*>(faceBuffers[frameInfo.frameIndex]->getMappedMemory());
+
+        for (size_t pick = 0; pick < pickCount; pick++) {
+            const auto& candidate = candidates[pick];
+            const glm::vec4& sphere = lights[candidate.lightIndex].position;
+
+            if (slotOfPick[pick] < 0) {
+                for (uint32_t s = 0; s < MAX_SHADOWED_LIGHTS; s++) {
+                    if (slots[s].used) continue;
+
+                    Slot& slot = slots[s];
+                    slot.used = true;
+                    slot.light = candidate.id;
+                    slot.cacheValid.fill(false);
+                    slot.hasDynamic.fill(false);
+                    buildFaces(slot, sphere);
+                    slotOfPick[pick] = static_cast<int>(s);
+                    break;
+                }
+            }
+
+            const uint32_t s = static_cast<uint32_t>(slotOfPick[pick]);
+            Slot& slot = slots[s];
+            if (slot.sphere != sphere) {
+                buildFaces(slot, sphere);
+            }
+
+            lights[candidate.lightIndex].shadowIndex = static_cast<int>(s);
+            std::copy(slot.faceViewProjection.begin(), slot.faceViewProjection.end(), faceData + s * FACE_COUNT);
+            activeSlots.push_back(s);
+        }
+
+        if (!activeSlots.empty()) {
+            faceBuffers[frameInfo.frameIndex]->flush();
+        }
+    }
+
+    void PointShadowSystem::cullSlot(SlotWork& slotWork) {
+        const auto& debugSettings = DebugSettings::getInstance();
+        const Slot& slot = slots[slotWork.slot];
+        const glm::vec3 lightPosition{ slot.sphere };
+        const float range = slot.sphere.w;
+
+        slotWork.instances.clear();
+        std::array<Frustum, FACE_COUNT> faceFrustums;
+        for (uint32_t face = 0; face < FACE_COUNT; face++) {
+            slotWork.staticDraws[face].clear();
+            slotWork.dynamicDraws[face].clear();
+            slotWork.signature[face] = 0;
+            hashCombine(slotWork.signature[face], slot.sphere);
+            faceFrustums[face] = Frustum(slot.faceViewProjection[face]);
+        }
+
+        // 90 degree faces, so a unit of error at distance 1 covers half the map
+        const float pixelsPerUnit = 0.5f * static_cast<float>(SHADOW_MAP_SIZE);
+
+        for (const auto& caster : casters) {
+            glm::vec3 closest = glm::clamp(lightPosition, caster.worldMin, caster.worldMax);
+            float distanceSquared = glm::dot(closest - lightPosition, closest - lightPosition);
+            if (distanceSquared > range * range) continue;
+
+            std::array<bool, FACE_COUNT> inFace{};
+            bool anyFace = false;
+            for (uint32_t face = 0; face < FACE_COUNT; face++) {
+                inFace[face] = faceFrustums[face].intersectsBox(caster.worldMin, caster.worldMax);
+                anyFace |= inFace[face];
+            }
+            if (!anyFace) continue;
+
+            const auto& transform = caster.object->transform;
+            float lodScale = 0.f;
+            if (debugSettings.meshLods) {
+                float scale = std::max(transform.scale.x, std::max(transform.scale.y, transform.scale.z));
+                lodScale = scale * pixelsPerUnit / std::max(std::sqrt(distanceSquared), SHADOW_NEAR_CLIP);
+            }
+
+            const auto& submeshes = caster.object->model->getSubmeshes();
+            for (uint32_t submesh = 0; submesh < submeshes.size(); submesh++) {
+                const auto& lods = submeshes[submesh].lods;
+                uint32_t lod = 0;
+                if (debugSettings.meshLods) {
+                    while (lod + 1 < lods.size() && lods[lod + 1].error * lodScale <= debugSettings.lodErrorPixels) {
+                        lod++;
+                    }
+                }
+
+                const uint32_t instance = static_cast<uint32_t>(slotWork.instances.size());
+                slotWork.instances.push_back({ caster.object, submesh });
+
+                for (uint32_t face = 0; face < FACE_COUNT; face++) {
+                    if (!inFace[face]) continue;
+
+                    if (caster.dynamic) {
+                        slotWork.dynamicDraws[face].push_back({ instance, submesh, lod });
+                    }
+                    else {
+                        slotWork.staticDraws[face].push_back({ instance, submesh, lod });
+                        hashCombine(slotWork.signature[face], caster.id, submesh, lod,
+                            transform.translation, transform.rotation, transform.scale);
+                    }
+                }
+            }
+        }
+    }
+
+    void PointShadowSystem::render(FrameInfo& frameInfo) {
+        auto& stats = ShadowStats::getInstance();
+        stats = ShadowStats{};
+        stats.shadowedLights = static_cast<uint32_t>(activeSlots.size());
+        if (activeSlots.empty()) return;
+
+        // Gather is serial (it walks the map), bounds and per-light culling go wide
+        casters.clear();
+        for (auto& kv : frameInfo.gameObjects) {
+            const auto& obj = kv.second;
+            if (obj.model == nullptr || obj.pointLight != nullptr) continue;
+
+            bool dynamic = obj.physicsComponent && obj.physicsComponent->isDynamic;
+            casters.push_back({ &obj, kv.first, glm::vec3(0.f), glm::vec3(0.f), dynamic });
+        }
+
+        JobSystem::getInstance().parallelFor(casters.size(), 256, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                glm::vec3 localMin, localMax;
+                casters[i].object->model->getBoundingBox(localMin, localMax);
+                transformBounds(casters[i].object->transform.mat4(), localMin, localMax, casters[i].worldMin, casters[i].worldMax);
+            }
+        });
+
+        if (work.size() < activeSlots.size()) work.resize(activeSlots.size());
+        for (size_t i = 0; i < activeSlots.size(); i++) {
+            work[i].slot = activeSlots[i];
+        }
+
+        JobSystem::getInstance().parallelFor(activeSlots.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                cullSlot(work[i]);
+            }
+        });
+
+        // One model matrix per (light, submesh), faces of the same light share them
+        auto* casterData = static_cast<glm::mat4*>(casterBuffers[frameInfo.frameIndex]->getMappedMemory());
+        uint32_t instanceCount = 0;
+        for (size_t i = 0; i < activeSlots.size(); i++) {
+            auto& slotWork = work[i];
+            slotWork.instanceBase = instanceCount;
+
+            const uint32_t available = MAX_SHADOW_CASTERS - instanceCount;
+            if (slotWork.instances.size() > available) {
+                if (!warnedCasterOverflow) {
+                    std::cerr << "Shadow caster buffer full, dropping casters past " << MAX_SHADOW_CASTERS << std::endl;
+                    warnedCasterOverflow = true;
+                }
+                slotWork.instances.resize(available);
+                auto dropped = [available](const FaceDraw& draw) { return draw.instance >= available; };
+                for (uint32_t face = 0; face < FACE_COUNT; face++) {
+                    auto& staticDraws = slotWork.staticDraws[face];
+                    auto& dynamicDraws = slotWork.dynamicDraws[face];
+                    staticDraws.erase(std::remove_if(staticDraws.begin(), staticDraws.end(), dropped), staticDraws.end());
+                    dynamicDraws.erase(std::remove_if(dynamicDraws.begin(), dynamicDraws.end(), dropped), dynamicDraws.end());
+                }
+            }
+
+            for (const auto& [object, submesh] : slotWork.instances) {
+                casterData[instanceCount++] = object->transform.mat4() * object->model->getSubmeshes()[submesh].dequantize;
+            }
+        }
+        if (instanceCount > 0) {
+            casterBuffers[frameInfo.frameIndex]->flush();
+        }
+
+        VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+        VkViewport viewport{ 0.f, 0.f, static_cast<float>(SHADOW_MAP_SIZE), static_cast<float>(SHADOW_MAP_SIZE), 0.f, 1.f };
+        VkRect2D scissor{ { 0, 0 }, { SHADOW_MAP_SIZE, SHADOW_MAP_SIZE } };
+        bool pipelineBound = false;
+
+        auto beginPass = [&](VkRenderPass renderPass, VkFramebuffer framebuffer) {
+            VkClearValue clearValue{};
+            clearValue.depthStencil = { 1.0f, 0 };
+
+            VkRenderPassBeginInfo rpInfo{};
+            rpInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            rpInfo.renderPass = renderPass;
+            rpInfo.framebuffer = framebuffer;
+            rpInfo.renderArea = scissor;
+            rpInfo.clearValueCount = 1;
+            rpInfo.pClearValues = &clearValue;
+            vkCmdBeginRenderPass(commandBuffer, &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+            if (!pipelineBound) {
+                shadowPipeline->bind(commandBuffer);
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+                    0, 1, &casterDescriptorSets[frameInfo.frameIndex], 0, nullptr);
+                PerfCounters::add(PerfCounter::DescriptorSetBinds);
+                vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+                vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+                pipelineBound = true;
+            }
+        };
+
+        for (size_t i = 0; i < activeSlots.size(); i++) {
+            const auto& slotWork = work[i];
+            Slot& slot = slots[slotWork.slot];
+
+            for (uint32_t face = 0; face < FACE_COUNT; face++) {
+                const uint32_t layer = slotWork.slot * FACE_COUNT + face;
+                const bool staticDirty = !slot.cacheValid[face] || slot.staticSignature[face] != slotWork.signature[face];
+                const bool dynamicNow = !slotWork.dynamicDraws[face].empty();
+
+                // Nothing moved and no dynamic casters to add or erase, last frame's face still holds
+                if (!staticDirty && !dynamicNow && !slot.hasDynamic[face]) continue;
+
+                if (staticDirty) {
+                    beginPass(cachePass, cacheFramebuffers[layer]);
+                    recordFaces(commandBuffer, slotWork.staticDraws[face], slotWork, layer);
+                    vkCmdEndRenderPass(commandBuffer);
+
+                    slot.staticSignature[face] = slotWork.signature[face];
+                    slot.cacheValid[face] = true;
+                    stats.staticFacesRendered++;
+                }
+
+                // Start from the cached static depth, then draw whatever moves on top
+                transitionLayer(commandBuffer, shadowImage, layer,
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+                VkImageCopy region{};
+                region.srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, layer, 1 };
+                region.dstSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, layer, 1 };
+                region.extent = { SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 1 };
+                vkCmdCopyImage(commandBuffer,
+                    cacheImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    shadowImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    1, &region);
+
+                transitionLayer(commandBuffer, shadowImage, layer,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+
+                beginPass(overlayPass, shadowFramebuffers[layer]);
+                recordFaces(commandBuffer, slotWork.dynamicDraws[face], slotWork, layer);
+                vkCmdEndRenderPass(commandBuffer);
+
+                slot.hasDynamic[face] = dynamicNow;
+                stats.facesUpdated++;
+            }
+        }
+    }
+
+    void PointShadowSystem::recordFaces(VkCommandBuffer commandBuffer, const std::vector<FaceDraw>& faceDraws, const SlotWork& slotWork, uint32_t layer) {
+        if (faceDraws.empty()) return;
+
+        ShadowPushConstants push{};
+        push.faceViewProjection = slots[slotWork.slot].faceViewProjection[layer % FACE_COUNT];
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ShadowPushConstants), &push);
+
+        for (const auto& draw : faceDraws) {
+            auto& model = *slotWork.instances[draw.instance].first->model;
+            model.bindSubmeshPositions(commandBuffer, draw.submeshIndex);
+            model.drawSubmesh(commandBuffer, draw.submeshIndex, slotWork.instanceBase + draw.instance, draw.lod);
+        }
+        ShadowStats::getInstance().casterDraws += static_cast<uint32_t>(faceDraws.size());
+    }
+
+    void PointShadowSystem::transitionLayer(VkCommandBuffer commandBuffer, VkImage image, uint32_t layer,
+        VkImageLayout oldLayout, VkImageLayout newLayout,
+        VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, layer, 1 };
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include "renderer/device.hpp"
+#include "renderer/frame_info.hpp"
+#include "renderer/buffer.hpp"
+#include "renderer/descriptors.hpp"
+#include "renderer/pipeline.hpp"
+#include "scene/game_object.hpp"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace grape {
+
+    // What the shadow pass did last frame
+    struct ShadowStats {
+        uint32_t shadowedLights = 0;
+        uint32_t staticFacesRendered = 0;   // Cache misses, static casters redrawn
+        uint32_t facesUpdated = 0;          // Faces recomposed from the cache (+ dynamic casters)
+        uint32_t casterDraws = 0;
+
+        static ShadowStats& getInstance() {
+            static ShadowStats instance;
+            return instance;
+        }
+    };
+
+    // Omnidirectional shadows for the point lights nearest the camera. Each shadowed light gets a
+    // slot of six layers in a depth array, one 90 degree face per axis (+X -X +Y -Y +Z -Z), which
+    // simple_shader.frag samples through set 3 together with the faces' view-projections.
+    //
+    // Static casters (anything without a dynamic physics body) are rendered into a cache that's only
+    // redrawn when the light or a static caster in that face changes. Dynamic casters are drawn on
+    // top of a copy of the cache whenever there are any. Casters are culled per light by its range
+    // and per face by the face frustum, so an object usually lands in one or two faces, not six
+    class PointShadowSystem {
+    public:
+        static constexpr uint32_t MAX_SHADOWED_LIGHTS = 8;
+        static constexpr uint32_t FACE_COUNT = 6;
+        static constexpr uint32_t LAYER_COUNT = MAX_SHADOWED_LIGHTS * FACE_COUNT;
+        static constexpr uint32_t SHADOW_MAP_SIZE = 512;
+        static constexpr uint32_t MAX_SHADOW_CASTERS = 8192;    // Per frame, over all lights
+        static constexpr float SHADOW_NEAR_CLIP = 0.05f;
+
+        PointShadowSystem(Device& device);
+        ~PointShadowSystem();
+
+        PointShadowSystem(const PointShadowSystem&) = delete;
+        PointShadowSystem& operator=(const PointShadowSystem&) = delete;
+
+        // Picks the lights that get shadows this frame and writes their slots into lights, which has
+        // to be in PointLightSystem::update's order. Call before the light clusters are uploaded
+        void assignLights(FrameInfo& frameInfo, std::vector<PointLight>& lights);
+
+        // Culls the casters and records every face that changed. Outside any render pass, before
+        // the viewport pass samples the maps
+        void render(FrameInfo& frameInfo);
+
+        VkDescriptorSetLayout getSetLayout() const { return shadowSetLayout->getDescriptorSetLayout(); }
+        VkDescriptorSet getDescriptorSet(int frameIndex) const { return shadowDescriptorSets[frameIndex]; }
+
+    private:
+        struct Slot {
+            bool used = false;
+            GameObject::id_t light = 0;
+            glm::vec4 sphere{ 0.f };    // Position and range the faces were built for
+            std::array<glm::mat4, FACE_COUNT> faceViewProjection{};
+            std::array<size_t, FACE_COUNT> staticSignature{};
+            std::array<bool, FACE_COUNT> cacheValid{};
+            std::array<bool, FACE_COUNT> hasDynamic{};  // The shadow layer still holds dynamic casters
+        };
+
+        struct Caster {
+            const GameObject* object;
+            GameObject::id_t id;
+            glm::vec3 worldMin;
+            glm::vec3 worldMax;
+            bool dynamic;
+        };
+
+        struct FaceDraw {
+            uint32_t instance;      // Entry in this slot's instance list
+            uint32_t submeshIndex;
+            uint32_t lod;
+        };
+
+        // Culling output of one slot, kept around for the capacity
+        struct SlotWork {
+            uint32_t slot;
+            std::vector<std::pair<const GameObject*, uint32_t>> instances;     // object, submesh
+            std::array<std::vector<FaceDraw>, FACE_COUNT> staticDraws;
+            std::array<std::vector<FaceDraw>, FACE_COUNT> dynamicDraws;
+            std::array<size_t, FACE_COUNT> signature;
+            uint32_t instanceBase;
+        };
+
+        void createShadowImages();
+        void createRenderPasses();
+        void createFramebuffers();
+        void createDescriptors();
+        void createPipeline();
+
+        void buildFaces(Slot& slot, const glm::vec4& sphere);
+        void cullSlot(SlotWork& work);
+        void recordFaces(VkCommandBuffer commandBuffer, const std::vector<FaceDraw>& faceDraws, const SlotWork& work, uint32_t layer);
+        void transitionLayer(VkCommandBuffer commandBuffer, VkImage image, uint32_t layer,
+            VkImageLayout oldLayout, VkImageLayout newLayout,
+            VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+        Device& device;
+
+        VkFormat shadowFormat = VK_FORMAT_D16_UNORM;
+
+        // shadowImage is what gets sampled, cacheImage holds the static casters of every face
+        VkImage shadowImage = VK_NULL_HANDLE;
+        VkDeviceMemory shadowMemory = VK_NULL_HANDLE;
+        VkImageView shadowArrayView = VK_NULL_HANDLE;
+        VkImage cacheImage = VK_NULL_HANDLE;
+        VkDeviceMemory cacheMemory = VK_NULL_HANDLE;
+        std::vector<VkImageView> shadowLayerViews;
+        std::vector<VkImageView> cacheLayerViews;
+        VkSampler shadowSampler = VK_NULL_HANDLE;
+
+        VkRenderPass cachePass = VK_NULL_HANDLE;    // Clears, leaves the layer ready to copy from
+        VkRenderPass overlayPass = VK_NULL_HANDLE;  // Loads the copied cache, leaves it ready to sample
+        std::vector<VkFramebuffer> cacheFramebuffers;
+        std::vector<VkFramebuffer> shadowFramebuffers;
+
+        std::unique_ptr<DescriptorPool> shadowPool;
+        std::unique_ptr<DescriptorSetLayout> shadowSetLayout;   // Set 3 of the simple render pipeline
+        std::unique_ptr<DescriptorSetLayout> casterSetLayout;
+        std::vector<std::unique_ptr<Buffer>> faceBuffers;       // Face view-projections, per frame
+        std::vector<std::unique_ptr<Buffer>> casterBuffers;     // Caster model matrices, per frame
+        std::vector<VkDescriptorSet> shadowDescriptorSets;
+        std::vector<VkDescriptorSet> casterDescriptorSets;
+
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        std::unique_ptr<Pipeline> shadowPipeline;
+
+        std::array<Slot, MAX_SHADOWED_LIGHTS> slots{};
+        std::vector<uint32_t> activeSlots;
+        std::vector<Caster> casters;
+        std::vector<SlotWork> work;
+        bool warnedCasterOverflow = false;
+    };
+}
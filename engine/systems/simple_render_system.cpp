@@ -1,4 +1,7 @@
 #include "simple_render_system.hpp"
+#include "renderer/swap_chain.hpp"
+#include "core/job_system.hpp"
+#include "core/perf_counters.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -8,14 +11,19 @@
 #include <stdexcept>
 #include <array>
 #include <cassert>
+#include <algorithm>
+#include <iostream>
 
 namespace grape {
 
-    SimpleRenderSystem::SimpleRenderSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) : grapeDevice{ device }
+    SimpleRenderSystem::SimpleRenderSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout lightSetLayout,
+        VkDescriptorSetLayout shadowSetLayout) : grapeDevice{ device }
     {
-        createPipelineLayout(globalSetLayout);
+        createObjectBuffers();
+        createPipelineLayout(globalSetLayout, lightSetLayout, shadowSetLayout);
         createPipeline(renderPass);
         createWireframePipeline(renderPass);  // Create wireframe pipeline
+        createDepthPrepassPipelines(renderPass);
     }
 
     SimpleRenderSystem::~SimpleRenderSystem()
@@ -23,14 +31,66 @@ namespace grape {
         vkDestroyPipelineLayout(grapeDevice.device(), pipelineLayout, nullptr);
     }
 
-    void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout)
+    void SimpleRenderSystem::createObjectBuffers()
+    {
+        objectPool = DescriptorPool::Builder(grapeDevice)
+            .setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+            .build();
+
+        objectSetLayout = DescriptorSetLayout::Builder(grapeDevice)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+            .build();
+
+        objectBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        objectDescriptorSets.resize(SwapChain::MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+        for (uint32_t i = 0; i < objectBuffers.size(); i++) {
+            createObjectBuffer(i, INITIAL_OBJECT_DRAWS);
+        }
+    }
+
+    void SimpleRenderSystem::createObjectBuffer(uint32_t frameIndex, uint32_t capacity)
+    {
+        objectBuffers[frameIndex] = std::make_unique<Buffer>(
+            grapeDevice,
+            sizeof(ObjectData),
+            capacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+        );
+        objectBuffers[frameIndex]->map();
+
+        auto bufferInfo = objectBuffers[frameIndex]->descriptorInfo();
+        DescriptorWriter writer(*objectSetLayout, *objectPool);
+        writer.writeBuffer(0, &bufferInfo);
+        if (objectDescriptorSets[frameIndex] != VK_NULL_HANDLE) {
+            writer.overwrite(objectDescriptorSets[frameIndex]);
+        }
+        else if (!writer.build(objectDescriptorSets[frameIndex])) {
+            throw std::runtime_error("failed to allocate object descriptor set!");
+        }
+    }
+
+    void SimpleRenderSystem::reserveObjectBuffer(uint32_t frameIndex, uint32_t drawCount)
+    {
+        uint32_t capacity = objectBuffers[frameIndex]->getInstanceCount();
+        if (drawCount <= capacity) return;
+
+        // This frame slot's fence has been waited on, so the GPU is done with its old buffer and set
+        while (capacity < drawCount) capacity *= 2;
+        std::cout << "Growing object buffer for frame " << frameIndex << " to " << capacity << " draws" << std::endl;
+        createObjectBuffer(frameIndex, capacity);
+    }
+
+    void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout lightSetLayout, VkDescriptorSetLayout shadowSetLayout)
     {
         VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
         pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(SimplePushConstantData);  // Now includes debugMode
+        pushConstantRange.size = sizeof(SimplePushConstantData);
 
-        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout };
+        // 0: global, 1: per-draw objects, 2: clustered lights, 3: point shadow maps
+        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout, objectSetLayout->getDescriptorSetLayout(), lightSetLayout, shadowSetLayout };
 
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -71,44 +131,215 @@ namespace grape {
         grapeWireframePipeline = std::make_unique<Pipeline>(grapeDevice, "resources/shaders/simple_shader.vert.spv", "resources/shaders/simple_shader.frag.spv", pipelineConfig);
     }
 
+    void SimpleRenderSystem::createDepthPrepassPipelines(VkRenderPass renderPass)
+    {
+        assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+        // Depth only: position stream, no fragment shader, color writes masked off
+        PipelineConfigInfo prepassConfig{};
+        Pipeline::defaultPipelineConfigInfo(prepassConfig);
+        prepassConfig.bindingDescriptions = Model::PackedVertex::getPositionBindingDescriptions();
+        prepassConfig.attributeDescriptions = Model::PackedVertex::getPositionAttributeDescriptions();
+        prepassConfig.colorBlendAttachment.colorWriteMask = 0;
+        prepassConfig.renderPass = renderPass;
+        prepassConfig.pipelineLayout = pipelineLayout;
+        depthPrepassPipeline = std::make_unique<Pipeline>(grapeDevice, "resources/shaders/depth_prepass.vert.spv", "", prepassConfig);
+
+        // Lit pass on top of the pre-pass depth, only the visible surface passes
+        PipelineConfigInfo equalConfig{};
+        Pipeline::defaultPipelineConfigInfo(equalConfig);
+        equalConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+        equalConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+        equalConfig.renderPass = renderPass;
+        equalConfig.pipelineLayout = pipelineLayout;
+        depthEqualPipeline = std::make_unique<Pipeline>(grapeDevice, "resources/shaders/simple_shader.vert.spv", "resources/shaders/simple_shader.frag.spv", equalConfig);
+
+        // Overdraw view, one per depth mode so it counts what the lit pass would actually shade
+        PipelineConfigInfo overdrawConfig{};
+        Pipeline::defaultPipelineConfigInfo(overdrawConfig);
+        overdrawConfig.colorBlendAttachment.blendEnable = VK_TRUE;
+        overdrawConfig.colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        overdrawConfig.colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        overdrawConfig.renderPass = renderPass;
+        overdrawConfig.pipelineLayout = pipelineLayout;
+        overdrawPipeline = std::make_unique<Pipeline>(grapeDevice, "resources/shaders/simple_shader.vert.spv", "resources/shaders/overdraw.frag.spv", overdrawConfig);
+
+        overdrawConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+        overdrawConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+        overdrawEqualPipeline = std::make_unique<Pipeline>(grapeDevice, "resources/shaders/simple_shader.vert.spv", "resources/shaders/overdraw.frag.spv", overdrawConfig);
+    }
+
     void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo)
     {
-        // Get debug settings
+        uint32_t drawCount = prepareDraws(frameInfo);
+        if (depthPrepassThisFrame) {
+            recordDepthPrepass(frameInfo, 0, drawCount);
+        }
+        recordDraws(frameInfo, 0, drawCount);
+    }
+
+    uint32_t SimpleRenderSystem::prepareDraws(FrameInfo& frameInfo, const DepthPyramid* occlusion)
+    {
+        // Latched once so every thread recording this frame agrees. Wireframe lines don't match the
+        // pre-pass depth, so it's skipped there
         const auto& debugSettings = DebugSettings::getInstance();
+        depthPrepassThisFrame = debugSettings.depthPrepass && !debugSettings.showWireframe;
 
-        // Choose pipeline based on wireframe mode
-        if (debugSettings.showWireframe && grapeWireframePipeline) {
-            grapeWireframePipeline->bind(frameInfo.commandBuffer);
+        // Gather is serial (it walks the map), culling and filling the object data are the parts worth spreading out
+        candidates.clear();
+        for (auto& kv : frameInfo.gameObjects) {
+            if (kv.second.model != nullptr) {
+                candidates.push_back(&kv.second);
+            }
         }
-        else {
-            grapePipeline->bind(frameInfo.commandBuffer);
+
+        enum Visibility : uint8_t { VISIBLE, FRUSTUM_CULLED, OCCLUSION_CULLED };
+        visibility.assign(candidates.size(), VISIBLE);
+        lodScales.assign(candidates.size(), 0.f);
+
+        const bool frustumCulling = debugSettings.frustumCulling;
+        const DepthPyramid* pyramid = debugSettings.occlusionCulling && occlusion && occlusion->isValid() ? occlusion : nullptr;
+        const Frustum frustum(frameInfo.camera.getProjection() * frameInfo.camera.getView());
+
+        // Model units -> pixels at distance 1, LOD errors are compared in pixels
+        const bool selectLods = debugSettings.meshLods && frameInfo.viewportExtent.height > 0;
+        const float pixelsPerUnit = 0.5f * static_cast<float>(frameInfo.viewportExtent.height) * std::abs(frameInfo.camera.getProjection()[1][1]);
+        const glm::vec3 cameraPosition = glm::vec3(frameInfo.camera.getInverseView()[3]);
+        const float nearClip = frameInfo.camera.getNearClip();
+
+        JobSystem::getInstance().parallelFor(candidates.size(), 256, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const auto& obj = *candidates[i];
+                const glm::mat4 transform = obj.transform.mat4();
+
+                glm::vec3 localMin, localMax, worldMin, worldMax;
+                obj.model->getBoundingBox(localMin, localMax);
+                transformBounds(transform, localMin, localMax, worldMin, worldMax);
+
+                if (frustumCulling && !frustum.intersectsBox(worldMin, worldMax)) {
+                    visibility[i] = FRUSTUM_CULLED;
+                    continue;
+                }
+                if (pyramid && pyramid->isOccluded(worldMin, worldMax)) {
+                    visibility[i] = OCCLUSION_CULLED;
+                    continue;
+                }
+
+                if (selectLods) {
+                    // Nearest point of the box, so a big object we're standing next to stays detailed
+                    glm::vec3 closest = glm::clamp(cameraPosition, worldMin, worldMax);
+                    float distance = std::max(glm::length(closest - cameraPosition), nearClip);
+                    float scale = std::max(glm::length(glm::vec3(transform[0])),
+                        std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+                    lodScales[i] = scale * pixelsPerUnit / distance;
+                }
+            }
+        });
+
+        auto& stats = CullingStats::getInstance();
+        stats = CullingStats{};
+        stats.objects = static_cast<uint32_t>(candidates.size());
+
+        draws.clear();
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (visibility[i] == FRUSTUM_CULLED) {
+                stats.frustumCulled++;
+                continue;
+            }
+            if (visibility[i] == OCCLUSION_CULLED) {
+                stats.occlusionCulled++;
+                continue;
+            }
+
+            const auto& obj = *candidates[i];
+            const auto& submeshes = obj.model->getSubmeshes();
+            for (uint32_t submesh = 0; submesh < submeshes.size(); ++submesh) {
+                // Coarsest level whose error still projects under the threshold
+                const auto& lods = submeshes[submesh].lods;
+                uint32_t lod = 0;
+                if (selectLods) {
+                    while (lod + 1 < lods.size() && lods[lod + 1].error * lodScales[i] <= debugSettings.lodErrorPixels) {
+                        lod++;
+                    }
+                }
+
+                draws.push_back({ &obj, submesh, lod, false });
+                stats.triangles += (lods.empty() ? submeshes[submesh].indexCount : lods[lod].indexCount) / 3;
+                if (lod > 0) stats.reducedLodDraws++;
+            }
         }
+        stats.submeshDraws = static_cast<uint32_t>(draws.size());
 
-        vkCmdBindDescriptorSets(
-            frameInfo.commandBuffer,
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            pipelineLayout,
-            0, 1,
-            &frameInfo.globalDescriptorSet,
-            0, nullptr
-        );
+        // Dense submeshes at LOD 0 get a second, finer pass over their meshlets. Neighbouring visible
+        // meshlets are merged into one range, so a mostly visible mesh still costs a handful of draws
+        if (debugSettings.meshletCulling) {
+            if (drawRanges.size() < draws.size()) drawRanges.resize(draws.size());
+            meshletResults.assign(draws.size(), MeshletCullResult{ 0, 0, 0 });
 
-        for (auto& kv : frameInfo.gameObjects) {
-            auto& obj = kv.second;
-            if (obj.model == nullptr) continue;
+            JobSystem::getInstance().parallelFor(draws.size(), 16, [&](size_t begin, size_t end) {
+                for (size_t drawIndex = begin; drawIndex < end; drawIndex++) {
+                    auto& draw = draws[drawIndex];
+                    const auto& submesh = draw.object->model->getSubmeshes()[draw.submeshIndex];
+                    if (draw.lod != 0 || submesh.meshlets.empty()) continue;
+
+                    const glm::mat4 transform = draw.object->transform.mat4();
+
+                    // The cone test runs in model space, which only keeps angles under uniform scale
+                    glm::vec3 axisScale{ glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) };
+                    float maxScale = std::max(axisScale.x, std::max(axisScale.y, axisScale.z));
+                    float minScale = std::min(axisScale.x, std::min(axisScale.y, axisScale.z));
+                    bool coneTest = debugSettings.meshletConeCulling && maxScale - minScale <= 0.01f * maxScale;
+                    glm::vec3 localCamera = coneTest ? glm::vec3(glm::inverse(transform) * glm::vec4(cameraPosition, 1.f)) : glm::vec3(0.f);
 
-            // Push constants for the entire object (common data)
-            SimplePushConstantData push{};
-            push.modelMatrix = obj.transform.mat4();
-            push.normalMatrix = obj.transform.normalMatrix();
-            push.debugMode = static_cast<int>(debugSettings.currentMode);  // Set debug mode
+                    auto& ranges = drawRanges[drawIndex];
+                    auto& result = meshletResults[drawIndex];
+                    ranges.clear();
 
-            // Get the texture paths from the model
-            const auto& modelTexturePaths = obj.model->getTexturePaths();
+                    for (const auto& meshlet : submesh.meshlets) {
+                        result.tested++;
 
-            // Render each submesh with its corresponding texture
-            for (size_t i = 0; i < obj.model->getSubmeshes().size(); ++i) {
-                const auto& submesh = obj.model->getSubmeshes()[i];
+                        bool visible = !(coneTest && isMeshletBackfacing(meshlet, localCamera));
+                        if (visible && (frustumCulling || pyramid)) {
+                            glm::vec3 worldMin, worldMax;
+                            transformBounds(transform, meshlet.boundsMin, meshlet.boundsMax, worldMin, worldMax);
+                            visible = (!frustumCulling || frustum.intersectsBox(worldMin, worldMax)) &&
+                                (!pyramid || !pyramid->isOccluded(worldMin, worldMax));
+                        }
+
+                        if (!visible) {
+                            result.culled++;
+                            result.culledTriangles += meshlet.indexCount / 3;
+                        }
+                        else if (!ranges.empty() && ranges.back().firstIndex + ranges.back().indexCount == meshlet.firstIndex) {
+                            ranges.back().indexCount += meshlet.indexCount;
+                        }
+                        else {
+                            ranges.push_back({ meshlet.firstIndex, meshlet.indexCount });
+                        }
+                    }
+
+                    draw.clustered = true;
+                }
+            });
+
+            for (const auto& result : meshletResults) {
+                stats.meshletsTested += result.tested;
+                stats.meshletsCulled += result.culled;
+                stats.triangles -= result.culledTriangles;
+            }
+        }
+
+        reserveObjectBuffer(static_cast<uint32_t>(frameInfo.frameIndex), static_cast<uint32_t>(draws.size()));
+        auto* objectData = static_cast<ObjectData*>(objectBuffers[frameInfo.frameIndex]->getMappedMemory());
+
+        JobSystem::getInstance().parallelFor(draws.size(), 512, [&](size_t begin, size_t end) {
+            for (size_t drawIndex = begin; drawIndex < end; drawIndex++) {
+                const auto& draw = draws[drawIndex];
+                const auto& obj = *draw.object;
+                const auto& submesh = obj.model->getSubmeshes()[draw.submeshIndex];
+
+                // Get the texture paths from the model
+                const auto& modelTexturePaths = obj.model->getTexturePaths();
 
                 // Find the correct texture index for this material
                 int textureIndex = 0; // Default fallback texture
@@ -120,28 +351,117 @@ namespace grape {
                     textureIndex = frameInfo.getTextureIndex(texturePath);
 
 #ifdef DEBUG_RENDERING
-                    std::cout << "Rendering submesh " << i << ": materialId=" << submesh.materialId
+                    std::cout << "Rendering submesh " << draw.submeshIndex << ": materialId=" << submesh.materialId
                         << ", texture='" << texturePath << "', descriptorIndex=" << textureIndex << std::endl;
 #endif
                 }
 
-                push.imgIndex = textureIndex;
+                const glm::mat3 normalMatrix = obj.transform.normalMatrix();
+
+                ObjectData& data = objectData[drawIndex];
+                // Positions come in quantized to the submesh bounds, undo that as part of the model matrix
+                data.modelMatrix = obj.transform.mat4() * submesh.dequantize;
+                data.normalMatrix[0] = glm::vec4(normalMatrix[0], 0.f);
+                data.normalMatrix[1] = glm::vec4(normalMatrix[1], 0.f);
+                data.normalMatrix[2] = glm::vec4(normalMatrix[2], 0.f);
+                data.materialIndex = textureIndex;
+                data.flags = textureIndex == 0 ? OBJECT_FLAG_FALLBACK_TEXTURE : OBJECT_FLAG_NONE;
+                if (submesh.colorBuffer) data.flags |= OBJECT_FLAG_VERTEX_COLOR;
+                data.vertexColor = submesh.constantColor;
+            }
+        });
+
+        if (!draws.empty()) {
+            objectBuffers[frameInfo.frameIndex]->flush();
+        }
+
+        return static_cast<uint32_t>(draws.size());
+    }
 
-                // Bind vertex and index buffers for this submesh
-                obj.model->bindSubmesh(frameInfo.commandBuffer, i);
+    void SimpleRenderSystem::recordDepthPrepass(FrameInfo& frameInfo, uint32_t begin, uint32_t end)
+    {
+        depthPrepassPipeline->bind(frameInfo.commandBuffer);
+        bindFrameState(frameInfo);
 
-                // Push constants for this specific submesh
-                vkCmdPushConstants(
-                    frameInfo.commandBuffer,
-                    pipelineLayout,
-                    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                    0,
-                    sizeof(SimplePushConstantData),
-                    &push);
+        for (uint32_t drawIndex = begin; drawIndex < end; drawIndex++) {
+            const auto& draw = draws[drawIndex];
+            if (draw.clustered && drawRanges[drawIndex].empty()) continue;
 
-                // Draw this submesh
-                obj.model->drawSubmesh(frameInfo.commandBuffer, i);
-            }
+            draw.object->model->bindSubmeshPositions(frameInfo.commandBuffer, draw.submeshIndex);
+            issueDraw(frameInfo.commandBuffer, drawIndex);
+        }
+    }
+
+    void SimpleRenderSystem::recordDraws(FrameInfo& frameInfo, uint32_t begin, uint32_t end)
+    {
+        // Get debug settings
+        const auto& debugSettings = DebugSettings::getInstance();
+
+        // Choose pipeline based on wireframe mode, the overdraw view and whether depth is already laid down
+        if (debugSettings.showWireframe && grapeWireframePipeline) {
+            grapeWireframePipeline->bind(frameInfo.commandBuffer);
         }
+        else if (debugSettings.currentMode == DebugMode::OVERDRAW) {
+            (depthPrepassThisFrame ? overdrawEqualPipeline : overdrawPipeline)->bind(frameInfo.commandBuffer);
+        }
+        else if (depthPrepassThisFrame) {
+            depthEqualPipeline->bind(frameInfo.commandBuffer);
+        }
+        else {
+            grapePipeline->bind(frameInfo.commandBuffer);
+        }
+
+        bindFrameState(frameInfo);
+
+        for (uint32_t drawIndex = begin; drawIndex < end; drawIndex++) {
+            const auto& draw = draws[drawIndex];
+            if (draw.clustered && drawRanges[drawIndex].empty()) continue;
+
+            // Bind vertex and index buffers for this submesh
+            draw.object->model->bindSubmesh(frameInfo.commandBuffer, draw.submeshIndex);
+
+            // The draw's firstInstance selects its entry in the object buffer
+            issueDraw(frameInfo.commandBuffer, drawIndex);
+        }
+    }
+
+    void SimpleRenderSystem::issueDraw(VkCommandBuffer commandBuffer, uint32_t drawIndex)
+    {
+        const auto& draw = draws[drawIndex];
+        if (!draw.clustered) {
+            draw.object->model->drawSubmesh(commandBuffer, draw.submeshIndex, drawIndex, draw.lod);
+            return;
+        }
+
+        for (const auto& range : drawRanges[drawIndex]) {
+            draw.object->model->drawIndexRange(commandBuffer, range.firstIndex, range.indexCount, drawIndex);
+        }
+    }
+
+    void SimpleRenderSystem::bindFrameState(FrameInfo& frameInfo)
+    {
+        const auto& debugSettings = DebugSettings::getInstance();
+
+        VkDescriptorSet descriptorSets[] = { frameInfo.globalDescriptorSet, objectDescriptorSets[frameInfo.frameIndex], frameInfo.lightDescriptorSet, frameInfo.shadowDescriptorSet };
+        vkCmdBindDescriptorSets(
+            frameInfo.commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout,
+            0, 4,
+            descriptorSets,
+            0, nullptr
+        );
+        PerfCounters::add(PerfCounter::DescriptorSetBinds);
+
+        // Frame-wide state is pushed once, not per draw
+        SimplePushConstantData push{};
+        push.debugMode = static_cast<int>(debugSettings.currentMode);
+        vkCmdPushConstants(
+            frameInfo.commandBuffer,
+            pipelineLayout,
+            VK_SHADER_STAGE_FRAGMENT_BIT,
+            0,
+            sizeof(SimplePushConstantData),
+            &push);
     }
 }
\ No newline at end of file
@@ -3,6 +3,9 @@
 #include "renderer/pipeline.hpp"
 #include "renderer/device.hpp"
 #include "renderer/frame_info.hpp"
+#include "renderer/buffer.hpp"
+#include "renderer/descriptors.hpp"
+#include "renderer/culling.hpp"
 #include "scene/game_object.hpp"
 #include <memory>
 #include <vector>
@@ -19,13 +22,24 @@ namespace grape {
         SHOW_LIGHT_DIRECTION = 5,
         SHOW_DOT_PRODUCT = 6,
         TEXTURE_ONLY = 7,
-        LIGHTING_ONLY = 8
+        LIGHTING_ONLY = 8,
+        CLUSTER_LIGHT_COUNT = 9,
+        OVERDRAW = 10
     };
 
     struct DebugSettings {
         DebugMode currentMode = DebugMode::NORMAL;
         bool showWireframe = false;
         bool showPhysicsDebug = false;
+        bool depthPrepass = true;   // Lay down depth first so the lit pass shades each pixel once
+        bool frustumCulling = true;
+        bool occlusionCulling = true;   // Test against a depth pyramid from an earlier frame
+        bool meshLods = true;
+        bool meshletCulling = true;         // Per-cluster frustum/occlusion tests on dense meshes
+        bool meshletConeCulling = false;    // Backfacing clusters, only right for closed single-sided meshes
+        bool pointShadows = true;       // Cube shadow maps for the point lights nearest the camera
+        float lodErrorPixels = 1.0f;    // Coarsest LOD whose simplification error stays under this on screen
+        bool showPerfHud = true;        // Frame time percentiles and counters over the viewport
 
         // Singleton pattern for easy access
         static DebugSettings& getInstance() {
@@ -34,30 +48,117 @@ namespace grape {
         }
     };
 
-    // Updated push constant structure
-    struct SimplePushConstantData {
+    // What prepareDraws did with the scene last frame, culling is counted per object
+    struct CullingStats {
+        uint32_t objects = 0;
+        uint32_t frustumCulled = 0;
+        uint32_t occlusionCulled = 0;
+        uint32_t submeshDraws = 0;
+        uint32_t reducedLodDraws = 0;   // Draws using something coarser than LOD 0
+        uint32_t triangles = 0;         // After meshlet culling
+        uint32_t meshletsTested = 0;
+        uint32_t meshletsCulled = 0;
+
+        static CullingStats& getInstance() {
+            static CullingStats instance;
+            return instance;
+        }
+    };
+
+    // Per-draw data, written once per frame into a storage buffer and indexed
+    // in the vertex shader with gl_InstanceIndex (the draw's firstInstance).
+    // Layout must match ObjectData in simple_shader.vert (std430, 128 bytes)
+    struct alignas(16) ObjectData {
         glm::mat4 modelMatrix{ 1.f };
-        glm::mat4 normalMatrix{ 1.f };
-        alignas(4) int imgIndex{ 0 };
-        alignas(4) int debugMode{ 0 };  // Added debug mode
+        glm::vec4 normalMatrix[3]{};    // mat3 stored as 3 padded columns
+        alignas(4) int materialIndex{ 0 };
+        alignas(4) uint32_t flags{ 0 };
+        alignas(4) uint32_t vertexColor{ 0xffffffff };  // RGBA8, used when the submesh has no color stream
+    };
+
+    enum ObjectFlags : uint32_t {
+        OBJECT_FLAG_NONE = 0,
+        OBJECT_FLAG_FALLBACK_TEXTURE = 1 << 0,
+        OBJECT_FLAG_VERTEX_COLOR = 1 << 1     // Read color from the vertex stream instead of vertexColor
+    };
+
+    // Everything per-object lives in the object buffer now, only frame-wide state is pushed
+    struct SimplePushConstantData {
+        alignas(4) int debugMode{ 0 };
     };
 
     class SimpleRenderSystem {
     public:
-        SimpleRenderSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+        SimpleRenderSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout lightSetLayout,
+            VkDescriptorSetLayout shadowSetLayout);
         ~SimpleRenderSystem();
         SimpleRenderSystem(const SimpleRenderSystem&) = delete;
         SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
         void renderGameObjects(FrameInfo& frameInfo);
 
+        // Split version of renderGameObjects for parallel recording: prepareDraws gathers the
+        // submeshes and fills the object buffer, then recordDraws can be called from several
+        // threads on disjoint ranges, each with its own command buffer. Objects outside the camera
+        // frustum or hidden behind the occlusion pyramid's depth are dropped here
+        uint32_t prepareDraws(FrameInfo& frameInfo, const DepthPyramid* occlusion = nullptr);
+        void recordDraws(FrameInfo& frameInfo, uint32_t begin, uint32_t end);
+
+        // Depth-only pass over the same draws. When it's on, every recordDepthPrepass range has to
+        // be recorded before any recordDraws range since shading tests depth with EQUAL
+        void recordDepthPrepass(FrameInfo& frameInfo, uint32_t begin, uint32_t end);
+        bool usesDepthPrepass() const { return depthPrepassThisFrame; }
+
+        // Starting size of each per-frame object buffer, it doubles when a frame has more draws
+        static constexpr uint32_t INITIAL_OBJECT_DRAWS = 4096;
+
     private:
-        void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
+        struct DrawItem {
+            const GameObject* object;
+            uint32_t submeshIndex;
+            uint32_t lod;
+            bool clustered;     // Draws drawRanges[drawIndex] instead of the whole LOD
+        };
+
+        struct IndexRange {
+            uint32_t firstIndex;
+            uint32_t indexCount;
+        };
+
+        struct MeshletCullResult {
+            uint32_t tested;
+            uint32_t culled;
+            uint32_t culledTriangles;
+        };
+
+        void createObjectBuffers();
+        void createObjectBuffer(uint32_t frameIndex, uint32_t capacity);
+        void reserveObjectBuffer(uint32_t frameIndex, uint32_t drawCount);
+        void createPipelineLayout(VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout lightSetLayout, VkDescriptorSetLayout shadowSetLayout);
         void createPipeline(VkRenderPass renderPass);
         void createWireframePipeline(VkRenderPass renderPass);  // Optional: for wireframe support
+        void createDepthPrepassPipelines(VkRenderPass renderPass);
+        void bindFrameState(FrameInfo& frameInfo);
+        void issueDraw(VkCommandBuffer commandBuffer, uint32_t drawIndex);
 
         Device& grapeDevice;
         std::unique_ptr<Pipeline> grapePipeline;
         std::unique_ptr<Pipeline> grapeWireframePipeline;  // Optional: for wireframe support
+        std::unique_ptr<Pipeline> depthPrepassPipeline;     // Positions only, no fragment shader
+        std::unique_ptr<Pipeline> depthEqualPipeline;       // Lit pass after the pre-pass, EQUAL test, no depth writes
+        std::unique_ptr<Pipeline> overdrawPipeline;         // Additive fragment counter
+        std::unique_ptr<Pipeline> overdrawEqualPipeline;
         VkPipelineLayout pipelineLayout;
+
+        std::unique_ptr<DescriptorPool> objectPool;
+        std::unique_ptr<DescriptorSetLayout> objectSetLayout;
+        std::vector<std::unique_ptr<Buffer>> objectBuffers;
+        std::vector<VkDescriptorSet> objectDescriptorSets;
+        std::vector<DrawItem> draws;
+        std::vector<const GameObject*> candidates;
+        std::vector<uint8_t> visibility;
+        std::vector<float> lodScales;   // Pixels per model unit of error, per candidate
+        std::vector<std::vector<IndexRange>> drawRanges;    // Visible meshlet runs, kept around for their capacity
+        std::vector<MeshletCullResult> meshletResults;
+        bool depthPrepassThisFrame = false;
     };
 }
\ No newline at end of file
@@ -2,9 +2,20 @@
 #include "imgui/imgui_impl_glfw.h"
 #include "imgui/imgui_impl_vulkan.h"
 #include "systems/simple_render_system.hpp"
+#include "systems/point_shadow_system.hpp"
+#include "renderer/renderer.hpp"
+#include "scene/simulation_thread.hpp"
+#include "core/profiler.hpp"
+#include "core/memory_tracker.hpp"
+#include "core/perf_counters.hpp"
+#include "renderer/gpu_profiler.hpp"
 
 #include <stdexcept>
 #include <unordered_map>
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <string_view>
 
 namespace grape {
 
@@ -13,15 +24,48 @@ namespace {
     VkDescriptorPool imguiDescriptorPool = VK_NULL_HANDLE;
     bool imguiInitialized = false;
     VkDevice imguiDevice = VK_NULL_HANDLE;
+    uint32_t imguiDescriptorCount = 0;
     std::unordered_map<uint32_t, GameObject>* s_gameObjects = nullptr;
     int s_selectedObjectIndex = -1;
     uint32_t s_selectedObjectId = 0;
     std::vector<std::string> s_availableMaterials = { "Default Material" };
+    const Renderer* s_renderer = nullptr;
+    SimulationThread* s_simulation = nullptr;
+
+    // ImGui allocates through these so its windows, draw lists and fonts count as UI memory
+    void* imguiAlloc(size_t size, void*) {
+        GRAPE_MEMORY_SCOPE(MemoryTag::UI);
+        return ::operator new(size);
+    }
+
+    void imguiFree(void* ptr, void*) {
+        ::operator delete(ptr);
+    }
+
+    void memoryRow(const char* name, const MemoryStats& stats, bool showPeak = true) {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(name);
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(MemoryTracker::formatBytes(static_cast<double>(stats.currentBytes)).c_str());
+        ImGui::TableNextColumn();
+        if (showPeak) ImGui::TextUnformatted(MemoryTracker::formatBytes(static_cast<double>(stats.peakBytes)).c_str());
+        else ImGui::TextDisabled("-");
+        ImGui::TableNextColumn();
+        ImGui::Text("%lld", static_cast<long long>(stats.liveAllocations));
+        ImGui::TableNextColumn();
+        ImGui::Text("%s/s", MemoryTracker::formatBytes(stats.bytesPerSecond).c_str());
+        ImGui::TableNextColumn();
+        ImGui::Text("%.0f/s", stats.allocationsPerSecond);
+    }
 }
 
 void UI::init(GLFWwindow* window, VkInstance instance, VkDevice device, VkPhysicalDevice physicalDevice,
               VkRenderPass renderPass, VkQueue queue, uint32_t imageCount) {
+    GRAPE_MEMORY_SCOPE(MemoryTag::UI);
+
     IMGUI_CHECKVERSION();
+    ImGui::SetAllocatorFunctions(imguiAlloc, imguiFree);
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO();
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
@@ -98,6 +142,8 @@ void UI::init(GLFWwindow* window, VkInstance instance, VkDevice device, VkPhysic
     if (vkCreateDescriptorPool(device, &pool_info, nullptr, &imguiDescriptorPool) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create ImGui descriptor pool!");
     }
+    for (const auto& poolSize : pool_sizes) imguiDescriptorCount += poolSize.descriptorCount;
+    MemoryTracker::getInstance().recordDescriptorPool(1, imguiDescriptorCount);
 
     ImGui_ImplVulkan_InitInfo info = {};
     info.Instance = instance;
@@ -151,6 +197,8 @@ void UI::shutdown() {
     if (imguiDevice && imguiDescriptorPool) {
         vkDestroyDescriptorPool(imguiDevice, imguiDescriptorPool, nullptr);
         imguiDescriptorPool = VK_NULL_HANDLE;
+        MemoryTracker::getInstance().recordDescriptorPool(-1, -static_cast<int64_t>(imguiDescriptorCount));
+        imguiDescriptorCount = 0;
     }
     imguiInitialized = false;
 }
@@ -159,6 +207,9 @@ void UI::renderUI() {
     renderDockspace();
     renderModelsPanel();
     renderDebugPanel();
+    renderProfilerPanel();
+    renderMemoryPanel();
+    renderPerfHud();
     renderContentBrowser();
     renderSceneInspector();
 }
@@ -181,7 +232,9 @@ void UI::renderDebugPanel() {
         "Show Light Direction",
         "Show Dot Product",
         "Texture Only",
-        "Lighting Only"
+        "Lighting Only",
+        "Cluster Light Count",
+        "Overdraw"
     };
 
     int currentModeIndex = static_cast<int>(debugSettings.currentMode);
@@ -200,13 +253,17 @@ void UI::renderDebugPanel() {
             "Visualize light direction vectors",
             "Show dot product between normals and light",
             "Display textures without lighting",
-            "Show only lighting contribution"
+            "Show only lighting contribution",
+            "Heatmap of how many lights each cluster evaluates",
+            "How many times each pixel gets shaded (red ~8, yellow ~16, white 32+)"
         };
         ImGui::SetTooltip("%s", descriptions[currentModeIndex]);
     }
 
     ImGui::Separator();
 
+    ImGui::Checkbox("Perf HUD", &debugSettings.showPerfHud);
+
     // Other debug toggles
     ImGui::Text("Rendering Options:");
     ImGui::Checkbox("Wireframe Mode", &debugSettings.showWireframe);
@@ -214,6 +271,47 @@ void UI::renderDebugPanel() {
         ImGui::SetTooltip("Toggle wireframe rendering (requires pipeline recreation)");
     }
 
+    ImGui::Checkbox("Depth Pre-pass", &debugSettings.depthPrepass);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Depth-only pass first, then shade with an EQUAL depth test (compare with the Overdraw view)");
+    }
+
+    ImGui::Checkbox("Frustum Culling", &debugSettings.frustumCulling);
+    ImGui::SameLine();
+    ImGui::Checkbox("Occlusion Culling", &debugSettings.occlusionCulling);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Skip objects hidden behind the depth of an earlier frame (can pop for a frame on fast disocclusion)");
+    }
+
+    ImGui::Checkbox("Mesh LODs", &debugSettings.meshLods);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(120.0f);
+    ImGui::SliderFloat("LOD Error (px)", &debugSettings.lodErrorPixels, 0.25f, 8.0f, "%.2f");
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Use the coarsest LOD whose simplification error projects to less than this many pixels");
+    }
+
+    const auto& cullingStats = CullingStats::getInstance();
+    ImGui::Text("Objects: %u  frustum culled: %u  occluded: %u  draws: %u",
+        cullingStats.objects, cullingStats.frustumCulled, cullingStats.occlusionCulled, cullingStats.submeshDraws);
+    ImGui::Text("Triangles: %u  reduced LOD draws: %u", cullingStats.triangles, cullingStats.reducedLodDraws);
+
+    ImGui::Checkbox("Meshlet Culling", &debugSettings.meshletCulling);
+    ImGui::SameLine();
+    ImGui::Checkbox("Cone Culling", &debugSettings.meshletConeCulling);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Skip meshlets facing away from the camera. Meshes are drawn double-sided, so only use on closed ones");
+    }
+    ImGui::Text("Meshlets: %u  culled: %u", cullingStats.meshletsTested, cullingStats.meshletsCulled);
+
+    ImGui::Checkbox("Point Light Shadows", &debugSettings.pointShadows);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Cube shadow maps for the nearest point lights, static casters are cached until something in range moves");
+    }
+    const auto& shadowStats = ShadowStats::getInstance();
+    ImGui::Text("Shadowed lights: %u  static faces redrawn: %u  faces updated: %u  caster draws: %u",
+        shadowStats.shadowedLights, shadowStats.staticFacesRendered, shadowStats.facesUpdated, shadowStats.casterDraws);
+
     ImGui::Checkbox("Physics Debug", &debugSettings.showPhysicsDebug);
     if (ImGui::IsItemHovered()) {
         ImGui::SetTooltip("Show physics collision shapes and debug info");
@@ -254,6 +352,44 @@ void UI::renderDebugPanel() {
     ImGui::Text("Frame Rate: %.1f FPS", io.Framerate);
     ImGui::Text("Frame Time: %.3f ms", 1000.0f / io.Framerate);
 
+    ImGui::Separator();
+
+    // Frame pacing, applied by the renderer before the next frame
+    auto& pacing = FramePacingSettings::getInstance();
+    ImGui::Text("Frame Pacing:");
+
+    const VkPresentModeKHR presentModes[] = {
+        VK_PRESENT_MODE_FIFO_KHR,
+        VK_PRESENT_MODE_FIFO_RELAXED_KHR,
+        VK_PRESENT_MODE_MAILBOX_KHR,
+        VK_PRESENT_MODE_IMMEDIATE_KHR
+    };
+    const char* presentModeNames[] = { "V-Sync", "V-Sync (Relaxed)", "Mailbox", "Immediate" };
+
+    int presentModeIndex = 0;
+    for (int i = 0; i < IM_ARRAYSIZE(presentModes); i++) {
+        if (presentModes[i] == pacing.presentMode) presentModeIndex = i;
+    }
+    if (ImGui::Combo("Present Mode", &presentModeIndex, presentModeNames, IM_ARRAYSIZE(presentModeNames))) {
+        pacing.presentMode = presentModes[presentModeIndex];
+    }
+
+    ImGui::SliderInt("Frames In Flight", &pacing.framesInFlight, 1, SwapChain::MAX_FRAMES_IN_FLIGHT);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Fewer frames lowers latency, more frames smooths out CPU spikes");
+    }
+
+    ImGui::InputInt("FPS Limit", &pacing.frameRateLimit, 10, 60);
+    pacing.frameRateLimit = std::max(0, pacing.frameRateLimit);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("0 = uncapped");
+    }
+
+    if (s_renderer) {
+        ImGui::Text("Active Present Mode: %s", SwapChain::presentModeName(s_renderer->getPresentMode()));
+        ImGui::Text("Input To Present: %.2f ms", s_renderer->getInputToPresentLatency());
+    }
+
     // Physics debug info
     if (debugSettings.showPhysicsDebug) {
         ImGui::Separator();
@@ -268,6 +404,270 @@ void UI::renderDebugPanel() {
     ImGui::End();
 }
 
+void UI::renderProfilerPanel() {
+    static int frameOffset = 0;         // 0 = newest frame
+    static float zoom = 1.f;
+    static std::string exportStatus;
+
+    auto& profiler = Profiler::getInstance();
+
+    ImGui::Begin("Profiler");
+
+#if !GRAPE_PROFILER
+    ImGui::TextDisabled("Profiler zones are compiled out (GRAPE_PROFILER=0)");
+#endif
+
+    bool paused = profiler.isPaused();
+    if (ImGui::Checkbox("Pause", &paused)) {
+        profiler.setPaused(paused);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export Chrome Trace")) {
+        const char* path = "grape_trace.json";
+        exportStatus = profiler.exportChromeTrace(path)
+            ? std::string("Wrote ") + path + " (open in chrome://tracing or ui.perfetto.dev)"
+            : std::string("Failed to write ") + path;
+    }
+    if (!exportStatus.empty()) {
+        ImGui::TextDisabled("%s", exportStatus.c_str());
+    }
+
+    const auto& frames = profiler.getFrames();
+    if (frames.size() < 2) {
+        ImGui::Text("Waiting for frames...");
+        ImGui::End();
+        return;
+    }
+
+    std::vector<float> frameTimes;
+    frameTimes.reserve(frames.size());
+    for (const auto& frame : frames) {
+        frameTimes.push_back(static_cast<float>(frame.endNs - frame.startNs) / 1e6f);
+    }
+
+    int frameCount = static_cast<int>(frames.size());
+    frameOffset = std::clamp(frameOffset, 0, frameCount - 1);
+    ImGui::PlotHistogram("##FrameTimes", frameTimes.data(), frameCount, 0, "Frame times (ms)", 0.f, 33.3f,
+        ImVec2(ImGui::GetContentRegionAvail().x, 60.f));
+    ImGui::SliderInt("Frames Back", &frameOffset, 0, frameCount - 1);
+    ImGui::SliderFloat("Zoom", &zoom, 1.f, 20.f, "%.1fx", ImGuiSliderFlags_Logarithmic);
+
+    const ProfileFrame& frame = frames[frameCount - 1 - frameOffset];
+    double frameMs = static_cast<double>(frame.endNs - frame.startNs) / 1e6;
+    ImGui::Text("Frame: %.2f ms, %zu zones", frameMs, frame.zones.size());
+
+    // GPU passes of the latest frame the queries have come back for, a couple of frames behind
+    const auto& gpuStats = GpuProfileStats::getInstance();
+    if (ImGui::CollapsingHeader("GPU", ImGuiTreeNodeFlags_DefaultOpen)) {
+        if (!gpuStats.timestampsSupported) {
+            ImGui::TextDisabled("Timestamps not supported on this queue");
+        }
+        else {
+            ImGui::Text("GPU Frame: %.3f ms", gpuStats.frameMs);
+            for (const auto& pass : gpuStats.passes) {
+                ImGui::Indent(pass.depth * 12.f + 1.f);
+                float fraction = gpuStats.frameMs > 0.0 ? static_cast<float>(pass.durationMs / gpuStats.frameMs) : 0.f;
+                char overlay[64];
+                std::snprintf(overlay, sizeof(overlay), "%.3f ms", pass.durationMs);
+                ImGui::ProgressBar(fraction, ImVec2(160.f, 0.f), overlay);
+                ImGui::SameLine();
+                ImGui::TextUnformatted(pass.name);
+                ImGui::Unindent(pass.depth * 12.f + 1.f);
+            }
+        }
+
+        if (gpuStats.statisticsValid) {
+            const auto& statistics = gpuStats.viewportStatistics;
+            ImGui::Text("Viewport Primitives: %llu in, %llu after clipping",
+                static_cast<unsigned long long>(statistics.inputAssemblyPrimitives),
+                static_cast<unsigned long long>(statistics.clippingPrimitives));
+            ImGui::Text("Vertex Invocations: %llu", static_cast<unsigned long long>(statistics.vertexShaderInvocations));
+            ImGui::Text("Fragment Invocations: %llu", static_cast<unsigned long long>(statistics.fragmentShaderInvocations));
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Compare against the viewport's pixel count to see overdraw");
+            }
+        }
+        else if (!gpuStats.statisticsSupported) {
+            ImGui::TextDisabled("Pipeline statistics not supported");
+        }
+    }
+    ImGui::Separator();
+
+    std::vector<std::string> threadNames = profiler.getThreadNames();
+    std::vector<uint16_t> maxDepth(threadNames.size(), 0);
+    std::vector<bool> hasZones(threadNames.size(), false);
+    for (const auto& zone : frame.zones) {
+        if (zone.thread >= threadNames.size()) continue;
+        hasZones[zone.thread] = true;
+        maxDepth[zone.thread] = std::max(maxDepth[zone.thread], zone.depth);
+    }
+
+    const float rowHeight = ImGui::GetTextLineHeight() + 4.f;
+    const float labelWidth = 110.f;
+
+    ImGui::BeginChild("FlameGraph", ImVec2(0, 0), false, ImGuiWindowFlags_HorizontalScrollbar);
+
+    float graphWidth = std::max(ImGui::GetContentRegionAvail().x - labelWidth, 100.f) * zoom;
+    double nsToPixels = graphWidth / static_cast<double>(std::max<uint64_t>(frame.endNs - frame.startNs, 1));
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+
+    for (size_t thread = 0; thread < threadNames.size(); thread++) {
+        if (!hasZones[thread]) continue;
+
+        ImVec2 laneOrigin = ImGui::GetCursorScreenPos();
+        float laneHeight = rowHeight * (maxDepth[thread] + 1);
+        ImGui::TextUnformatted(threadNames[thread].c_str());
+        ImGui::SetCursorScreenPos(laneOrigin);
+        ImGui::Dummy(ImVec2(labelWidth + graphWidth, laneHeight + 4.f));
+
+        float graphLeft = laneOrigin.x + labelWidth;
+        for (const auto& zone : frame.zones) {
+            if (zone.thread != thread) continue;
+
+            // Zones that started in an earlier frame (simulation ticks) get clipped to this one
+            uint64_t start = std::max(zone.startNs, frame.startNs);
+            uint64_t end = std::min(zone.endNs, frame.endNs);
+            if (end <= start) continue;
+
+            ImVec2 min(graphLeft + static_cast<float>((start - frame.startNs) * nsToPixels),
+                laneOrigin.y + zone.depth * rowHeight);
+            ImVec2 max(std::max(graphLeft + static_cast<float>((end - frame.startNs) * nsToPixels), min.x + 1.f),
+                min.y + rowHeight - 1.f);
+
+            // Same name, same color across frames
+            size_t hash = std::hash<std::string_view>{}(zone.name);
+            ImU32 color = ImColor::HSV(static_cast<float>(hash % 360) / 360.f, 0.5f, 0.75f);
+            drawList->AddRectFilled(min, max, color);
+
+            float textWidth = ImGui::CalcTextSize(zone.name).x;
+            if (max.x - min.x > textWidth + 4.f) {
+                drawList->AddText(ImVec2(min.x + 2.f, min.y + 2.f), IM_COL32(0, 0, 0, 255), zone.name);
+            }
+
+            if (ImGui::IsMouseHoveringRect(min, max)) {
+                ImGui::SetTooltip("%s\n%.3f ms\n%s", zone.name,
+                    static_cast<double>(zone.endNs - zone.startNs) / 1e6, threadNames[thread].c_str());
+            }
+        }
+    }
+
+    ImGui::EndChild();
+    ImGui::End();
+}
+
+void UI::renderMemoryPanel() {
+    static std::string dumpStatus;
+
+    auto& tracker = MemoryTracker::getInstance();
+
+    ImGui::Begin("Memory");
+
+#if !GRAPE_MEMORY_TRACKING
+    ImGui::TextDisabled("CPU tracking is compiled out (GRAPE_MEMORY_TRACKING=0)");
+#endif
+
+    if (ImGui::Button("Dump to File")) {
+        const char* path = "grape_memory.txt";
+        dumpStatus = tracker.dumpToFile(path) ? std::string("Wrote ") + path : std::string("Failed to write ") + path;
+    }
+    if (!dumpStatus.empty()) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("%s", dumpStatus.c_str());
+    }
+
+    const ImGuiTableFlags tableFlags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingStretchProp;
+    auto beginTable = [&](const char* id) {
+        if (!ImGui::BeginTable(id, 6, tableFlags)) return false;
+        ImGui::TableSetupColumn("");
+        ImGui::TableSetupColumn("Current");
+        ImGui::TableSetupColumn("Peak");
+        ImGui::TableSetupColumn("Blocks");
+        ImGui::TableSetupColumn("Alloc Rate");
+        ImGui::TableSetupColumn("Allocs");
+        ImGui::TableHeadersRow();
+        return true;
+    };
+
+    if (ImGui::CollapsingHeader("CPU", ImGuiTreeNodeFlags_DefaultOpen) && beginTable("CpuMemory")) {
+        for (size_t tag = 0; tag < static_cast<size_t>(MemoryTag::Count); tag++) {
+            memoryRow(MemoryTracker::getTagName(static_cast<MemoryTag>(tag)), tracker.getStats(static_cast<MemoryTag>(tag)));
+        }
+        memoryRow("Total", tracker.getTotalStats(), false);
+        ImGui::EndTable();
+    }
+
+    if (ImGui::CollapsingHeader("GPU", ImGuiTreeNodeFlags_DefaultOpen)) {
+        if (beginTable("GpuMemory")) {
+            for (size_t kind = 0; kind < static_cast<size_t>(GpuMemoryKind::Count); kind++) {
+                memoryRow(MemoryTracker::getGpuKindName(static_cast<GpuMemoryKind>(kind)),
+                    tracker.getGpuStats(static_cast<GpuMemoryKind>(kind)));
+            }
+            ImGui::EndTable();
+        }
+        ImGui::Text("Descriptor Pools: %lld (%lld descriptors)",
+            static_cast<long long>(tracker.getDescriptorPoolCount()), static_cast<long long>(tracker.getDescriptorCount()));
+    }
+
+    ImGui::End();
+}
+
+void UI::renderPerfHud() {
+    if (!DebugSettings::getInstance().showPerfHud) return;
+
+    const auto& perf = PerfCounters::getInstance();
+    const PerfFrame& frame = perf.getLastFrame();
+
+    // Top right corner of the main window, out of the way of the docked panels' tabs
+    const ImGuiViewport* viewport = ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos(ImVec2(viewport->WorkPos.x + viewport->WorkSize.x - 10.f, viewport->WorkPos.y + 30.f),
+        ImGuiCond_Always, ImVec2(1.f, 0.f));
+    ImGui::SetNextWindowViewport(viewport->ID);
+    ImGui::SetNextWindowBgAlpha(0.6f);
+    const ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoDocking |
+        ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing |
+        ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoMove;
+    if (!ImGui::Begin("Perf HUD", nullptr, flags)) {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Text("%zu frame window      p50      p95      p99", perf.getWindowSize());
+    auto series = [&](const char* label, PerfSeries which) {
+        ImGui::Text("%-6s ms  %8.2f %8.2f %8.2f", label,
+            perf.getPercentile(which, 0.5f), perf.getPercentile(which, 0.95f), perf.getPercentile(which, 0.99f));
+    };
+    series("Frame", PerfSeries::Frame);
+    series("CPU", PerfSeries::Cpu);
+    series("GPU", PerfSeries::Gpu);
+    ImGui::Separator();
+
+    uint64_t stateChanges = frame.get(PerfCounter::PipelineBinds) + frame.get(PerfCounter::DescriptorSetBinds) +
+        frame.get(PerfCounter::VertexBufferBinds) + frame.get(PerfCounter::IndexBufferBinds);
+    ImGui::Text("Draws %llu  Triangles %llu",
+        static_cast<unsigned long long>(frame.get(PerfCounter::DrawCalls)),
+        static_cast<unsigned long long>(frame.get(PerfCounter::Triangles)));
+    ImGui::Text("State changes %llu", static_cast<unsigned long long>(stateChanges));
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Pipelines %llu, descriptor sets %llu, vertex buffers %llu, index buffers %llu",
+            static_cast<unsigned long long>(frame.get(PerfCounter::PipelineBinds)),
+            static_cast<unsigned long long>(frame.get(PerfCounter::DescriptorSetBinds)),
+            static_cast<unsigned long long>(frame.get(PerfCounter::VertexBufferBinds)),
+            static_cast<unsigned long long>(frame.get(PerfCounter::IndexBufferBinds)));
+    }
+    ImGui::Text("Objects %u  frustum culled %u  occluded %u", frame.objects, frame.frustumCulled, frame.occlusionCulled);
+    ImGui::Separator();
+
+    ImGui::Text("Physics %.2f ms  bodies %lld (%lld awake)",
+        static_cast<double>(frame.get(PerfGauge::PhysicsStepUs)) / 1000.0,
+        static_cast<long long>(frame.get(PerfGauge::DynamicBodies)),
+        static_cast<long long>(frame.get(PerfGauge::AwakeBodies)));
+    ImGui::Text("Memory CPU %s  GPU %s",
+        MemoryTracker::formatBytes(static_cast<double>(frame.cpuMemoryBytes)).c_str(),
+        MemoryTracker::formatBytes(static_cast<double>(frame.gpuMemoryBytes)).c_str());
+
+    ImGui::End();
+}
+
 void UI::renderContentBrowser() {
     ImGui::Begin("Content Browser");
     
@@ -468,21 +868,27 @@ void UI::renderModelsPanel() {
 
     // Transform section
     if (ImGui::CollapsingHeader("Transform", ImGuiTreeNodeFlags_DefaultOpen)) {
+        // Physics objects get their transform from the simulation's snapshots, so a move has to go
+        // through it or the next snapshot puts the object back
+        auto queuePose = [&obj]() {
+            if (s_simulation && obj.hasPhysics() && obj.physicsComponent->actor) {
+                PhysicsEdit edit{ PhysicsEdit::Type::Pose, obj.physicsComponent->actor };
+                edit.value = obj.transform.translation;
+                edit.rotation = obj.transform.rotation;
+                s_simulation->queueEdit(edit);
+            }
+        };
+
         ImGui::Text("Position");
         if (ImGui::DragFloat3("##Position", &obj.transform.translation.x, 0.1f, -100.0f, 100.0f, "%.2f")) {
-            // If object has physics, update physics transform too
-            if (obj.hasPhysics()) {
-                obj.setPhysicsTransform(obj.transform.translation, obj.transform.rotation);
-            }
+            queuePose();
         }
 
         ImGui::Text("Rotation (degrees)");
         glm::vec3 euler = obj.transform.getEulerDegrees();
         if (ImGui::DragFloat3("##Rotation", &euler.x, 1.0f, -180.0f, 180.0f, "%.1f")) {
             obj.transform.setEulerDegrees(euler);
-            if (obj.hasPhysics()) {
-                obj.setPhysicsTransform(obj.transform.translation, obj.transform.rotation);
-            }
+            queuePose();
         }
 
         ImGui::Text("Scale");
@@ -542,6 +948,7 @@ void UI::renderModelsPanel() {
     if (obj.pointLight && ImGui::CollapsingHeader("Point Light", ImGuiTreeNodeFlags_DefaultOpen)) {
         ImGui::Text("Light Properties:");
         ImGui::SliderFloat("Intensity", &obj.pointLight->lightIntensity, 0.0f, 100.0f, "%.2f");
+        ImGui::SliderFloat("Range", &obj.pointLight->range, 0.1f, 100.0f, "%.1f");
 
         // You can add more light properties here
         // ImGui::ColorEdit3("Light Color", &obj.lightColor.r); // if you add this to PointLightComponent
@@ -556,13 +963,16 @@ void UI::renderModelsPanel() {
         ImGui::Text("Physics Properties:");
         ImGui::Text("Type: %s", physics.isDynamic ? (physics.isKinematic ? "Kinematic" : "Dynamic") : "Static");
 
+        // PhysX is only touched on the simulation thread, so changes are queued for its next tick
+        auto queueEdit = [&physics](PhysicsEdit::Type type, glm::vec3 value) {
+            if (s_simulation && physics.actor) {
+                s_simulation->queueEdit({ type, physics.actor, physics.shape, value });
+            }
+        };
+
         if (physics.isDynamic) {
             if (ImGui::SliderFloat("Mass", &physics.mass, 0.1f, 100.0f, "%.2f")) {
-                // Update mass in PhysX
-                if (physics.actor) {
-                    PxRigidDynamic* dynamicActor = static_cast<PxRigidDynamic*>(physics.actor);
-                    PxRigidBodyExt::updateMassAndInertia(*dynamicActor, physics.mass);
-                }
+                queueEdit(PhysicsEdit::Type::Mass, glm::vec3(physics.mass, 0.f, 0.f));
             }
         }
 
@@ -575,31 +985,18 @@ void UI::renderModelsPanel() {
         materialChanged |= ImGui::SliderFloat("Restitution", &physics.restitution, 0.0f, 1.0f, "%.2f");
 
         if (materialChanged && physics.shape) {
-            // Update material properties in PhysX
-            PxMaterial* materials[1];
-            if (physics.shape->getMaterials(materials, 1) == 1) {
-                materials[0]->setStaticFriction(physics.staticFriction);
-                materials[0]->setDynamicFriction(physics.dynamicFriction);
-                materials[0]->setRestitution(physics.restitution);
-            }
+            queueEdit(PhysicsEdit::Type::Material, glm::vec3(physics.staticFriction, physics.dynamicFriction, physics.restitution));
         }
 
         // Physics controls
         ImGui::Separator();
         if (physics.isDynamic && !physics.isKinematic) {
             if (ImGui::Button("Add Force Up")) {
-                if (physics.actor) {
-                    PxRigidDynamic* dynamicActor = static_cast<PxRigidDynamic*>(physics.actor);
-                    dynamicActor->addForce(PxVec3(0, 10.0f, 0), PxForceMode::eIMPULSE);
-                }
+                queueEdit(PhysicsEdit::Type::Impulse, glm::vec3(0.f, 10.f, 0.f));
             }
             ImGui::SameLine();
             if (ImGui::Button("Reset Velocity")) {
-                if (physics.actor) {
-                    PxRigidDynamic* dynamicActor = static_cast<PxRigidDynamic*>(physics.actor);
-                    dynamicActor->setLinearVelocity(PxVec3(0, 0, 0));
-                    dynamicActor->setAngularVelocity(PxVec3(0, 0, 0));
-                }
+                queueEdit(PhysicsEdit::Type::ResetVelocity, glm::vec3(0.f));
             }
         }
     }
@@ -634,6 +1031,14 @@ void UI::renderModelsPanel() {
 }
 
 // Add this method to set available materials
+void UI::setRenderer(const Renderer* renderer) {
+    s_renderer = renderer;
+}
+
+void UI::setSimulation(SimulationThread* simulation) {
+    s_simulation = simulation;
+}
+
 void UI::setAvailableMaterials(const std::vector<std::string>& materials) {
     s_availableMaterials = materials;
     if (s_availableMaterials.empty()) {
@@ -9,6 +9,9 @@ struct GLFWwindow;
 
 namespace grape {
 
+class Renderer;
+class SimulationThread;
+
 class UI {
 
 public:
@@ -30,6 +33,15 @@ public:
 
     static void renderDebugPanel();
 
+    // CPU zones of a recent frame as a flame graph, per thread
+    static void renderProfilerPanel();
+
+    // Current/peak/rate per memory tag plus GPU memory, with a dump to file
+    static void renderMemoryPanel();
+
+    // Small overlay with rolling frame time percentiles and last frame's PerfCounters
+    static void renderPerfHud();
+
     static void renderContentBrowser();
 
     static void renderSceneInspector();
@@ -41,6 +53,9 @@ public:
     static void renderModelsPanel();
 
     static void setGameObjects(std::unordered_map<uint32_t, GameObject>* objects);
+    static void setRenderer(const Renderer* renderer);
+    // Inspector physics edits go through its queue, PhysX belongs to the simulation thread
+    static void setSimulation(SimulationThread* simulation);
 
     static void setAvailableMaterials(const std::vector<std::string>& materials);
 };
@@ -0,0 +1,34 @@
+#version 450
+
+// Position out of the packed stream, see Model::PackedVertex::getPositionAttributeDescriptions
+layout(location = 0) in vec4 position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo{
+	mat4 projection;
+	mat4 view;
+	mat4 invView;
+	vec4 ambientLightColor;
+} ubo;
+
+// Keep in sync with ObjectData in simple_render_system.hpp
+struct ObjectData {
+	mat4 modelMatrix;
+	mat3x4 normalMatrix;
+	int materialIndex;
+	uint flags;
+	uint vertexColor;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer ObjectBuffer {
+	ObjectData objects[];
+} objectBuffer;
+
+// The shading pass tests depth with EQUAL, both shaders must produce bit-identical positions
+invariant gl_Position;
+
+void main(){
+	ObjectData object = objectBuffer.objects[gl_InstanceIndex];
+
+	vec4 positionWorld = object.modelMatrix * vec4(position.xyz, 1.0);
+	gl_Position = ubo.projection * ubo.view * positionWorld;
+}
@@ -0,0 +1,9 @@
+#version 450
+
+layout (location = 0) out vec4 outColor;
+
+// Additively blended, every shaded fragment adds one step: ~8 layers is full red,
+// ~16 turns yellow and ~32 goes white
+void main() {
+    outColor = vec4(1.0 / 8.0, 1.0 / 16.0, 1.0 / 32.0, 1.0);
+}
@@ -11,18 +11,11 @@ const vec2 OFFSETS[6] = vec2[](
 
 layout (location = 0) out vec2 fragOffset;
 
-struct PointLight {
-  vec4 position;
-  vec4 color;
-};
-
 layout(set = 0, binding = 0) uniform GlobalUbo{
 	mat4 projection;
 	mat4 view;
 	mat4 invView;
 	vec4 ambientLightColor;
-	PointLight pointLights[10];
-  int numLights;
 } ubo;
 
 layout(push_constant) uniform Push{
@@ -0,0 +1,17 @@
+#version 450
+
+// Position out of the packed stream, see Model::PackedVertex::getPositionAttributeDescriptions
+layout(location = 0) in vec4 position;
+
+// Caster model matrices (dequantization folded in), one per light and submesh
+layout(std430, set = 0, binding = 0) readonly buffer CasterBuffer {
+	mat4 models[];
+} casterBuffer;
+
+layout(push_constant) uniform Push {
+	mat4 faceViewProjection;
+} push;
+
+void main(){
+	gl_Position = push.faceViewProjection * casterBuffer.models[gl_InstanceIndex] * vec4(position.xyz, 1.0);
+}
@@ -5,12 +5,14 @@ layout (location = 0) in vec3 fragColor;
 layout (location = 1) in vec3 fragPosWorld;
 layout (location = 2) in vec3 fragNormalWorld;
 layout (location = 3) in vec2 fragTexCoord;
+layout (location = 4) flat in int fragMaterialIndex;
 
 layout (location = 0) out vec4 outColor;
 
 struct PointLight {
-    vec4 position;
-    vec4 color;
+    vec4 position;  // w = range
+    vec4 color;     // w = intensity
+    int shadowIndex;    // Slot in the point shadow maps, -1 for none
 };
 
 layout(set = 0, binding = 0) uniform GlobalUbo {
@@ -18,12 +20,37 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 view;
     mat4 invView;
     vec4 ambientLightColor;
-    PointLight pointLights[10];
-    int numLights;
 } ubo;
 
 layout(set = 0, binding = 1) uniform sampler2D textures[];
 
+// Clustered lights, keep in sync with LightClusterSystem
+struct ClusterInfo {
+    uvec4 gridSize;     // tiles x, tiles y, depth slices, light count
+    vec4 depthParams;   // near, far, slice scale, slice bias
+    vec4 padding;
+};
+
+layout(std430, set = 2, binding = 0) readonly buffer LightBuffer {
+    ClusterInfo info;
+    PointLight lights[];
+} lightBuffer;
+
+layout(std430, set = 2, binding = 1) readonly buffer ClusterBuffer {
+    uvec2 ranges[];     // offset, count into the index buffer
+} clusterBuffer;
+
+layout(std430, set = 2, binding = 2) readonly buffer LightIndexBuffer {
+    uint indices[];
+} lightIndexBuffer;
+
+// Point shadows, keep in sync with PointShadowSystem. Six layers per slot, faces +X -X +Y -Y +Z -Z
+layout(set = 3, binding = 0) uniform sampler2DArrayShadow shadowMaps;
+
+layout(std430, set = 3, binding = 1) readonly buffer ShadowFaceBuffer {
+    mat4 faceViewProjection[];
+} shadowFaces;
+
 // Debug modes enum - keep in sync with C++ code
 #define DEBUG_MODE_NORMAL 0
 #define DEBUG_MODE_SHOW_NORMALS 1
@@ -34,17 +61,62 @@ layout(set = 0, binding = 1) uniform sampler2D textures[];
 #define DEBUG_MODE_SHOW_DOT_PRODUCT 6
 #define DEBUG_MODE_TEXTURE_ONLY 7
 #define DEBUG_MODE_LIGHTING_ONLY 8
+#define DEBUG_MODE_CLUSTER_LIGHT_COUNT 9
 
+// Per-object data comes from the object buffer, only frame-wide state is pushed
 layout(push_constant) uniform Push {
-    mat4 modelMatrix;
-    mat4 normalMatrix;
-    int imgIndex;
-    int debugMode;  // Add debug mode to push constants
+    int debugMode;
 } push;
 
+// Same tiling as the CPU side: NDC tiles in x/y, exponential slices of view depth in z
+uint clusterIndex(vec3 posWorld) {
+    uvec3 grid = lightBuffer.info.gridSize.xyz;
+    vec4 depthParams = lightBuffer.info.depthParams;
+
+    vec4 posView = ubo.view * vec4(posWorld, 1.0);
+    vec4 clip = ubo.projection * posView;
+    vec2 ndc = clip.xy / clip.w;
+
+    uvec2 tile = uvec2(clamp((ndc * 0.5 + 0.5) * vec2(grid.xy), vec2(0.0), vec2(grid.xy) - 1.0));
+    float depth = max(-posView.z, depthParams.x);
+    uint slice = uint(clamp(log(depth) * depthParams.z - depthParams.w, 0.0, float(grid.z) - 1.0));
+
+    return slice * grid.x * grid.y + tile.y * grid.x + tile.x;
+}
+
+// 0 fully shadowed .. 1 lit, four taps of bilinear (2x2) hardware PCF
+float pointShadow(int slot, vec3 lightPos, vec3 posWorld, vec3 normal) {
+    float texel = 1.0 / float(textureSize(shadowMaps, 0).x);
+
+    // Push the lookup off the surface by about a shadow texel at this distance, a face spans 2 units at distance 1
+    float distanceToLight = length(posWorld - lightPos);
+    vec3 samplePos = posWorld + normal * (distanceToLight * 2.0 * texel * 1.5);
+
+    vec3 toSample = samplePos - lightPos;
+    vec3 axis = abs(toSample);
+    int face;
+    if (axis.x >= axis.y && axis.x >= axis.z) face = toSample.x > 0.0 ? 0 : 1;
+    else if (axis.y >= axis.z) face = toSample.y > 0.0 ? 2 : 3;
+    else face = toSample.z > 0.0 ? 4 : 5;
+
+    int layer = slot * 6 + face;
+    vec4 clip = shadowFaces.faceViewProjection[layer] * vec4(samplePos, 1.0);
+    vec3 ndc = clip.xyz / clip.w;
+    vec2 uv = ndc.xy * 0.5 + 0.5;
+
+    float lit = 0.0;
+    for (int y = 0; y < 2; y++) {
+        for (int x = 0; x < 2; x++) {
+            vec2 offset = (vec2(x, y) - 0.5) * texel;
+            lit += texture(shadowMaps, vec4(uv + offset, float(layer), ndc.z));
+        }
+    }
+    return lit * 0.25;
+}
+
 void main() {
     // Sample texture with bounds checking
-    int textureIndex = max(0, push.imgIndex);
+    int textureIndex = max(0, fragMaterialIndex);
     vec4 texColor = texture(textures[nonuniformEXT(textureIndex)], fragTexCoord);
 
     // Ensure we have a valid surface normal
@@ -81,11 +153,17 @@ void main() {
 
     vec3 cameraPosWorld = ubo.invView[3].xyz;
     vec3 viewDirection = normalize(cameraPosWorld - fragPosWorld);
-    int numLights = max(0, min(ubo.numLights, 10));
+    // Only the lights binned into this fragment's cluster
+    uvec2 clusterRange = clusterBuffer.ranges[clusterIndex(fragPosWorld)];
 
-    // Process each point light
-    for (int i = 0; i < numLights; i++) {
-        PointLight light = ubo.pointLights[i];
+    if (push.debugMode == DEBUG_MODE_CLUSTER_LIGHT_COUNT) {
+        float heat = clamp(float(clusterRange.y) / 32.0, 0.0, 1.0);
+        outColor = vec4(heat, 1.0 - abs(heat * 2.0 - 1.0), 1.0 - heat, 1.0) * (clusterRange.y == 0 ? 0.2 : 1.0);
+        return;
+    }
+
+    for (uint i = 0; i < clusterRange.y; i++) {
+        PointLight light = lightBuffer.lights[lightIndexBuffer.indices[clusterRange.x + i]];
         vec3 lightPos = light.position.xyz;
         vec3 directionToLight = lightPos - fragPosWorld;
         float lightDistance = length(directionToLight);
@@ -93,8 +171,14 @@ void main() {
         if (lightDistance < 0.01) lightDistance = 0.01;
         directionToLight = normalize(directionToLight);
 
-        float attenuation = 1.0 / (1.0 + lightDistance * lightDistance * 0.01);
+        // Old inverse-square-ish falloff, windowed so it reaches zero at the light's range (the culling radius)
+        float rangeRatio = lightDistance / light.position.w;
+        float window = clamp(1.0 - rangeRatio * rangeRatio * rangeRatio * rangeRatio, 0.0, 1.0);
+        float attenuation = window * window / (1.0 + lightDistance * lightDistance * 0.01);
         float cosAngIncidence = max(dot(surfaceNormal, directionToLight), 0.0);
+        if (light.shadowIndex >= 0 && attenuation > 0.0 && cosAngIncidence > 0.0) {
+            attenuation *= pointShadow(light.shadowIndex, lightPos, fragPosWorld, surfaceNormal);
+        }
         vec3 lightIntensity = light.color.xyz * light.color.w * attenuation;
 
         diffuseLight += lightIntensity * cosAngIncidence;
@@ -105,7 +189,7 @@ void main() {
             specularLight += lightIntensity * specularFactor;
         }
 
-        // Handle light-specific debug modes (using first light)
+        // Handle light-specific debug modes (using the cluster's first light)
         if (i == 0) {
             if (push.debugMode == DEBUG_MODE_SHOW_LIGHT_DISTANCE) {
                 float normalizedDist = 1.0 - clamp(lightDistance / 10.0, 0.0, 1.0);
@@ -1,42 +1,61 @@
 #version 450
 
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 color;
-layout(location = 2) in vec3 normal;
+// Packed layout, see Model::PackedVertex. Position is UNORM16 within the submesh bounds (the model
+// matrix carries the dequantization), normal is octahedral SNORM16, uv half floats
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 normal;
 layout(location = 3) in vec2 uv;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 fragPosWorld;
 layout(location = 2) out vec3 fragNormalWorld;
 layout(location = 3) out vec2 fragTexCoord;
-
-struct PointLight {
-  vec4 position;
-  vec4 color;
-};
+layout(location = 4) flat out int fragMaterialIndex;
 
 layout(set = 0, binding = 0) uniform GlobalUbo{
 	mat4 projection;
 	mat4 view;
 	mat4 invView;
 	vec4 ambientLightColor;
-	PointLight pointLights[10];
-  int numLights;
 } ubo;
 
-// FIXED: Add imgIndex to match your C++ struct
-layout(push_constant) uniform Push{
+// Keep in sync with ObjectData in simple_render_system.hpp
+struct ObjectData {
 	mat4 modelMatrix;
-	mat4 normalMatrix;
-	int imgIndex;  // Add this line!
-} push;
+	mat3x4 normalMatrix;
+	int materialIndex;
+	uint flags;
+	uint vertexColor;
+};
+
+const uint OBJECT_FLAG_VERTEX_COLOR = 2u;
+
+layout(std430, set = 1, binding = 0) readonly buffer ObjectBuffer {
+	ObjectData objects[];
+} objectBuffer;
+
+// Must match depth_prepass.vert exactly for the EQUAL depth test after the pre-pass
+invariant gl_Position;
+
+vec3 decodeOctahedral(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
 
 void main(){
-	vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+	// firstInstance of each draw is its index into the object buffer
+	ObjectData object = objectBuffer.objects[gl_InstanceIndex];
+
+	vec4 positionWorld = object.modelMatrix * vec4(position.xyz, 1.0);
 	gl_Position = ubo.projection * ubo.view * positionWorld;
 
-	fragNormalWorld = normalize(mat3(push.normalMatrix) * normal);
+	fragNormalWorld = normalize(mat3(object.normalMatrix) * decodeOctahedral(normal));
 	fragPosWorld = positionWorld.xyz;
-	fragColor = color;
+	// Without a color stream binding 1 is just filler, every vertex has the same color
+	fragColor = (object.flags & OBJECT_FLAG_VERTEX_COLOR) != 0u ? color.rgb : unpackUnorm4x8(object.vertexColor).rgb;
 	fragTexCoord = uv;
+	fragMaterialIndex = object.materialIndex;
 }
\ No newline at end of file